@@ -57,6 +57,8 @@ inline void safe_str_copy(char* dest, size_t dest_size, const char* src) {
 
 namespace Metadata {
     static constexpr std::string_view PluginHashId = "plugin-hash-id";
+    // Binary, the id returned by OpenSession. Replaces PluginHashId.
+    static constexpr std::string_view SessionId = "session-bin";
 }
 
 RCLAP_END_NAMESPACE
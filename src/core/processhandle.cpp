@@ -2,6 +2,10 @@
 
 #include <utility>
 
+#if defined __linux__ || defined __APPLE__
+#include <fcntl.h>
+#endif
+
 RCLAP_BEGIN_NAMESPACE
 
 struct ProcessHandlePrivate
@@ -19,6 +23,7 @@ struct ProcessHandlePrivate
 
     std::filesystem::path mPath;
     std::vector<std::string> mArgs;
+    std::vector<int> mInheritedFds;
 
 #if defined _WIN32 || defined _WIN64
     HANDLE mChildHandle = nullptr;
@@ -105,6 +110,18 @@ void ProcessHandle::clearArguments()
     dPtr->mArgs.clear();
 }
 
+bool ProcessHandle::inheritFd(int fd)
+{
+#if defined _WIN32 || defined _WIN64
+    return false;
+#elif defined __linux__ || defined __APPLE__
+    if (dPtr->isChildRunning() || fd < 0)
+        return false;
+    dPtr->mInheritedFds.push_back(fd);
+    return true;
+#endif
+}
+
 PidType ProcessHandle::getCurrentPid()
 {
 #if defined _WIN32 || defined _WIN64
@@ -310,6 +327,8 @@ bool ProcessHandlePrivate::startChild()
     if (mChildHandle < 0)
         return false;
     if (mChildHandle == 0) { // Child process
+        for (const auto fd : mInheritedFds)
+            fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) & ~FD_CLOEXEC);
         std::vector<char*> argv;
         argv.push_back(const_cast<char*>(mPath.c_str()));
         for (const auto &arg : mArgs)
@@ -53,6 +53,9 @@ public:
     bool setArguments(const std::vector<std::string>& args);
     bool setExecutable(const std::filesystem::path& path);
     void clearArguments();
+    // Keeps fd open across the exec of the child, even if it's marked close-on-exec.
+    // Only supported on Unix.
+    bool inheritFd(int fd);
 
     static PidType getCurrentPid();
     static PidType getParentPid();
@@ -0,0 +1,295 @@
+#include "shmring.h"
+#include "logging.h"
+
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <new>
+#include <utility>
+
+#if defined __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+RCLAP_BEGIN_NAMESPACE
+
+// Lives at the beginning of the mapping, followed by the data.
+struct ShmRing::Header
+{
+    std::uint32_t magic = 0;
+    std::uint32_t version = 0;
+    std::uint64_t capacity = 0;
+    alignas(64) std::atomic<std::uint64_t> head = 0; // Bytes written, owned by the producer
+    alignas(64) std::atomic<std::uint64_t> tail = 0; // Bytes read, owned by the consumer
+    std::atomic<std::uint32_t> sleeping = 0;
+    std::atomic<std::uint32_t> closed = 0;
+};
+
+namespace {
+
+constexpr std::uint32_t Magic = 0x72636c70; // "rclp"
+constexpr std::uint32_t Version = 1;
+constexpr std::size_t HeaderSize = 4096;
+constexpr std::uint32_t WrapMarker = 0xffffffff;
+constexpr std::size_t Alignment = 8;
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free);
+
+constexpr std::size_t recordSize(std::size_t len)
+{
+    return (sizeof(std::uint32_t) + len + Alignment - 1) & ~(Alignment - 1);
+}
+
+constexpr std::size_t nextPowerOfTwo(std::size_t v)
+{
+    std::size_t p = 1;
+    while (p < v)
+        p <<= 1;
+    return p;
+}
+
+} // namespace
+
+ShmRing::ShmRing(int memFd, int eventFd, void *mapping, std::size_t mappingSize)
+    : mMemFd(memFd), mEventFd(eventFd), mMapping(mapping), mMappingSize(mappingSize),
+      mCapacity(mappingSize - HeaderSize), mHeader(static_cast<Header *>(mapping))
+{}
+
+ShmRing::ShmRing(ShmRing &&other) noexcept
+    : mMemFd(std::exchange(other.mMemFd, -1)), mEventFd(std::exchange(other.mEventFd, -1)),
+      mMapping(std::exchange(other.mMapping, nullptr)), mMappingSize(std::exchange(other.mMappingSize, 0)),
+      mCapacity(std::exchange(other.mCapacity, 0)), mHeader(std::exchange(other.mHeader, nullptr))
+{}
+
+ShmRing &ShmRing::operator=(ShmRing &&other) noexcept
+{
+    if (this != &other) {
+        std::swap(mMemFd, other.mMemFd);
+        std::swap(mEventFd, other.mEventFd);
+        std::swap(mMapping, other.mMapping);
+        std::swap(mMappingSize, other.mMappingSize);
+        std::swap(mCapacity, other.mCapacity);
+        std::swap(mHeader, other.mHeader);
+    }
+    return *this;
+}
+
+std::uint8_t *ShmRing::data() const noexcept
+{
+    return static_cast<std::uint8_t *>(mMapping) + HeaderSize;
+}
+
+std::string ShmRing::fdArgument() const
+{
+    return std::to_string(mMemFd) + ":" + std::to_string(mEventFd);
+}
+
+std::optional<ShmRing> ShmRing::attach(std::string_view fdArgument)
+{
+    const auto sep = fdArgument.find(':');
+    if (sep == std::string_view::npos)
+        return std::nullopt;
+    int memFd = -1;
+    int eventFd = -1;
+    const auto *end = fdArgument.data() + fdArgument.size();
+    if (std::from_chars(fdArgument.data(), fdArgument.data() + sep, memFd).ec != std::errc()
+        || std::from_chars(fdArgument.data() + sep + 1, end, eventFd).ec != std::errc())
+        return std::nullopt;
+    return attach(memFd, eventFd);
+}
+
+#if defined __linux__
+
+std::optional<ShmRing> ShmRing::create(std::size_t capacity)
+{
+    capacity = nextPowerOfTwo(std::max<std::size_t>(capacity, 4096));
+    const auto mappingSize = HeaderSize + capacity;
+
+    const int memFd = memfd_create("clap-rci-ring", MFD_CLOEXEC);
+    if (memFd < 0) {
+        SPDLOG_ERROR("memfd_create failed: {}", strerror(errno));
+        return std::nullopt;
+    }
+    if (ftruncate(memFd, static_cast<off_t>(mappingSize)) != 0) {
+        SPDLOG_ERROR("ftruncate of the ring failed: {}", strerror(errno));
+        ::close(memFd);
+        return std::nullopt;
+    }
+    const int eventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (eventFd < 0) {
+        SPDLOG_ERROR("eventfd failed: {}", strerror(errno));
+        ::close(memFd);
+        return std::nullopt;
+    }
+    void *mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, memFd, 0);
+    if (mapping == MAP_FAILED) {
+        SPDLOG_ERROR("mmap of the ring failed: {}", strerror(errno));
+        ::close(memFd);
+        ::close(eventFd);
+        return std::nullopt;
+    }
+
+    auto *header = new (mapping) Header();
+    header->magic = Magic;
+    header->version = Version;
+    header->capacity = capacity;
+    return ShmRing(memFd, eventFd, mapping, mappingSize);
+}
+
+std::optional<ShmRing> ShmRing::attach(int memFd, int eventFd)
+{
+    auto fail = [&](std::string_view what) -> std::optional<ShmRing> {
+        SPDLOG_ERROR("Failed to attach to ring: {}", what);
+        ::close(memFd);
+        ::close(eventFd);
+        return std::nullopt;
+    };
+
+    struct stat st {};
+    if (fstat(memFd, &st) != 0 || static_cast<std::size_t>(st.st_size) <= HeaderSize)
+        return fail("invalid memfd");
+    const auto mappingSize = static_cast<std::size_t>(st.st_size);
+    void *mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, memFd, 0);
+    if (mapping == MAP_FAILED)
+        return fail("mmap failed");
+
+    const auto *header = static_cast<const Header *>(mapping);
+    if (header->magic != Magic || header->version != Version || header->capacity != mappingSize - HeaderSize) {
+        munmap(mapping, mappingSize);
+        return fail("header mismatch");
+    }
+    return ShmRing(memFd, eventFd, mapping, mappingSize);
+}
+
+ShmRing::~ShmRing()
+{
+    if (mMapping)
+        munmap(mMapping, mMappingSize);
+    if (mMemFd >= 0)
+        ::close(mMemFd);
+    if (mEventFd >= 0)
+        ::close(mEventFd);
+}
+
+bool ShmRing::write(std::string_view record) noexcept
+{
+    assert(mHeader);
+    if (record.size() > maxRecordSize())
+        return false;
+
+    const auto head = mHeader->head.load(std::memory_order_relaxed);
+    const auto tail = mHeader->tail.load(std::memory_order_acquire);
+    const auto pos = head & (mCapacity - 1);
+    const auto contiguous = mCapacity - pos;
+    const auto need = recordSize(record.size());
+    const auto skip = contiguous < need ? contiguous : 0;
+    if (mCapacity - (head - tail) < skip + need)
+        return false;
+
+    auto *p = data() + pos;
+    if (skip != 0) {
+        std::memcpy(p, &WrapMarker, sizeof(WrapMarker));
+        p = data();
+    }
+    const auto len = static_cast<std::uint32_t>(record.size());
+    std::memcpy(p, &len, sizeof(len));
+    std::memcpy(p + sizeof(len), record.data(), record.size());
+    mHeader->head.store(head + skip + need, std::memory_order_release);
+
+    // Pairs with the fence in wait(). Either the consumer sees the new head or we see it sleeping.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (mHeader->sleeping.load(std::memory_order_relaxed) != 0 && mHeader->sleeping.exchange(0) != 0) {
+        const std::uint64_t one = 1;
+        [[maybe_unused]] const auto n = ::write(mEventFd, &one, sizeof(one));
+    }
+    return true;
+}
+
+void ShmRing::reset() noexcept
+{
+    mHeader->tail.store(mHeader->head.load(std::memory_order_relaxed), std::memory_order_release);
+    mHeader->closed.store(0);
+}
+
+void ShmRing::close() noexcept
+{
+    mHeader->closed.store(1);
+    const std::uint64_t one = 1;
+    [[maybe_unused]] const auto n = ::write(mEventFd, &one, sizeof(one));
+}
+
+bool ShmRing::read(std::string &record)
+{
+    assert(mHeader);
+    auto tail = mHeader->tail.load(std::memory_order_relaxed);
+    const auto head = mHeader->head.load(std::memory_order_acquire);
+    if (tail == head)
+        return false;
+
+    auto pos = tail & (mCapacity - 1);
+    std::uint32_t len = 0;
+    std::memcpy(&len, data() + pos, sizeof(len));
+    if (len == WrapMarker) {
+        tail += mCapacity - pos;
+        pos = 0;
+        std::memcpy(&len, data(), sizeof(len));
+    }
+    record.assign(reinterpret_cast<const char *>(data() + pos + sizeof(len)), len);
+    mHeader->tail.store(tail + recordSize(len), std::memory_order_release);
+    return true;
+}
+
+bool ShmRing::wait(std::chrono::milliseconds timeout) noexcept
+{
+    auto hasData = [this] {
+        return mHeader->head.load(std::memory_order_acquire) != mHeader->tail.load(std::memory_order_relaxed);
+    };
+    if (hasData() || isClosed())
+        return true;
+
+    mHeader->sleeping.store(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!hasData() && !isClosed()) {
+        pollfd pfd { mEventFd, POLLIN, 0 };
+        ::poll(&pfd, 1, static_cast<int>(timeout.count()));
+    }
+    mHeader->sleeping.store(0);
+    std::uint64_t drained = 0;
+    [[maybe_unused]] const auto n = ::read(mEventFd, &drained, sizeof(drained));
+    return hasData() || isClosed();
+}
+
+bool ShmRing::isClosed() const noexcept
+{
+    return mHeader->closed.load() != 0;
+}
+
+#else
+
+std::optional<ShmRing> ShmRing::create(std::size_t)
+{
+    SPDLOG_WARN("The shared memory ring is only available on Linux");
+    return std::nullopt;
+}
+
+std::optional<ShmRing> ShmRing::attach(int, int)
+{
+    return std::nullopt;
+}
+
+ShmRing::~ShmRing() = default;
+bool ShmRing::write(std::string_view) noexcept { return false; }
+void ShmRing::reset() noexcept {}
+void ShmRing::close() noexcept {}
+bool ShmRing::read(std::string &) { return false; }
+bool ShmRing::wait(std::chrono::milliseconds) noexcept { return false; }
+bool ShmRing::isClosed() const noexcept { return true; }
+
+#endif
+
+RCLAP_END_NAMESPACE
@@ -0,0 +1,71 @@
+#ifndef SHMRING_H
+#define SHMRING_H
+
+#include "global.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+RCLAP_BEGIN_NAMESPACE
+
+// A single-producer single-consumer ring of length-prefixed records that lives in
+// a memfd mapping, so it can be shared with a child process by passing the fds at
+// spawn. An eventfd wakes the consumer if it went to sleep in wait().
+// Records never wrap: if a record doesn't fit at the end, the producer writes a
+// wrap marker and continues at the beginning. Only available on Linux.
+class ShmRing
+{
+public:
+    // Capacity is rounded up to a power of two.
+    static std::optional<ShmRing> create(std::size_t capacity);
+    // Maps the ring of the parent. Takes ownership of the fds.
+    static std::optional<ShmRing> attach(int memFd, int eventFd);
+
+    ~ShmRing();
+    ShmRing(ShmRing &&other) noexcept;
+    ShmRing &operator=(ShmRing &&other) noexcept;
+    ShmRing(const ShmRing &) = delete;
+    ShmRing &operator=(const ShmRing &) = delete;
+
+    // Producer. Returns false if the ring has no space for the record.
+    bool write(std::string_view record) noexcept;
+    // Producer. Discards all unread records, the consumer must not be reading.
+    void reset() noexcept;
+    // Producer. Tells the consumer that no more records will follow.
+    void close() noexcept;
+
+    // Consumer. Returns false if the ring is empty.
+    bool read(std::string &record);
+    // Consumer. Blocks until a record is available, the ring is closed or the timeout expires.
+    bool wait(std::chrono::milliseconds timeout) noexcept;
+    [[nodiscard]] bool isClosed() const noexcept;
+
+    [[nodiscard]] std::size_t capacity() const noexcept { return mCapacity; }
+    [[nodiscard]] std::size_t maxRecordSize() const noexcept { return mCapacity / 2 - sizeof(std::uint64_t); }
+    [[nodiscard]] int memFd() const noexcept { return mMemFd; }
+    [[nodiscard]] int eventFd() const noexcept { return mEventFd; }
+
+    // The argument format used to hand the fds to a child: "<memfd>:<eventfd>".
+    [[nodiscard]] std::string fdArgument() const;
+    static std::optional<ShmRing> attach(std::string_view fdArgument);
+
+private:
+    struct Header;
+    ShmRing(int memFd, int eventFd, void *mapping, std::size_t mappingSize);
+    [[nodiscard]] std::uint8_t *data() const noexcept;
+
+    int mMemFd = -1;
+    int mEventFd = -1;
+    void *mMapping = nullptr;
+    std::size_t mMappingSize = 0;
+    std::size_t mCapacity = 0;
+    Header *mHeader = nullptr;
+};
+
+RCLAP_END_NAMESPACE
+
+#endif // SHMRING_H
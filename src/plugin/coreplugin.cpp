@@ -7,6 +7,7 @@
 #include <core/logging.h>
 #include <core/processhandle.h>
 
+#include <server/paraminfosnapshot.h>
 #include <server/serverctrl.h>
 #include <server/shareddata.h>
 #include <server/wrappers.h>
@@ -16,6 +17,8 @@
 #include <spdlog/fmt/bundled/core.h>
 #include <crill/progressive_backoff_wait.h>
 
+#include <algorithm>
+#include <atomic>
 #include <string>
 #include <chrono>
 
@@ -34,9 +37,12 @@ RCLAP_BEGIN_NAMESPACE
 
 struct CorePluginPrivate
 {
-    CorePluginPrivate() = default;
+    CorePluginPrivate() { pendingClientParams.reserve(MaxPendingClientParams); }
     explicit CorePluginPrivate(const clap_plugin_descriptor *desc, std::unique_ptr<Module> rootModule)
-        : desc(desc), rootModule(std::move(rootModule)) {}
+        : desc(desc), rootModule(std::move(rootModule))
+    {
+        pendingClientParams.reserve(MaxPendingClientParams);
+    }
 
     // #### Identification / SharedData ####
     const clap_plugin_descriptor *desc = nullptr;
@@ -48,6 +54,12 @@ struct CorePluginPrivate
 
     // #### Processing ####
     Context context;
+    EventTime blockTime; // Of the current process() call, stamped on all its events
+    // Client params that are due in this or a later block, ordered by their time. Never
+    // grows beyond its reserved capacity, the rest waits in the queue.
+    static constexpr std::size_t MaxPendingClientParams = 512;
+    std::vector<ClientParamWrapper> pendingClientParams;
+    std::atomic<uint64_t> droppedClientParams = 0; // Refused by the host, only written by the audio thread
     std::vector<clap_audio_port_info> audioPortsInfoIn;
     std::vector<clap_audio_port_info> audioPortsInfoOut;
     std::vector<clap_note_port_info> notePortsInfoIn;
@@ -59,6 +71,8 @@ struct CorePluginPrivate
     // #### PARAMS ####
     std::vector<std::unique_ptr<Parameter>> params;
     std::unordered_map<clap_id, Parameter *> paramsHashed; // For fast access from cookies.
+    ParamInfoSnapshot paramInfos; // Serialized as the params are added
+    bool paramInfosPublished = false;
 
     // #### UTILITY ####
     std::unique_ptr<Settings> settings;
@@ -84,7 +98,7 @@ CorePlugin::CorePlugin(const Settings &settings, const clap_plugin_descriptor *d
     // Since ServerCtrl is a static instance, this can potentially hold multiple plugins
     // if the DSO and all its instances are loaded into the same process' address space.
     // Since a pointer is unique across the process address space, we use it as a hash seed.
-    auto hc = ServerCtrl::instance().addPlugin(this);
+    auto hc = ServerCtrl::instance().addPlugin(this, dPtr->settings->queues());
     assert(hc);
     dPtr->hashCore = *hc;
     logInfo();
@@ -121,6 +135,7 @@ bool CorePlugin::activate(double sampleRate, uint32_t minFrameCount, uint32_t ma
 {
     dPtr->context.setSampleRate(sampleRate);
     dPtr->rootModule->activate();
+    publishParamInfos();
     pushToMainQueue({Event::PluginActivate, ClapEventMainSyncWrapper{}});
     return true;
 }
@@ -151,48 +166,74 @@ void CorePlugin::reset() noexcept
     pushToMainQueue({Event::PluginReset, ClapEventMainSyncWrapper{}});
 }
 
-void CorePlugin::processGuiEvents(const clap_output_events *ov)
+// Moves the params of the clients into the schedule, in the order of their target time.
+// A param without a time is due at the start of the block.
+void CorePlugin::processGuiEvents()
 {
+    auto &pending = dPtr->pendingClientParams;
     ClientParamWrapper clientEv;
-    while (dPtr->sharedData->clientsToPluginQueue().pop(clientEv)) {
-        switch (clientEv.ev) {
-            case Param: {
-                auto *param = getParameterById(clientEv.paramId);
-                if (!param) {
-                    SPDLOG_ERROR("Event process: parameter not found");
-                    break;
-                }
-                SPDLOG_TRACE("Event process: parameter {} value {}", clientEv.paramId, clientEv.value);
-                param->setValue(clientEv.value);
-                clap_event_param_value ev;
-                ev.header.time = 0;
-                ev.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
-                ev.header.type = CLAP_EVENT_PARAM_VALUE;
-                ev.header.size = sizeof(ev);
-                ev.header.flags = 0;
-                ev.param_id = clientEv.paramId;
-                ev.value = clientEv.value;
-                ev.channel = -1;
-                ev.key = -1;
-                ev.cookie = param;
-
-               if (!ov->try_push(ov, &ev.header)) [[unlikely]]
-                  return;
-            } break;
-            case ParamInfo:
-                break;
-            case Note:
-                break;
-            default:
-                SPDLOG_ERROR("Unknown event");  // TODO: provide global converter between ev <> string
+    while (pending.size() < CorePluginPrivate::MaxPendingClientParams && dPtr->sharedData->clientsToPluginQueue().pop(clientEv)) {
+        if (clientEv.ev != Event::Param) {
+            SPDLOG_ERROR("Unknown event");  // TODO: provide global converter between ev <> string
+            continue;
         }
+        const auto it = std::upper_bound(pending.begin(), pending.end(), clientEv.timeNs, [](uint64_t t, const auto &p) {
+            return t < p.timeNs;
+        });
+        pending.insert(it, clientEv);
+    }
+}
+
+// The frame of the current block a client param is due at. Past times map to the first frame.
+uint32_t CorePlugin::clientParamFrame(const ClientParamWrapper &ev) const noexcept
+{
+    const auto blockStart = dPtr->blockTime.timeNs;
+    if (ev.timeNs <= blockStart)
+        return 0;
+    const auto frames = static_cast<double>(ev.timeNs - blockStart) * dPtr->context.sampleRate() / 1e9;
+    return frames < static_cast<double>(UINT32_MAX) ? static_cast<uint32_t>(frames) : UINT32_MAX;
+}
+
+void CorePlugin::applyClientParam(const ClientParamWrapper &clientEv, uint32_t frame, const clap_output_events *ov)
+{
+    auto *param = getParameterById(clientEv.paramId);
+    if (!param) {
+        SPDLOG_ERROR("Event process: parameter not found");
+        return;
+    }
+    SPDLOG_TRACE("Event process: parameter {} value {} at frame {}", clientEv.paramId, clientEv.value, frame);
+    param->setValue(clientEv.value);
+    clap_event_param_value ev;
+    ev.header.time = frame;
+    ev.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
+    ev.header.type = CLAP_EVENT_PARAM_VALUE;
+    ev.header.size = sizeof(ev);
+    ev.header.flags = 0;
+    ev.param_id = clientEv.paramId;
+    ev.value = clientEv.value;
+    ev.channel = -1;
+    ev.key = -1;
+    ev.cookie = param;
+
+    // No logging on the audio thread, the count is read by whoever cares.
+    if (!ov->try_push(ov, &ev.header)) [[unlikely]] {
+        auto &dropped = dPtr->droppedClientParams;
+        dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
     }
 }
 
 clap_process_status CorePlugin::process(const clap_process *process) noexcept
 {
-    // Process all events from the Server
-    processGuiEvents(process->out_events);
+    // A single clock read per block. The events are placed within it by their frame offset.
+    dPtr->blockTime.block += 1;
+    dPtr->blockTime.timeNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count());
+
+    // Schedule all events from the Server
+    processGuiEvents();
+    auto &pending = dPtr->pendingClientParams;
+    std::size_t nextClientEv = 0;
 
     clap_process_status retStatus = CLAP_PROCESS_SLEEP;
 
@@ -222,14 +263,25 @@ clap_process_status CorePlugin::process(const clap_process *process) noexcept
             ++evIdx;
             ev = (evIdx < nEvts) ? inEvs->get(inEvs, evIdx) : nullptr;
         }
+        // Client params that are due land after the host's events of the same frame.
+        while (nextClientEv < pending.size() && clientParamFrame(pending[nextClientEv]) <= frame) {
+            applyClientParam(pending[nextClientEv], frame, process->out_events);
+            ++nextClientEv;
+        }
         // Process audio at given @frame
         retStatus = dPtr->rootModule->process(process, frame);
         ++frame;
     }
+    pending.erase(pending.begin(), pending.begin() + static_cast<std::ptrdiff_t>(nextClientEv));
 
     return retStatus;
 }
 
+uint64_t CorePlugin::droppedClientParams() const noexcept
+{
+    return dPtr->droppedClientParams.load(std::memory_order_relaxed);
+}
+
 void CorePlugin::processEvent(const clap_event_header_t *evHdr) noexcept
 {
     if (evHdr->space_id != CLAP_CORE_EVENT_SPACE_ID)
@@ -254,7 +306,7 @@ void CorePlugin::processEvent(const clap_event_header_t *evHdr) noexcept
             std::terminate();
         }
         param->setValue(evParam->value);
-        pushToProcessQueue({ Event::Param, ClapEventParamWrapper(evParam) });
+        pushToProcessQueue(ClapEventParamWrapper(evParam, param->stateVersion()));
     } break;
 
     case CLAP_EVENT_PARAM_MOD: {
@@ -274,32 +326,39 @@ void CorePlugin::processEvent(const clap_event_header_t *evHdr) noexcept
             std::terminate();
         }
         param->setModulation(evParam->amount);
-        pushToProcessQueue({ Event::Param, ClapEventParamWrapper(evParam) });
+        pushToProcessQueue(ClapEventParamWrapper(evParam, param->stateVersion()));
+    } break;
+
+    case CLAP_EVENT_PARAM_GESTURE_BEGIN:
+    case CLAP_EVENT_PARAM_GESTURE_END: {
+        // Only forwarded, clients conflating the param values rely on the edges.
+        const auto *evGesture = reinterpret_cast<const clap_event_param_gesture *>(evHdr);
+        pushToProcessQueue(ClapEventParamWrapper(evGesture));
     } break;
 
     case CLAP_EVENT_NOTE_ON: {
         const auto *evNote = reinterpret_cast<const clap_event_note *>(evHdr);
-        pushToProcessQueue({ Event::Note, ClapEventNoteWrapper { evNote, CLAP_EVENT_NOTE_ON }});
+        pushToProcessQueue(ClapEventNoteWrapper { evNote, CLAP_EVENT_NOTE_ON });
     } break;
 
     case CLAP_EVENT_NOTE_OFF: {
         const auto *evNote = reinterpret_cast<const clap_event_note *>(evHdr);
-        pushToProcessQueue({ Event::Note, ClapEventNoteWrapper { evNote, CLAP_EVENT_NOTE_OFF }});
+        pushToProcessQueue(ClapEventNoteWrapper { evNote, CLAP_EVENT_NOTE_OFF });
     } break;
 
     case CLAP_EVENT_NOTE_CHOKE: {
         const auto *evNote = reinterpret_cast<const clap_event_note *>(evHdr);
-        pushToProcessQueue({ Event::Note, ClapEventNoteWrapper { evNote, CLAP_EVENT_NOTE_CHOKE }});
+        pushToProcessQueue(ClapEventNoteWrapper { evNote, CLAP_EVENT_NOTE_CHOKE });
     } break;
 
     case CLAP_EVENT_NOTE_END: {
         const auto *evNote = reinterpret_cast<const clap_event_note *>(evHdr);
-        pushToProcessQueue({ Event::Note, ClapEventNoteWrapper { evNote, CLAP_EVENT_NOTE_END }});
+        pushToProcessQueue(ClapEventNoteWrapper { evNote, CLAP_EVENT_NOTE_END });
     } break;
 
     case CLAP_EVENT_NOTE_EXPRESSION: {
         const auto *evNote = reinterpret_cast<const clap_event_note_expression *>(evHdr);
-        pushToProcessQueue({ Event::Note, ClapEventNoteWrapper { evNote, CLAP_EVENT_NOTE_EXPRESSION, evNote->expression_id }});
+        pushToProcessQueue(ClapEventNoteWrapper { evNote, CLAP_EVENT_NOTE_EXPRESSION, evNote->expression_id });
     } break;
 
     case CLAP_EVENT_MIDI: {
@@ -384,6 +443,15 @@ Parameter *CorePlugin::addParameter(const clap_param_info &info, std::unique_ptr
         throw std::logic_error(fmt::format("Parameter with id {} already exists!", info.id));
     // Store in the vector
     dPtr->params.push_back(std::move(copy));
+    dPtr->paramInfos.add(info);
+    dPtr->paramInfosPublished = false;
+    if (dPtr->sharedData) {
+        auto &states = dPtr->sharedData->paramStates();
+        if (auto *state = states.add(info.id, ptr->value()))
+            ptr->attachState(&states, state);
+        else
+            SPDLOG_WARN("Parameter {} exceeds the param state table, late clients won't see it", info.id);
+    }
 
     return ptr;
 }
@@ -432,6 +500,8 @@ bool CorePlugin::guiCreate(const char *api, bool isFloating) noexcept
         return false;
     }
     dPtr->guiProc = std::make_unique<ProcessHandle>();
+    // The GUI fetches the param infos with GetParamInfos as soon as it connected.
+    publishParamInfos();
 
     // Recheck the executable. It could be deleted in the meantime.
     if (!dPtr->settings->executable()) {
@@ -449,24 +519,45 @@ bool CorePlugin::guiCreate(const char *api, bool isFloating) noexcept
 
     // Send the hash as argument to identify the plugin to this instance.
     const auto shash = std::to_string(dPtr->hashCore);
-    if (!dPtr->guiProc->setArguments({ *addr, shash })) { // Prepare to launch the GUI
+    std::vector<std::string> args { *addr, shash };
+    // The optional shared memory ring is passed as inherited fds: "<memfd>:<eventfd>".
+    if (const auto capacity = dPtr->settings->sharedMemoryRing()) {
+        if (dPtr->sharedData->createShmRing(*capacity)) {
+            const auto *ring = dPtr->sharedData->shmRing();
+            dPtr->guiProc->inheritFd(ring->memFd());
+            dPtr->guiProc->inheritFd(ring->eventFd());
+            args.push_back(ring->fdArgument());
+        } else {
+            SPDLOG_WARN("Failed to create the shared memory ring, the GUI uses the stream only");
+        }
+    }
+    if (!dPtr->guiProc->setArguments(args)) { // Prepare to launch the GUI
         SPDLOG_ERROR("Failed to set args for executable");
         return false;
     }
 
+    // Streams of a previous GUI may still be connected, wait for the one of this launch.
+    const auto generation = dPtr->sharedData->streamGeneration();
     if (!dPtr->guiProc->startChild()) {  // Start the GUI
         SPDLOG_ERROR("Failed to execute GUI");
         return false;
     }
 
     SPDLOG_INFO("Started GUI with PID: {}", dPtr->guiProc->getChildPid());
-    std::this_thread::sleep_for(std::chrono::milliseconds(500)); // FIXME, sync issue with the server when restarting quickly
-    // Wait for the polling queue to be ready. And send a verification event.
-    crill::progressive_backoff_wait([&]{
-        // TODO: Bail out after x time or process closed
-//        SPDLOG_TRACE("Waiting for polling queue to be ready");
-        return dPtr->sharedData->isPolling();
-    });
+    // Woken once the stream of the GUI is polled. Bail out early if the GUI died.
+    const auto deadline = std::chrono::steady_clock::now() + ServerCtrl::instance().getInitTimeout();
+    while (!dPtr->sharedData->waitForStream(generation, std::chrono::milliseconds(50))) {
+        if (const auto status = dPtr->guiProc->checkChildStatus()) {
+            SPDLOG_ERROR("GUI exited with {} before connecting", *status);
+            return false;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            SPDLOG_WARN("GUI has failed to connect in time. Killing Gui process.");
+            if (!dPtr->guiProc->terminateChild())
+                SPDLOG_CRITICAL("GUI proc failed to killChild");
+            return false;
+        }
+    }
 
     pushToMainQueueBlocking({Event::GuiCreate, ClapEventMainSyncWrapper{}});
     if (!dPtr->sharedData->blockingVerifyEvent(Event::GuiCreate)) {
@@ -475,7 +566,6 @@ bool CorePlugin::guiCreate(const char *api, bool isFloating) noexcept
             SPDLOG_CRITICAL("GUI proc failed to killChild");
         return false;
     }
-    enqueueAuxiliaries();
 
     return true;
 }
@@ -576,6 +666,11 @@ std::vector<clap_audio_port_info> &CorePlugin::audioPortsInfoOut() noexcept
     return dPtr->audioPortsInfoOut;
 }
 
+uint64_t CorePlugin::hashId() const noexcept
+{
+    return dPtr->hashCore;
+}
+
 void CorePlugin::logInfo()
 {
     constexpr std::string_view  PluginInfoMsg = "\n\n"
@@ -604,34 +699,39 @@ void CorePlugin::logInfo()
 
 bool CorePlugin::pushToMainQueue(ServerEventWrapper &&ev)
 {
-    return dPtr->sharedData->pluginMainToClientsQueue().push(std::move(ev));
+    if (!dPtr->sharedData->pluginMainToClientsQueue().push(std::move(ev)))
+        return false;
+    dPtr->sharedData->notify();
+    return true;
 }
 
+// Waits for room instead of applying the overflow policy, these events must not be lost.
 void CorePlugin::pushToMainQueueBlocking(ServerEventWrapper &&ev) {
     crill::progressive_backoff_wait([&] {
-        if (!dPtr->sharedData->isValid())
+        if (!dPtr->sharedData->isValid() || !dPtr->sharedData->pluginMainToClientsQueue().tryPush(std::move(ev)))
             return false;
-        return pushToMainQueue(std::move(ev));
+        dPtr->sharedData->notify();
+        return true;
     });
 }
 
-void CorePlugin::pushToProcessQueue(ServerEventWrapper &&ev)
+// Events that don't fit are handled by the overflow policy of the queue and show up in
+// its counters, see SharedData::queueStats().
+void CorePlugin::pushToProcessQueue(ProcessEventRecord ev)
 {
-    dPtr->sharedData->pluginToClientsQueue().push(std::move(ev));
+    ev.time = dPtr->blockTime;
+    if (dPtr->sharedData->pluginToClientsQueue().push(std::move(ev)))
+        dPtr->sharedData->notify();
 }
 
-void CorePlugin::enqueueAuxiliaries()
+// Copies the params registered so far into a snapshot for GetParamInfos. Only the
+// first call after a param was added does any work.
+void CorePlugin::publishParamInfos()
 {
-    for (const auto &p : dPtr->params) {
-        pushToMainQueueBlocking({Event::ParamInfo, ClapEventParamInfoWrapper {
-            .paramId = p->paramInfo().id,
-            .name = p->paramInfo().name,
-            .module = p->paramInfo().module,
-            .minValue = p->paramInfo().min_value,
-            .maxValue = p->paramInfo().max_value,
-            .defaultValue = p->paramInfo().default_value
-        }});
-    }
+    if (dPtr->paramInfosPublished || !dPtr->sharedData)
+        return;
+    dPtr->sharedData->setParamInfos(std::make_shared<const ParamInfoSnapshot>(dPtr->paramInfos));
+    dPtr->paramInfosPublished = true;
 }
 
 uint32_t CorePlugin::notePortsCount(bool is_input) const noexcept
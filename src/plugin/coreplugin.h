@@ -42,9 +42,11 @@ public:
     bool startProcessing() noexcept override;
     void stopProcessing() noexcept override;
     void reset() noexcept override;
-    void processGuiEvents(const clap_output_events *ov);
+    void processGuiEvents();
     clap_process_status process(const clap_process *process) noexcept override;
     void processEvent(const clap_event_header_t *evHdr) noexcept;
+    // Client params the host refused to take in its out_events. They were still applied.
+    uint64_t droppedClientParams() const noexcept;
 
     // #### PARAMS ####
     bool implementsParams() const noexcept override { return true; }
@@ -79,6 +81,8 @@ public:
     std::vector<clap_note_port_info>& notePortsInfoOut() noexcept;
 
     void logInfo();
+    // The key of this instance with the ServerCtrl.
+    uint64_t hashId() const noexcept;
 
 protected:
     std::unique_ptr<CorePluginPrivate> dPtr;
@@ -86,8 +90,10 @@ protected:
 private:
     bool pushToMainQueue(ServerEventWrapper &&ev);
     void pushToMainQueueBlocking(ServerEventWrapper &&ev);
-    void pushToProcessQueue(ServerEventWrapper &&ev);
-    void enqueueAuxiliaries();
+    void pushToProcessQueue(ProcessEventRecord ev);
+    void publishParamInfos();
+    uint32_t clientParamFrame(const ClientParamWrapper &ev) const noexcept;
+    void applyClientParam(const ClientParamWrapper &ev, uint32_t frame, const clap_output_events *ov);
 };
 
 RCLAP_END_NAMESPACE
@@ -4,6 +4,7 @@
 #include <core/global.h>
 #include <clap/ext/params.h>
 #include "decibel_valuetype.h"
+#include <server/paramstate.h>
 
 #include <memory>
 
@@ -28,17 +29,39 @@ public:
     {
         if (m_value == value)
             return false;
-        m_value = value;
+        setValue(value);
         return true;
     }
-    void setValue(double value) noexcept { m_value = value; }
-    void setModulation(double modulation) noexcept { mMod = modulation; }
+    void setValue(double value) noexcept
+    {
+        m_value = value;
+        if (mState)
+            mStateVersion = mStates->setValue(*mState, value);
+    }
+    void setModulation(double modulation) noexcept
+    {
+        mMod = modulation;
+        if (mState)
+            mStateVersion = mStates->setModulation(*mState, modulation);
+    }
+
+    // Mirrors every change into \a state of \a table, for clients that connect later.
+    void attachState(ParamStateTable *table, ParamState *state) noexcept
+    {
+        mStates = table;
+        mState = state;
+    }
+    // The version of the last change, 0 if the state isn't tracked.
+    std::uint64_t stateVersion() const noexcept { return mStateVersion; }
 private:
     int32_t m_index;
     clap_param_info m_info;
     std::unique_ptr<ValueType> m_valueType;
     double m_value;
     double mMod = 0.0;
+    ParamStateTable *mStates = nullptr;
+    ParamState *mState = nullptr;
+    std::uint64_t mStateVersion = 0;
 };
 
 RCLAP_END_NAMESPACE
@@ -2,6 +2,7 @@
 #define PATHPROVIDER_H
 
 #include <core/global.h>
+#include "server/queueoptions.h"
 
 #include <string_view>
 #include <filesystem>
@@ -118,6 +119,34 @@ public:
         return *this;
     }
 
+    // Hands a shared memory ring of the given size to the GUI process at spawn. The GUI
+    // receives the process events through it if it connects with ClientRequest.shared_memory.
+    Settings &withSharedMemoryRing(std::size_t capacityBytes) noexcept
+    {
+        mShmRingCapacity = capacityBytes;
+        return *this;
+    }
+
+    std::optional<std::size_t> sharedMemoryRing() const
+    {
+        if (mShmRingCapacity == 0)
+            return std::nullopt;
+        return mShmRingCapacity;
+    }
+
+    // Capacities and overflow policies of the event queues of the instance. The defaults
+    // hold 64 events each and drop new process events when full.
+    Settings &withQueues(const QueueConfig &queues) noexcept
+    {
+        mQueues = queues;
+        return *this;
+    }
+
+    const QueueConfig &queues() const noexcept
+    {
+        return mQueues;
+    }
+
     std::string_view clapPath() const
     {
         return mClapPath;
@@ -168,6 +197,8 @@ private:
     std::string mPluginDirectory;
     std::string mLogDir;
     std::string mlogFile = "plugin.log";
+    std::size_t mShmRingCapacity = 0;
+    QueueConfig mQueues;
 };
 
 RCLAP_END_NAMESPACE
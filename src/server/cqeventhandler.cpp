@@ -2,95 +2,138 @@
 
 #include "server.h"
 #include "cqeventhandler.h"
-#include "tags/clienteventcall.h"
-#include "tags/clientparamcall.h"
-#include "tags/servereventstream.h"
 
+#include <chrono>
 #include <utility>
 
 RCLAP_BEGIN_NAMESPACE
 
+namespace {
+
+std::uint64_t nowNs() noexcept
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count());
+}
+
+} // namespace
+
 CqEventHandler::CqEventHandler(Server *parent, std::unique_ptr<grpc::ServerCompletionQueue> cq)
-    : parent(parent), cq(std::move(cq))
+    : parent(parent), cq(std::move(cq)), mTimers(1024, nowNs() / TimerTickNs),
+      mTimerTag(this, [this](bool ok) { onTimerAlarm(ok); })
 {
     if (!Log::Private::gLoggerSetup)
         Log::setupLogger("cqeventhandler");
+    mFiring.reserve(mTimers.capacity());
 }
 
-CqEventHandler::CqEventHandler(CqEventHandler &&other) noexcept
+TimerWheel::Id CqEventHandler::enqueueFn(EventTag::FnType &&f, std::uint64_t deferNs /*= 0*/)
 {
-    *this = std::move(other);
+    const auto now = nowNs();
+    const auto expiry = (now + deferNs + TimerTickNs - 1) / TimerTickNs;
+    std::scoped_lock lock(mAlarmMtx);
+    if (mShutdown)
+        return TimerWheel::InvalidId;
+    // An idle wheel lags behind, catch up so the new timer lands in the right level.
+    if (mTimers.empty() && !mFiringTimers)
+        mTimers.advance(now / TimerTickNs, mFiring);
+    const auto id = mTimers.add(std::move(f), expiry);
+    armTimer();
+    return id;
 }
 
-CqEventHandler &CqEventHandler::operator=(CqEventHandler &&other) noexcept
+bool CqEventHandler::cancelFn(TimerWheel::Id id)
 {
-    if (this == &other)
-        return *this;
-    parent = std::exchange(other.parent, nullptr);
-    cq = std::move(other.cq);
-    pendingAlarmTags = std::move(other.pendingAlarmTags);
-    pendingTags = std::move(other.pendingTags);
-    return *this;
+    std::scoped_lock lock(mAlarmMtx);
+    return mTimers.cancel(id);
 }
 
-bool CqEventHandler::enqueueFn(EventTag::FnType &&f, std::uint64_t deferNs /*= 0*/)
+// Arms the alarm for the next expiry of the wheel. An alarm can't be moved, so if it's
+// armed too late it is cancelled and re-armed once the cancellation arrived.
+void CqEventHandler::armTimer()
 {
-    // Ref: https://www.gresearch.com/blog/article/lessons-learnt-from-writing-asynchronous-streaming-grpc-services-in-c/
-    auto eventFn = pendingAlarmTags.try_emplace(
-        std::make_unique<EventTag>(this, std::move(f)),
-        grpc::Alarm()
-    );
-
-    if (!eventFn.second) {
-        SPDLOG_ERROR("Failed to enqueue AlarmTag");
-        return false;
+    if (mFiringTimers || mShutdown) // Re-armed after firing
+        return;
+    const auto now = nowNs() / TimerTickNs;
+    const auto next = mCancelTimers ? std::optional(now) : mTimers.nextExpiry();
+    if (!next)
+        return;
+    if (mTimerArmed) {
+        if (*next < mArmedTick && !mRearmPending) {
+            mRearmPending = true;
+            mTimerAlarm.Cancel();
+        }
+        return;
     }
+    mTimerArmed = true;
+    mArmedTick = *next;
+    setAlarm(mTimerAlarm, &mTimerTag, *next > now ? (*next - now) * TimerTickNs : 0);
+}
 
-    if (deferNs == 0) { // Execute the function immediately.
-        eventFn.first->second.Set(
-            cq.get(), gpr_now(gpr_clock_type::GPR_CLOCK_REALTIME), toTag(eventFn.first->first.get())
-        );
-    } else { // Otherwise, defer the function for deferNs nanoseconds. Note that this is using a syscall
-        const auto tp = gpr_time_from_nanos(deferNs, GPR_TIMESPAN);
-        eventFn.first->second.Set(cq.get(), tp, toTag(eventFn.first->first.get()));
+// ok is false if the alarm was cancelled, to re-arm it earlier or to cancel all
+// timers. Fire what's due either way. Once the queue is shut down the alarm can't be
+// armed again, all remaining timers fire with ok == false.
+void CqEventHandler::onTimerAlarm([[maybe_unused]] bool ok)
+{
+    bool fireOk = true;
+    {
+        std::scoped_lock lock(mAlarmMtx);
+        mTimerArmed = false;
+        mRearmPending = false;
+        if (mCancelTimers || mShutdown) {
+            mCancelTimers = false;
+            fireOk = false;
+            mTimers.clear(mFiring);
+        } else {
+            mTimers.advance(nowNs() / TimerTickNs, mFiring);
+        }
+        mFiringTimers = true;
     }
 
-    return true;
+    // The functions may defer new ones.
+    for (auto &f : mFiring)
+        f(fireOk);
+    mFiring.clear();
+
+    std::scoped_lock lock(mAlarmMtx);
+    mFiringTimers = false;
+    armTimer();
 }
-// TODO: This is not optimal, find a better way to organize and sync with shareddata...
-// See also servereventstream::kill
-bool CqEventHandler::destroyTag(std::uint64_t hash)
+
+void CqEventHandler::setAlarmNow(grpc::Alarm &alarm, EventTag *tag)
 {
-    if (pendingTags.erase(hash) != 0) { // We have removed something
-        return true;
-    }
-    SPDLOG_ERROR("Failed to destroyTag tag {}", hash);
-    return false;
+    alarm.Set(cq.get(), gpr_now(gpr_clock_type::GPR_CLOCK_REALTIME), toTag(tag));
 }
 
-bool CqEventHandler::destroyAlarmTag(EventTag *tag)
+void CqEventHandler::setAlarm(grpc::Alarm &alarm, EventTag *tag, std::uint64_t deferNs)
 {
-    auto findFromRawTag = [tag](const auto &pair) {
-        return pair.first.get() == tag;
-    };
-
-    auto it = std::find_if(pendingAlarmTags.begin(), pendingAlarmTags.end(), findFromRawTag);
-    if (it == pendingAlarmTags.end()) {
-        SPDLOG_WARN("Failed to destroy AlarmTag tag {}", toTag(tag));
-        return false;
-    }
-    pendingAlarmTags.erase(it);
-    return true;
+    if (deferNs == 0)
+        return setAlarmNow(alarm, tag);
+    alarm.Set(cq.get(), gpr_time_from_nanos(static_cast<std::int64_t>(deferNs), GPR_TIMESPAN), toTag(tag));
 }
 
 void CqEventHandler::cancelAllPendingTags()
 {
-    for (auto &pair : pendingAlarmTags)
-        pair.second.Cancel();
+    std::scoped_lock lock(mAlarmMtx);
+    if (mTimers.empty())
+        return;
+    mCancelTimers = true;
+    if (mTimerArmed && !mRearmPending) {
+        mRearmPending = true;
+        mTimerAlarm.Cancel();
+    } else {
+        armTimer();
+    }
 }
 
 void CqEventHandler::teardown()
 {
+    {
+        // Other threads may still defer functions, e.g. the main thread completing a call.
+        std::scoped_lock lock(mAlarmMtx);
+        mShutdown = true;
+    }
     cq->Shutdown();
     // Drains all remaining events from the completion queue. If any
     void *rawTag = nullptr;
@@ -114,33 +157,23 @@ void CqEventHandler::run()
     }
 
     // We are finished. All tags must be destroyed by now!.
-    while(!pendingTags.empty() && !pendingAlarmTags.empty()) {
-        SPDLOG_WARN("Pending Tags: {}, Pending Alarms: {}", pendingTags.size(), pendingAlarmTags.size());
+    while(activeHandlers() != 0 && hasPendingAlarms()) {
+        SPDLOG_WARN("Pending Tags: {}", activeHandlers());
     }
 
     state = SHUTDOWN;
 }
 
-ClapInterface::AsyncService *CqEventHandler::service() noexcept
+AsyncService *CqEventHandler::service() noexcept
 {
     return parent->service();
 }
 
 template <typename T>
 bool CqEventHandler::create()
-{ return false; }
-
-template <>
-bool CqEventHandler::create<ClientEventCallHandler>()
 {
     try {
-        auto client = std::make_unique<ClientEventCallHandler>(this, cq.get());
-        const auto h = client->hash();
-        auto res = pendingTags.try_emplace(h, std::move(client));
-        if (!res.second) {
-            SPDLOG_ERROR("Failed to create UnaryCallHandler");
-            return false;
-        }
+        std::get<HandlerPool<T>>(mHandlers).acquire(this, cq.get());
     } catch (const std::exception &e) {
         SPDLOG_CRITICAL("{}", e.what());
         return false;
@@ -148,40 +181,14 @@ bool CqEventHandler::create<ClientEventCallHandler>()
     return true;
 }
 
-template <>
-bool CqEventHandler::create<ClientParamCall>()
-{
-    try {
-        auto client = std::make_unique<ClientParamCall>(this, cq.get());
-        const auto h = client->hash();
-        auto res = pendingTags.try_emplace(h, std::move(client));
-        if (!res.second) {
-            SPDLOG_ERROR("Failed to create UnaryCallHandler");
-            return false;
-        }
-    } catch (const std::exception &e) {
-        SPDLOG_CRITICAL("{}", e.what());
-        return false;
-    }
-    return true;
-}
-
-template <>
-bool CqEventHandler::create<ServerEventStream>()
-{
-    try {
-        auto client = std::make_unique<ServerEventStream>(this, cq.get());
-        const auto h = client->hash();
-        auto res = pendingTags.try_emplace(h, std::move(client));
-        if (!res.second) {
-            SPDLOG_ERROR("Failed to create ServerEventStream");
-            return false;
-        }
-    } catch (const std::exception &e) {
-        SPDLOG_CRITICAL("{}", e.what());
-        return false;
-    }
-    return true;
-}
+template bool CqEventHandler::create<ClientEventCallHandler>();
+template bool CqEventHandler::create<ClientParamCall>();
+template bool CqEventHandler::create<ClientParamStream>();
+template bool CqEventHandler::create<GetParamInfos>();
+template bool CqEventHandler::create<GetParamStates>();
+template bool CqEventHandler::create<OpenSession>();
+template bool CqEventHandler::create<CloseSession>();
+template bool CqEventHandler::create<GetQueueStats>();
+template bool CqEventHandler::create<ServerEventStream>();
 
 RCLAP_END_NAMESPACE
@@ -5,21 +5,64 @@
 #include <api.grpc.pb.h>
 using namespace api::v0;
 
+#include "service.h"
 #include "tags/eventtag.h"
+#include "tags/clienteventcall.h"
+#include "tags/clientparamcall.h"
+#include "tags/clientparamstream.h"
+#include "tags/getparaminfos.h"
+#include "tags/getparamstates.h"
+#include "tags/opensession.h"
+#include "tags/closesession.h"
+#include "tags/getqueuestats.h"
+#include "tags/servereventstream.h"
+#include "timerwheel.h"
 #include <core/global.h>
 
 #include <absl/container/flat_hash_map.h>
 #include <grpcpp/grpcpp.h>
 #include <grpcpp/alarm.h>
 
-#include <map>
+#include <deque>
+#include <vector>
 #include <memory>
 #include <functional>
+#include <mutex>
+#include <tuple>
 
 RCLAP_BEGIN_NAMESPACE
 
 class Server;
 
+// Slab of RPC handlers of a single type. Handlers keep their address for the lifetime
+// of the queue. Finished handlers are reset and put on a free list, the next acquire()
+// re-arms them with a new Request* instead of constructing a handler.
+template <typename T>
+class HandlerPool
+{
+public:
+    T *acquire(CqEventHandler *parent, grpc::ServerCompletionQueue *cq)
+    {
+        if (mFree.empty()) // Arms itself
+            return &mSlab.emplace_back(parent, cq);
+        auto *handler = mFree.back();
+        mFree.pop_back();
+        handler->rearm();
+        return handler;
+    }
+    void release(T *handler)
+    {
+        handler->reset();
+        mFree.push_back(handler);
+    }
+    [[nodiscard]] std::size_t size() const noexcept { return mSlab.size(); }
+    [[nodiscard]] std::size_t active() const noexcept { return mSlab.size() - mFree.size(); }
+
+private:
+    std::deque<T> mSlab;
+    std::vector<T *> mFree;
+};
+
 // Base for all handlers on a completion queue.
 class CqEventHandler
 {
@@ -29,37 +72,77 @@ public:
     CqEventHandler(Server *parent, std::unique_ptr<grpc::ServerCompletionQueue> cq);
     ~CqEventHandler() = default;
 
-    CqEventHandler(CqEventHandler &&other) noexcept ;
-    CqEventHandler &operator=(CqEventHandler &&other) noexcept ;
-
+    // The timer alarm is bound to this instance.
+    CqEventHandler(CqEventHandler &&other) = delete;
+    CqEventHandler &operator=(CqEventHandler &&other) = delete;
     CqEventHandler(const CqEventHandler &) = delete;
     CqEventHandler &operator=(const CqEventHandler &) = delete;
 
-    // Defers \a f to be called after \a deferMs milliseconds.
-    bool enqueueFn(EventTag::FnType &&f, std::uint64_t deferNs = 0);
-    bool destroyTag(std::uint64_t hash);
-    bool destroyAlarmTag(EventTag *tag);
+    // Defers \a f to be called after \a deferNs nanoseconds. Thread-safe. The functions
+    // live in the slots of a timer wheel that is driven by a single alarm, and are
+    // called on the thread of this queue. Returns TimerWheel::InvalidId on failure,
+    // or once the queue was shut down.
+    TimerWheel::Id enqueueFn(EventTag::FnType &&f, std::uint64_t deferNs = 0);
+    // Removes a deferred function without calling it. Thread-safe and O(1).
+    bool cancelFn(TimerWheel::Id id);
+    // Fires \a alarm immediately with \a tag. Both are owned by the caller.
+    void setAlarmNow(grpc::Alarm &alarm, EventTag *tag);
+    // Fires \a alarm with \a tag after \a deferNs nanoseconds. Both are owned by the caller.
+    void setAlarm(grpc::Alarm &alarm, EventTag *tag, std::uint64_t deferNs);
+    // Calls all deferred functions with ok == false.
     void cancelAllPendingTags();
     void teardown();
-    bool hasPendingAlarms() const noexcept { return !pendingAlarmTags.empty(); }
+    bool hasPendingAlarms() const noexcept
+    {
+        std::scoped_lock lock(mAlarmMtx);
+        return !mTimers.empty() || mFiringTimers;
+    }
     State getState() const noexcept { return state; }
 
-    ClapInterface::AsyncService *service() noexcept;
+    AsyncService *service() noexcept;
 
     // The main loop of the completion queue. This will block until the completion queue
     // is shutdown.
     void run();
 
-    // Create a new RPC - handler. Returns true on success, false otherwise.
+    // Arms an RPC - handler, a finished one if available. Returns true on success, false otherwise.
+    // Only called from the thread of this queue, or before it runs.
     template <typename T>
     bool create();
+    // Returns a finished handler to its pool. Called by the handler's kill().
+    template <typename T>
+    void recycle(T *handler) { std::get<HandlerPool<T>>(mHandlers).release(handler); }
+    // Number of handlers ever constructed for T, active or pooled.
+    template <typename T>
+    [[nodiscard]] std::size_t pooledHandlers() const noexcept { return std::get<HandlerPool<T>>(mHandlers).size(); }
+    [[nodiscard]] std::size_t activeHandlers() const noexcept
+    {
+        return std::apply([](const auto &...pool) { return (pool.active() + ...); }, mHandlers);
+    }
 
 private:
     Server *parent = nullptr;
     std::unique_ptr<grpc::ServerCompletionQueue> cq;
 
-    std::map<std::unique_ptr<EventTag>, grpc::Alarm> pendingAlarmTags;
-    std::map<std::uint64_t, std::unique_ptr<EventTag>> pendingTags;
+    void onTimerAlarm(bool ok);
+    void armTimer();
+
+    // Deferred functions, in ticks of TimerTickNs
+    static constexpr std::uint64_t TimerTickNs = 1'000;
+    TimerWheel mTimers;
+    std::vector<TimerWheel::Fn> mFiring; // Only touched by the queue thread
+    PersistentEventTag mTimerTag;
+    grpc::Alarm mTimerAlarm;
+    std::uint64_t mArmedTick = 0;
+    bool mTimerArmed = false;
+    bool mRearmPending = false;
+    bool mCancelTimers = false;
+    bool mFiringTimers = false;
+    bool mShutdown = false; // No alarms can be set on a shutdown queue
+    mutable std::mutex mAlarmMtx;
+    std::tuple<HandlerPool<ClientEventCallHandler>, HandlerPool<ClientParamCall>, HandlerPool<ClientParamStream>,
+               HandlerPool<GetParamInfos>, HandlerPool<GetParamStates>, HandlerPool<OpenSession>, HandlerPool<CloseSession>,
+               HandlerPool<GetQueueStats>, HandlerPool<ServerEventStream>> mHandlers;
 
     std::atomic<State> state = STARTUP;
     static_assert(std::atomic<State>::is_always_lock_free);
@@ -0,0 +1,402 @@
+#include "eventencoder.h"
+
+#include <cassert>
+#include <cstring>
+#include <type_traits>
+
+RCLAP_BEGIN_NAMESPACE
+
+// Wire format reference: https://protobuf.dev/programming-guides/encoding/
+// All field numbers of api.proto used here are < 16, so every tag fits into a single byte.
+// The only exception are the PackedEvents columns, written through writeHeader().
+// Proto3 scalars are skipped if they hold their default value, doubles are compared
+// bitwise (-0.0 is written), just like the generated serializers do.
+namespace {
+
+enum WireType : std::uint8_t { Varint = 0, Fixed64 = 1, LengthDelimited = 2 };
+
+constexpr std::uint8_t tag(std::uint32_t field, WireType type)
+{
+    assert(field < 16);
+    return static_cast<std::uint8_t>((field << 3) | type);
+}
+
+constexpr std::size_t varintSize(std::uint64_t v)
+{
+    std::size_t n = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        ++n;
+    }
+    return n;
+}
+
+// Negative int32 and enum values are sign-extended to 10 bytes.
+constexpr std::uint64_t fromInt(std::int64_t v) { return static_cast<std::uint64_t>(v); }
+
+std::uint64_t rawBits(double v)
+{
+    std::uint64_t raw = 0;
+    std::memcpy(&raw, &v, sizeof(v));
+    return raw;
+}
+
+constexpr std::size_t varintField(std::uint64_t v) { return v == 0 ? 0 : 1 + varintSize(v); }
+std::size_t doubleField(double v) { return rawBits(v) == 0 ? 0 : 1 + sizeof(std::uint64_t); }
+constexpr std::size_t stringField(std::size_t len) { return len == 0 ? 0 : 1 + varintSize(len) + len; }
+constexpr std::size_t messageField(std::size_t len) { return 1 + varintSize(len) + len; }
+
+std::uint8_t *writeVarint(std::uint8_t *p, std::uint64_t v)
+{
+    while (v >= 0x80) {
+        *p++ = static_cast<std::uint8_t>(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = static_cast<std::uint8_t>(v);
+    return p;
+}
+
+std::uint8_t *writeVarintField(std::uint8_t *p, std::uint32_t field, std::uint64_t v)
+{
+    if (v == 0)
+        return p;
+    *p++ = tag(field, Varint);
+    return writeVarint(p, v);
+}
+
+std::uint8_t *writeDoubleField(std::uint8_t *p, std::uint32_t field, double v)
+{
+    const auto raw = rawBits(v);
+    if (raw == 0)
+        return p;
+    *p++ = tag(field, Fixed64);
+    for (std::size_t i = 0; i < sizeof(raw); ++i)
+        *p++ = static_cast<std::uint8_t>(raw >> (8 * i));
+    return p;
+}
+
+std::uint8_t *writeStringField(std::uint8_t *p, std::uint32_t field, const std::string &v)
+{
+    if (v.empty())
+        return p;
+    *p++ = tag(field, LengthDelimited);
+    p = writeVarint(p, v.size());
+    std::memcpy(p, v.data(), v.size());
+    return p + v.size();
+}
+
+constexpr std::size_t tagSize(std::uint32_t field) { return varintSize(field << 3); }
+
+std::uint8_t *writeHeader(std::uint8_t *p, std::uint32_t field, std::size_t len)
+{
+    p = writeVarint(p, (field << 3) | LengthDelimited);
+    return writeVarint(p, len);
+}
+
+// ClapEventNote
+std::size_t payloadSize(const ClapEventNoteWrapper &n)
+{
+    return varintField(fromInt(n.noteId)) + varintField(fromInt(n.portIndex))
+        + varintField(fromInt(n.channel)) + varintField(fromInt(n.key)) + doubleField(n.value)
+        + varintField(fromInt(n.getType())) + varintField(fromInt(n.getExpressionType()));
+}
+
+std::uint8_t *writePayload(std::uint8_t *p, const ClapEventNoteWrapper &n)
+{
+    p = writeVarintField(p, 1, fromInt(n.noteId));
+    p = writeVarintField(p, 2, fromInt(n.portIndex));
+    p = writeVarintField(p, 3, fromInt(n.channel));
+    p = writeVarintField(p, 4, fromInt(n.key));
+    p = writeDoubleField(p, 5, n.value);
+    p = writeVarintField(p, 6, fromInt(n.getType()));
+    return writeVarintField(p, 7, fromInt(n.getExpressionType()));
+}
+
+// ClapEventParam
+std::size_t payloadSize(const ClapEventParamWrapper &pm)
+{
+    return varintField(fromInt(pm.type)) + varintField(pm.paramId) + doubleField(pm.value)
+        + doubleField(pm.modulation) + varintField(pm.version);
+}
+
+std::uint8_t *writePayload(std::uint8_t *p, const ClapEventParamWrapper &pm)
+{
+    p = writeVarintField(p, 1, fromInt(pm.type));
+    p = writeVarintField(p, 2, pm.paramId);
+    p = writeDoubleField(p, 3, pm.value);
+    p = writeDoubleField(p, 4, pm.modulation);
+    return writeVarintField(p, 5, pm.version);
+}
+
+// ClapEventParamInfo
+std::size_t payloadSize(const ClapEventParamInfoWrapper &pi)
+{
+    return varintField(pi.paramId) + stringField(pi.name.size()) + stringField(pi.module.size())
+        + doubleField(pi.minValue) + doubleField(pi.maxValue) + doubleField(pi.defaultValue);
+}
+
+std::uint8_t *writePayload(std::uint8_t *p, const ClapEventParamInfoWrapper &pi)
+{
+    p = writeVarintField(p, 1, pi.paramId);
+    p = writeStringField(p, 2, pi.name);
+    p = writeStringField(p, 3, pi.module);
+    p = writeDoubleField(p, 4, pi.minValue);
+    p = writeDoubleField(p, 5, pi.maxValue);
+    return writeDoubleField(p, 6, pi.defaultValue);
+}
+
+// ClapEventMainSync
+std::size_t payloadSize(const ClapEventMainSyncWrapper &ms)
+{
+    return varintField(fromInt(ms.windowId));
+}
+
+std::uint8_t *writePayload(std::uint8_t *p, const ClapEventMainSyncWrapper &ms)
+{
+    return writeVarintField(p, 1, fromInt(ms.windowId));
+}
+
+// The oneof field number of each payload inside ServerEvent.
+template <typename T>
+constexpr std::uint32_t payloadField()
+{
+    if constexpr (std::is_same_v<T, ClapEventNoteWrapper>)
+        return 2;
+    else if constexpr (std::is_same_v<T, ClapEventParamWrapper>)
+        return 3;
+    else if constexpr (std::is_same_v<T, ClapEventParamInfoWrapper>)
+        return 4;
+    else
+        return 5;
+}
+
+constexpr std::uint32_t ServerEventsEventsField = 1;
+constexpr std::uint32_t ServerEventsPackedField = 2;
+constexpr std::uint32_t ServerEventsSeqField = 4;
+constexpr std::uint32_t ServerEventEventField = 1;
+constexpr std::uint32_t ServerEventFrameField = 6;
+constexpr std::uint32_t ServerEventBlockField = 7;
+constexpr std::uint32_t ServerEventTimeField = 8;
+
+// PackedEvents columns
+constexpr std::uint32_t zigzag(std::int32_t v)
+{
+    return (static_cast<std::uint32_t>(v) << 1) ^ static_cast<std::uint32_t>(v >> 31);
+}
+
+template <typename T>
+    requires std::is_integral_v<T>
+std::size_t columnSize(const std::vector<T> &col)
+{
+    std::size_t n = 0;
+    for (const auto v : col)
+        n += varintSize(v);
+    return n;
+}
+
+std::size_t columnSize(const std::vector<float> &col)
+{
+    return col.size() * sizeof(float);
+}
+
+template <typename T>
+std::size_t packedField(std::uint32_t field, const std::vector<T> &col)
+{
+    if (col.empty())
+        return 0;
+    const auto len = columnSize(col);
+    return tagSize(field) + varintSize(len) + len;
+}
+
+template <typename T>
+    requires std::is_integral_v<T>
+std::uint8_t *writeColumn(std::uint8_t *p, std::uint32_t field, const std::vector<T> &col)
+{
+    if (col.empty())
+        return p;
+    p = writeHeader(p, field, columnSize(col));
+    for (const auto v : col)
+        p = writeVarint(p, v);
+    return p;
+}
+
+std::uint8_t *writeColumn(std::uint8_t *p, std::uint32_t field, const std::vector<float> &col)
+{
+    if (col.empty())
+        return p;
+    p = writeHeader(p, field, columnSize(col));
+    for (const auto v : col) {
+        std::uint32_t raw = 0;
+        std::memcpy(&raw, &v, sizeof(v));
+        for (std::size_t i = 0; i < sizeof(raw); ++i)
+            *p++ = static_cast<std::uint8_t>(raw >> (8 * i));
+    }
+    return p;
+}
+
+} // namespace
+
+EventEncoder::EventEncoder(std::size_t reserveBytes)
+{
+    mBuffer.reserve(reserveBytes);
+}
+
+std::size_t EventEncoder::eventSize(const ServerEventWrapper &ev) noexcept
+{
+    return varintField(fromInt(ev.ev)) + std::visit([](const auto &arg) {
+        return messageField(payloadSize(arg));
+    }, ev.data) + varintField(ev.frameOffset()) + varintField(ev.time.block) + varintField(ev.time.timeNs);
+}
+
+void EventEncoder::add(const ServerEventWrapper &ev)
+{
+    const auto evSize = eventSize(ev);
+    const auto offset = mBuffer.size();
+    mBuffer.resize(offset + messageField(evSize));
+
+    auto *p = reinterpret_cast<std::uint8_t *>(mBuffer.data()) + offset;
+    p = writeHeader(p, ServerEventsEventsField, evSize);
+    p = writeVarintField(p, ServerEventEventField, fromInt(ev.ev));
+    std::visit([&p](const auto &arg) {
+        using T = std::decay_t<decltype(arg)>;
+        p = writeHeader(p, payloadField<T>(), payloadSize(arg));
+        p = writePayload(p, arg);
+    }, ev.data);
+    p = writeVarintField(p, ServerEventFrameField, ev.frameOffset());
+    p = writeVarintField(p, ServerEventBlockField, ev.time.block);
+    p = writeVarintField(p, ServerEventTimeField, ev.time.timeNs);
+    assert(p == reinterpret_cast<std::uint8_t *>(mBuffer.data()) + mBuffer.size());
+    ++mCount;
+}
+
+void EventEncoder::setSeq(std::uint64_t seq)
+{
+    const auto offset = mBuffer.size();
+    mBuffer.resize(offset + varintField(seq));
+    auto *p = reinterpret_cast<std::uint8_t *>(mBuffer.data()) + offset;
+    p = writeVarintField(p, ServerEventsSeqField, seq);
+    assert(p == reinterpret_cast<std::uint8_t *>(mBuffer.data()) + mBuffer.size());
+}
+
+void EventEncoder::clear() noexcept
+{
+    mBuffer.clear();
+    mCount = 0;
+}
+
+grpc::ByteBuffer EventEncoder::toByteBuffer() const
+{
+    grpc::Slice slice(mBuffer.data(), mBuffer.size());
+    return grpc::ByteBuffer(&slice, 1);
+}
+
+PackedEventEncoder::PackedEventEncoder(std::size_t reserveEvents)
+    : mOther(1024)
+{
+    auto reserve = [reserveEvents](auto &...cols) { (cols.reserve(reserveEvents), ...); };
+    reserve(mParams.ids, mParams.types, mParams.values, mParams.frames, mParams.blocks, mParams.versions);
+    reserve(mNotes.ids, mNotes.ports, mNotes.channels, mNotes.keys, mNotes.types, mNotes.expressions,
+            mNotes.values, mNotes.frames, mNotes.blocks);
+}
+
+void PackedEventEncoder::addBlock(const EventTime &time)
+{
+    if (time.block == 0 || (!mBlocks.empty() && mBlocks.back() == time.block))
+        return;
+    mBlocks.push_back(time.block);
+    mBlockTimes.push_back(time.timeNs);
+}
+
+void PackedEventEncoder::add(const ServerEventWrapper &ev)
+{
+    if (const auto *pm = std::get_if<ClapEventParamWrapper>(&ev.data); pm && ev.ev == Event::Param) {
+        mParams.ids.push_back(pm->paramId);
+        mParams.types.push_back(static_cast<std::uint32_t>(pm->type));
+        mParams.values.push_back(static_cast<float>(
+            pm->type == ClapEventParam_Type_Modulation ? pm->modulation : pm->value));
+        mParams.frames.push_back(pm->frameOffset);
+        mParams.blocks.push_back(ev.time.block);
+        mParams.versions.push_back(pm->version);
+        addBlock(ev.time);
+    } else if (const auto *n = std::get_if<ClapEventNoteWrapper>(&ev.data); n && ev.ev == Event::Note) {
+        mNotes.ids.push_back(zigzag(n->noteId));
+        mNotes.ports.push_back(zigzag(n->portIndex));
+        mNotes.channels.push_back(zigzag(n->channel));
+        mNotes.keys.push_back(zigzag(n->key));
+        mNotes.types.push_back(n->type);
+        mNotes.expressions.push_back(zigzag(n->expression));
+        mNotes.values.push_back(static_cast<float>(n->value));
+        mNotes.frames.push_back(n->frameOffset);
+        mNotes.blocks.push_back(ev.time.block);
+        addBlock(ev.time);
+    } else {
+        mOther.add(ev);
+    }
+}
+
+void PackedEventEncoder::clear() noexcept
+{
+    auto clearAll = [](auto &...cols) { (cols.clear(), ...); };
+    clearAll(mParams.ids, mParams.types, mParams.values, mParams.frames, mParams.blocks, mParams.versions);
+    clearAll(mNotes.ids, mNotes.ports, mNotes.channels, mNotes.keys, mNotes.types, mNotes.expressions,
+             mNotes.values, mNotes.frames, mNotes.blocks);
+    clearAll(mBlocks, mBlockTimes);
+    mOther.clear();
+    mBuffer.clear();
+    mSeq = 0;
+}
+
+std::string_view PackedEventEncoder::finish()
+{
+    mBuffer.assign(mOther.bytes());
+    if (!mParams.ids.empty() || !mNotes.ids.empty())
+        writePacked();
+    if (mSeq != 0) {
+        const auto offset = mBuffer.size();
+        mBuffer.resize(offset + varintField(mSeq));
+        writeVarintField(reinterpret_cast<std::uint8_t *>(mBuffer.data()) + offset, ServerEventsSeqField, mSeq);
+    }
+    return mBuffer;
+}
+
+void PackedEventEncoder::writePacked()
+{
+    const auto packedSize = packedField(1, mParams.ids) + packedField(2, mParams.types)
+        + packedField(3, mParams.values) + packedField(4, mParams.frames) + packedField(5, mNotes.ids)
+        + packedField(6, mNotes.ports) + packedField(7, mNotes.channels) + packedField(8, mNotes.keys)
+        + packedField(9, mNotes.types) + packedField(10, mNotes.expressions) + packedField(11, mNotes.values)
+        + packedField(12, mNotes.frames) + packedField(13, mParams.blocks) + packedField(14, mNotes.blocks)
+        + packedField(15, mBlocks) + packedField(16, mBlockTimes) + packedField(17, mParams.versions);
+    const auto offset = mBuffer.size();
+    mBuffer.resize(offset + messageField(packedSize));
+
+    auto *p = reinterpret_cast<std::uint8_t *>(mBuffer.data()) + offset;
+    p = writeHeader(p, ServerEventsPackedField, packedSize);
+    p = writeColumn(p, 1, mParams.ids);
+    p = writeColumn(p, 2, mParams.types);
+    p = writeColumn(p, 3, mParams.values);
+    p = writeColumn(p, 4, mParams.frames);
+    p = writeColumn(p, 5, mNotes.ids);
+    p = writeColumn(p, 6, mNotes.ports);
+    p = writeColumn(p, 7, mNotes.channels);
+    p = writeColumn(p, 8, mNotes.keys);
+    p = writeColumn(p, 9, mNotes.types);
+    p = writeColumn(p, 10, mNotes.expressions);
+    p = writeColumn(p, 11, mNotes.values);
+    p = writeColumn(p, 12, mNotes.frames);
+    p = writeColumn(p, 13, mParams.blocks);
+    p = writeColumn(p, 14, mNotes.blocks);
+    p = writeColumn(p, 15, mBlocks);
+    p = writeColumn(p, 16, mBlockTimes);
+    p = writeColumn(p, 17, mParams.versions);
+    assert(p == reinterpret_cast<std::uint8_t *>(mBuffer.data()) + mBuffer.size());
+}
+
+grpc::ByteBuffer PackedEventEncoder::toByteBuffer()
+{
+    const auto bytes = finish();
+    grpc::Slice slice(bytes.data(), bytes.size());
+    return grpc::ByteBuffer(&slice, 1);
+}
+
+RCLAP_END_NAMESPACE
@@ -0,0 +1,105 @@
+#ifndef EVENTENCODER_H
+#define EVENTENCODER_H
+
+#include "wrappers.h"
+#include <core/global.h>
+
+#include <grpcpp/support/byte_buffer.h>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+RCLAP_BEGIN_NAMESPACE
+
+// Encodes ServerEventWrappers straight into the protobuf wire format of a
+// ServerEvents message, without building the message tree first. The output is
+// byte-compatible with ServerEvents::SerializeToString() for the same events.
+// The buffer is reused across batches; clear() keeps its capacity.
+class EventEncoder
+{
+public:
+    explicit EventEncoder(std::size_t reserveBytes = 16 * 1024);
+
+    void add(const ServerEventWrapper &ev);
+    // Appends ServerEvents.seq, after the last add(). Batches that are concatenated
+    // parse as one message with the seq of the last one.
+    void setSeq(std::uint64_t seq);
+    void clear() noexcept;
+
+    [[nodiscard]] bool empty() const noexcept { return mCount == 0; }
+    [[nodiscard]] std::size_t count() const noexcept { return mCount; }
+    [[nodiscard]] std::string_view bytes() const noexcept { return mBuffer; }
+    // Copies the encoded batch into a single slice.
+    [[nodiscard]] grpc::ByteBuffer toByteBuffer() const;
+
+    // Size of a single encoded ServerEvent, without its field tag and length prefix.
+    [[nodiscard]] static std::size_t eventSize(const ServerEventWrapper &ev) noexcept;
+
+private:
+    std::string mBuffer;
+    std::size_t mCount = 0;
+};
+
+// Encodes ServerEventWrappers into a ServerEvents message that carries params and
+// notes in the columns of PackedEvents. All other events are encoded as ServerEvent.
+// The columns are collected first, the message is written by finish().
+class PackedEventEncoder
+{
+public:
+    explicit PackedEventEncoder(std::size_t reserveEvents = 1024);
+
+    void add(const ServerEventWrapper &ev);
+    // Written by finish(), see EventEncoder::setSeq().
+    void setSeq(std::uint64_t seq) noexcept { mSeq = seq; }
+    void clear() noexcept;
+
+    [[nodiscard]] bool empty() const noexcept { return count() == 0; }
+    [[nodiscard]] std::size_t count() const noexcept
+    {
+        return mParams.ids.size() + mNotes.ids.size() + mOther.count();
+    }
+    // Writes the ServerEvents message. The view is valid until the next call to add() or clear().
+    std::string_view finish();
+    grpc::ByteBuffer toByteBuffer();
+
+private:
+    // Varint columns hold the final wire value, sint32 columns are zigzag encoded.
+    struct ParamColumns
+    {
+        std::vector<std::uint32_t> ids;
+        std::vector<std::uint32_t> types;
+        std::vector<float> values;
+        std::vector<std::uint32_t> frames;
+        std::vector<std::uint64_t> blocks;
+        std::vector<std::uint64_t> versions;
+    };
+    struct NoteColumns
+    {
+        std::vector<std::uint32_t> ids;
+        std::vector<std::uint32_t> ports;
+        std::vector<std::uint32_t> channels;
+        std::vector<std::uint32_t> keys;
+        std::vector<std::uint32_t> types;
+        std::vector<std::uint32_t> expressions;
+        std::vector<float> values;
+        std::vector<std::uint32_t> frames;
+        std::vector<std::uint64_t> blocks;
+    };
+
+    void addBlock(const EventTime &time);
+    void writePacked();
+
+    ParamColumns mParams;
+    NoteColumns mNotes;
+    std::vector<std::uint64_t> mBlocks;     // Block table of the rows
+    std::vector<std::uint64_t> mBlockTimes;
+    EventEncoder mOther;
+    std::string mBuffer;
+    std::uint64_t mSeq = 0;
+};
+
+RCLAP_END_NAMESPACE
+
+#endif // EVENTENCODER_H
@@ -0,0 +1,80 @@
+#include "eventfilter.h"
+
+#include <algorithm>
+
+RCLAP_BEGIN_NAMESPACE
+
+EventFilter::EventFilter(const Subscription &subscription)
+{
+    if (subscription.events_size() != 0) {
+        mEvents = 0;
+        for (const auto e : subscription.events()) {
+            if (e >= 0 && e < 64)
+                mEvents |= std::uint64_t(1) << e;
+        }
+    }
+
+    if (subscription.params_size() != 0) {
+        mAllParams = false;
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> ranges;
+        for (const auto &r : subscription.params()) {
+            if (r.first() <= r.last())
+                ranges.emplace_back(r.first(), r.last());
+        }
+        std::sort(ranges.begin(), ranges.end());
+
+        std::uint32_t denseEnd = 0;
+        for (const auto &[first, last] : ranges) {
+            if (first < MaxDenseParamId)
+                denseEnd = std::max(denseEnd, std::min(last, MaxDenseParamId - 1) + 1);
+        }
+        mParamBits.assign((denseEnd + 63) / 64, 0);
+        for (const auto &[first, last] : ranges) {
+            for (auto id = first; id < denseEnd && id <= last; ++id)
+                mParamBits[id / 64] |= std::uint64_t(1) << (id % 64);
+            if (last < MaxDenseParamId)
+                continue;
+            // Merge the part beyond the bitset into the sorted ranges.
+            const auto sparseFirst = std::max(first, MaxDenseParamId);
+            if (!mSparseParams.empty() && sparseFirst - 1 <= mSparseParams.back().second)
+                mSparseParams.back().second = std::max(mSparseParams.back().second, last);
+            else
+                mSparseParams.emplace_back(sparseFirst, last);
+        }
+    }
+
+    if (subscription.note_port_mask() != 0)
+        mPortMask = subscription.note_port_mask();
+    if (subscription.note_channel_mask() != 0)
+        mChannelMask = subscription.note_channel_mask();
+
+    mAcceptsAll = mEvents == ~std::uint64_t(0) && mAllParams && mPortMask == ~0u && mChannelMask == ~0u;
+}
+
+bool EventFilter::accepts(const ServerEventWrapper &ev) const noexcept
+{
+    const auto e = static_cast<std::uint32_t>(ev.ev);
+    if (e >= 64 || !((mEvents >> e) & 1u))
+        return false;
+    if (const auto *p = std::get_if<ClapEventParamWrapper>(&ev.data))
+        return mAllParams || acceptsParam(p->paramId);
+    if (const auto *n = std::get_if<ClapEventNoteWrapper>(&ev.data)) {
+        return (mPortMask == ~0u || inMask(mPortMask, n->portIndex))
+            && (mChannelMask == ~0u || n->channel == -1 || inMask(mChannelMask, n->channel));
+    }
+    return true;
+}
+
+bool EventFilter::acceptsParam(std::uint32_t id) const noexcept
+{
+    if (id / 64 < mParamBits.size())
+        return (mParamBits[id / 64] >> (id % 64)) & 1u;
+    if (mSparseParams.empty() || id < MaxDenseParamId)
+        return false;
+    const auto it = std::upper_bound(mSparseParams.begin(), mSparseParams.end(), id, [](std::uint32_t v, const auto &r) {
+        return v < r.first;
+    });
+    return it != mSparseParams.begin() && id <= std::prev(it)->second;
+}
+
+RCLAP_END_NAMESPACE
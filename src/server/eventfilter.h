@@ -0,0 +1,47 @@
+#ifndef EVENTFILTER_H
+#define EVENTFILTER_H
+
+#include "wrappers.h"
+#include <core/global.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+RCLAP_BEGIN_NAMESPACE
+
+// The Subscription of a ClientRequest, compiled once when the stream connects. The
+// event types and the port and channel masks are single words, param ids are looked
+// up in a dense bitset. Ids beyond it fall back to a binary search over the ranges.
+class EventFilter
+{
+public:
+    // Accepts all events.
+    EventFilter() = default;
+    explicit EventFilter(const Subscription &subscription);
+
+    [[nodiscard]] bool acceptsAll() const noexcept { return mAcceptsAll; }
+    [[nodiscard]] bool accepts(const ServerEventWrapper &ev) const noexcept;
+
+    // Ids below this limit are kept in the bitset.
+    static constexpr std::uint32_t MaxDenseParamId = 1u << 16;
+
+private:
+    [[nodiscard]] bool acceptsParam(std::uint32_t id) const noexcept;
+    [[nodiscard]] static bool inMask(std::uint32_t mask, std::int32_t index) noexcept
+    {
+        return index >= 0 && index < 32 && (mask >> index) & 1u;
+    }
+
+    bool mAcceptsAll = true;
+    std::uint64_t mEvents = ~std::uint64_t(0); // Bit Event
+    bool mAllParams = true;
+    std::vector<std::uint64_t> mParamBits;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> mSparseParams; // Sorted, disjoint
+    std::uint32_t mPortMask = ~0u;
+    std::uint32_t mChannelMask = ~0u;
+};
+
+RCLAP_END_NAMESPACE
+
+#endif // EVENTFILTER_H
@@ -0,0 +1,36 @@
+#include "eventhistory.h"
+
+#include <vector>
+
+RCLAP_BEGIN_NAMESPACE
+
+EventHistory::EventHistory(std::size_t maxBatches, std::size_t maxBytes)
+    : mMaxBatches(maxBatches == 0 ? 1 : maxBatches), mMaxBytes(maxBytes)
+{
+}
+
+const grpc::Slice &EventHistory::append(std::string_view batch)
+{
+    mBatches.emplace_back(batch.data(), batch.size());
+    mBytes += batch.size();
+    while (mBatches.size() > 1 && (mBatches.size() > mMaxBatches || mBytes > mMaxBytes)) {
+        mBytes -= mBatches.front().size();
+        mBatches.pop_front();
+        ++mFirstSeq;
+    }
+    return mBatches.back();
+}
+
+std::optional<grpc::ByteBuffer> EventHistory::replayAfter(std::uint64_t seq) const
+{
+    if (seq > lastSeq() || seq + 1 < mFirstSeq)
+        return std::nullopt;
+    if (seq == lastSeq())
+        return grpc::ByteBuffer();
+    // Slices are reference counted, the buffer shares the stored bytes.
+    const std::vector<grpc::Slice> missed(mBatches.begin() + static_cast<std::ptrdiff_t>(seq + 1 - mFirstSeq),
+                                          mBatches.end());
+    return grpc::ByteBuffer(missed.data(), missed.size());
+}
+
+RCLAP_END_NAMESPACE
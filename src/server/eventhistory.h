@@ -0,0 +1,51 @@
+#ifndef EVENTHISTORY_H
+#define EVENTHISTORY_H
+
+#include <core/global.h>
+
+#include <grpcpp/support/byte_buffer.h>
+#include <grpcpp/support/slice.h>
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string_view>
+
+RCLAP_BEGIN_NAMESPACE
+
+// The encoded batches of the last poll rounds of a plugin instance, numbered by their
+// ServerEvents.seq. A client that reconnects resumes after the last seq it received:
+// the replay references the stored slices, nothing is encoded again. The oldest batches
+// are evicted once either bound is exceeded, the newest one is always kept.
+class EventHistory
+{
+public:
+    static constexpr std::size_t DefaultMaxBatches = 4096;
+    static constexpr std::size_t DefaultMaxBytes = 8 * 1024 * 1024;
+
+    explicit EventHistory(std::size_t maxBatches = DefaultMaxBatches, std::size_t maxBytes = DefaultMaxBytes);
+
+    // The seq of the next batch. Seqs start at 1, 0 means none.
+    [[nodiscard]] std::uint64_t nextSeq() const noexcept { return mFirstSeq + mBatches.size(); }
+    [[nodiscard]] std::uint64_t lastSeq() const noexcept { return nextSeq() - 1; }
+    [[nodiscard]] std::uint64_t firstSeq() const noexcept { return mFirstSeq; }
+    [[nodiscard]] std::size_t size() const noexcept { return mBatches.size(); }
+    [[nodiscard]] std::size_t bytes() const noexcept { return mBytes; }
+
+    // Copies the batch of nextSeq() into a slice, the bytes must already carry the seq.
+    const grpc::Slice &append(std::string_view batch);
+    // The batches after \a seq as one buffer, empty if the client missed none. Returns
+    // nullopt if some were evicted already or \a seq wasn't issued yet.
+    [[nodiscard]] std::optional<grpc::ByteBuffer> replayAfter(std::uint64_t seq) const;
+
+private:
+    std::deque<grpc::Slice> mBatches;
+    std::uint64_t mFirstSeq = 1;
+    std::size_t mBytes = 0;
+    std::size_t mMaxBatches;
+    std::size_t mMaxBytes;
+};
+
+RCLAP_END_NAMESPACE
+
+#endif // EVENTHISTORY_H
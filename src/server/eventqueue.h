@@ -0,0 +1,338 @@
+#ifndef EVENTQUEUE_H
+#define EVENTQUEUE_H
+
+#include <core/global.h>
+#include "queueoptions.h"
+
+#include <farbot/fifo.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <type_traits>
+
+RCLAP_BEGIN_NAMESPACE
+
+// Events that can be conflated provide a conflationKey(const T &) found by ADL, returning
+// the key events are merged by, or nullopt for events that aren't merged.
+template <typename T>
+concept Conflatable = std::is_trivially_copyable_v<T> && requires(const T &ev) {
+    { conflationKey(ev) } -> std::same_as<std::optional<std::uint64_t>>;
+};
+
+// The latest event per key, for events that didn't fit into their queue. Written by one
+// producer at a time, read by any consumer. Both sides are wait-free: a consumer skips
+// an event that is being written and leaves it pending. Keys stay once added, new keys
+// are refused when all slots are taken.
+// Every event carries a barrier, the position in the queue it was stored at. A consumer
+// only takes the events whose barrier it passed.
+template <typename T>
+class ConflationTable
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+    explicit ConflationTable(std::uint32_t slots)
+        : mCapacity(std::bit_ceil(std::max<std::uint32_t>(slots, 2))),
+          mShift(64 - std::countr_zero(mCapacity)),
+          mSlots(std::make_unique<Slot[]>(mCapacity))
+    {}
+
+    // Producer. Returns false if \a key is new and there is no slot left. The barriers
+    // of the stores never decrease.
+    bool store(std::uint64_t key, const T &ev, std::uint64_t barrier = 0) noexcept
+    {
+        auto *slot = find(key, true);
+        if (!slot)
+            return false;
+        std::array<std::uint64_t, Words> words {};
+        std::memcpy(words.data(), &ev, sizeof(T));
+
+        // Nothing is pending, no event has a lower barrier than this one. A pop keeps the
+        // event it looks at counted, so a count of 0 is never one that a pop puts back.
+        if (mPending.load(std::memory_order_acquire) == 0)
+            mFloor.store(barrier, std::memory_order_release);
+        const auto seq = slot->seq.load(std::memory_order_relaxed);
+        slot->seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < Words; ++i)
+            slot->words[i].store(words[i], std::memory_order_relaxed);
+        slot->barrier.store(barrier, std::memory_order_relaxed);
+        slot->seq.store(seq + 2, std::memory_order_release);
+
+        if (!slot->pending.exchange(true, std::memory_order_acq_rel))
+            mPending.fetch_add(1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer. Whether an event of \a key waits to be consumed.
+    [[nodiscard]] bool isPending(std::uint64_t key) const noexcept
+    {
+        if (mPending.load(std::memory_order_acquire) == 0)
+            return false;
+        const auto *slot = const_cast<ConflationTable *>(this)->find(key, false);
+        return slot && slot->pending.load(std::memory_order_acquire);
+    }
+
+    // Consumer. Takes any pending event with a barrier up to \a limit. Continues where the
+    // previous pop stopped, a drain sweeps the table once. Never waits for the producer.
+    bool pop(T &out, std::uint64_t limit = UINT64_MAX) noexcept
+    {
+        if (mPending.load(std::memory_order_acquire) == 0 || limit < mFloor.load(std::memory_order_acquire))
+            return false;
+        const auto start = mCursor.load(std::memory_order_relaxed);
+        for (std::uint32_t n = 0; n < mCapacity; ++n) {
+            const auto i = (start + n) & (mCapacity - 1);
+            auto &slot = mSlots[i];
+            if (!slot.pending.load(std::memory_order_relaxed) || !slot.pending.exchange(false, std::memory_order_acq_rel))
+                continue;
+
+            std::array<std::uint64_t, Words> words;
+            const auto seq = slot.seq.load(std::memory_order_acquire);
+            if ((seq & 1) == 0) {
+                for (std::size_t w = 0; w < Words; ++w)
+                    words[w] = slot.words[w].load(std::memory_order_relaxed);
+                const auto barrier = slot.barrier.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.seq.load(std::memory_order_relaxed) == seq && barrier <= limit) {
+                    mPending.fetch_sub(1, std::memory_order_release);
+                    std::memcpy(static_cast<void *>(&out), words.data(), sizeof(T)); // Trivially copyable
+                    mCursor.store(i + 1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+            // Being written, or not due yet. It stayed counted, the producer never sees a
+            // count of 0 and raises the floor above it.
+            if (slot.pending.exchange(true, std::memory_order_acq_rel))
+                mPending.fetch_sub(1, std::memory_order_relaxed); // The producer flagged it meanwhile
+        }
+        return false;
+    }
+
+private:
+    static constexpr std::size_t Words = (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+    struct Slot
+    {
+        std::atomic<std::uint32_t> seq = 0; // Odd while written
+        std::atomic<bool> pending = false;
+        std::atomic<std::uint64_t> barrier = 0; // Written with the words
+        bool used = false;                  // Owned by the producer, like key
+        std::uint64_t key = 0;
+        std::array<std::atomic<std::uint64_t>, Words> words {};
+    };
+
+    // Producer. Linear probing from the fibonacci hash of \a key.
+    Slot *find(std::uint64_t key, bool insert) noexcept
+    {
+        auto index = static_cast<std::uint32_t>((key * 0x9E3779B97F4A7C15ull) >> mShift);
+        for (std::uint32_t n = 0; n < mCapacity; ++n, index = (index + 1) & (mCapacity - 1)) {
+            auto &slot = mSlots[index];
+            if (slot.used && slot.key == key)
+                return &slot;
+            if (!slot.used) {
+                if (!insert)
+                    return nullptr;
+                slot.used = true;
+                slot.key = key;
+                return &slot;
+            }
+        }
+        return nullptr;
+    }
+
+    const std::uint32_t mCapacity;
+    const int mShift;
+    std::unique_ptr<Slot[]> mSlots;
+    std::atomic<std::uint32_t> mPending = 0; // Wraps while a pop overtakes a store
+    std::atomic<std::uint32_t> mCursor = 0;  // Where the next pop starts
+    std::atomic<std::uint64_t> mFloor = 0;   // No pending event has a lower barrier
+};
+
+// A bounded lock-free queue with an OverflowPolicy and drop accounting. The counters are
+// relaxed atomics, the producer side ones are plain loads and stores with a single producer.
+// OverwriteOldest evicts by popping from the producer, so the fifo always allows several
+// consumers.
+// Conflated events keep their place: one is popped once the events queued before it are,
+// ahead of the ones queued after it. A gesture edge or a note never overtakes the param
+// values that preceded it.
+template <typename T, farbot::fifo_options::concurrency Producer>
+class EventQueue
+{
+    using Fifo = farbot::fifo<T,
+        farbot::fifo_options::concurrency::multiple,
+        Producer,
+        farbot::fifo_options::full_empty_failure_mode::return_false_on_full_or_empty,
+        farbot::fifo_options::full_empty_failure_mode::return_false_on_full_or_empty>;
+    static constexpr bool SingleProducer = Producer == farbot::fifo_options::concurrency::single;
+
+public:
+    static constexpr bool CanConflate = Conflatable<T>;
+
+    explicit EventQueue(std::uint32_t capacity)
+        : EventQueue(QueueOptions { capacity })
+    {}
+    // ConflateByParam falls back to DropNewest for events without a conflationKey().
+    explicit EventQueue(const QueueOptions &options)
+        : mOptions(sanitize(options)), mFifo(static_cast<int>(mOptions.capacity))
+    {
+        if constexpr (CanConflate) {
+            if (mOptions.policy == OverflowPolicy::ConflateByParam)
+                mConflation = std::make_unique<ConflationTable<T>>(mOptions.conflationSlots);
+        }
+    }
+
+    // Queues \a ev, or applies the overflow policy if the queue is full. Returns false if
+    // \a ev was dropped.
+    bool push(T &&ev) noexcept
+    {
+        [[maybe_unused]] std::optional<std::uint64_t> key;
+        if constexpr (CanConflate) {
+            // Once a param waits in the table, its later events follow it there so the
+            // consumer never sees them out of order.
+            if (mConflation && (key = conflationKey(ev)) && mConflation->isPending(*key))
+                return conflate(*key, ev);
+        }
+        if (mFifo.push(std::move(ev)))
+            return pushed();
+        increment(mFailures);
+
+        switch (mOptions.policy) {
+        case OverflowPolicy::DropNewest:
+            break;
+        case OverflowPolicy::OverwriteOldest: {
+            T oldest;
+            if (mFifo.pop(oldest)) {
+                mPopped.fetch_add(1, std::memory_order_relaxed);
+                increment(mDropped);
+            }
+            if (mFifo.push(std::move(ev)))
+                return pushed();
+            break;
+        }
+        case OverflowPolicy::ConflateByParam:
+            if constexpr (CanConflate) {
+                if (key)
+                    return conflate(*key, ev);
+            }
+            break;
+        }
+        increment(mDropped);
+        return false;
+    }
+
+    // Never drops. For callers that wait for room, a full queue only counts as a failure.
+    bool tryPush(T &&ev) noexcept
+    {
+        if (mFifo.push(std::move(ev)))
+            return pushed();
+        increment(mFailures);
+        return false;
+    }
+
+    // In the order of the pushes, a conflated event at the place of its latest push.
+    bool pop(T &out) noexcept
+    {
+        if constexpr (CanConflate) {
+            if (mConflation && mConflation->pop(out, mPopped.load(std::memory_order_relaxed)))
+                return true;
+        }
+        if (mFifo.pop(out)) {
+            mPopped.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    [[nodiscard]] const QueueOptions &options() const noexcept { return mOptions; }
+
+    [[nodiscard]] EventQueueStats stats() const noexcept
+    {
+        EventQueueStats stats;
+        stats.capacity = mOptions.capacity;
+        stats.policy = mOptions.policy;
+        stats.pushed = mPushed.load(std::memory_order_relaxed);
+        stats.size = clampSize(stats.pushed - mPopped.load(std::memory_order_relaxed));
+        stats.highWater = mHighWater.load(std::memory_order_relaxed);
+        stats.dropped = mDropped.load(std::memory_order_relaxed);
+        stats.conflated = mConflated.load(std::memory_order_relaxed);
+        stats.failures = mFailures.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    static QueueOptions sanitize(QueueOptions options) noexcept
+    {
+        options.capacity = std::bit_ceil(std::max<std::uint32_t>(options.capacity, 2));
+        if (!CanConflate && options.policy == OverflowPolicy::ConflateByParam)
+            options.policy = OverflowPolicy::DropNewest;
+        return options;
+    }
+
+    std::uint32_t clampSize(std::uint64_t size) const noexcept
+    {
+        // The pop count may be read before pops of events we already counted as pushed.
+        return static_cast<std::uint32_t>(std::min<std::uint64_t>(size, mOptions.capacity));
+    }
+
+    static std::uint64_t increment(std::atomic<std::uint64_t> &counter) noexcept
+    {
+        if constexpr (SingleProducer) {
+            const auto n = counter.load(std::memory_order_relaxed) + 1;
+            counter.store(n, std::memory_order_relaxed);
+            return n;
+        } else {
+            return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+        }
+    }
+
+    bool pushed() noexcept
+    {
+        const auto size = clampSize(increment(mPushed) - mPopped.load(std::memory_order_relaxed));
+        auto highWater = mHighWater.load(std::memory_order_relaxed);
+        if constexpr (SingleProducer) {
+            if (size > highWater)
+                mHighWater.store(size, std::memory_order_relaxed);
+        } else {
+            while (size > highWater && !mHighWater.compare_exchange_weak(highWater, size, std::memory_order_relaxed))
+                ;
+        }
+        return true;
+    }
+
+    bool conflate(std::uint64_t key, const T &ev) noexcept
+    {
+        // Behind all events queued so far.
+        if (!mConflation->store(key, ev, mPushed.load(std::memory_order_relaxed))) {
+            increment(mDropped);
+            return false;
+        }
+        increment(mConflated);
+        return true;
+    }
+
+    const QueueOptions mOptions;
+    Fifo mFifo;
+    struct NoConflation {};
+    std::unique_ptr<std::conditional_t<CanConflate, ConflationTable<T>, NoConflation>> mConflation;
+
+    // Producer side
+    alignas(64) std::atomic<std::uint64_t> mPushed = 0;
+    std::atomic<std::uint64_t> mDropped = 0;
+    std::atomic<std::uint64_t> mConflated = 0;
+    std::atomic<std::uint64_t> mFailures = 0;
+    std::atomic<std::uint32_t> mHighWater = 0;
+    // Consumer side
+    alignas(64) std::atomic<std::uint64_t> mPopped = 0;
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+};
+
+RCLAP_END_NAMESPACE
+
+#endif // EVENTQUEUE_H
@@ -0,0 +1,42 @@
+#include "paramconflator.h"
+
+RCLAP_BEGIN_NAMESPACE
+
+ParamConflator::ParamConflator(std::uint32_t maxRateHz)
+    : mIntervalNs(maxRateHz == 0 ? 0 : 1'000'000'000ull / maxRateHz)
+{
+}
+
+bool ParamConflator::update(const ServerEventWrapper &ev)
+{
+    const auto *pm = std::get_if<ClapEventParamWrapper>(&ev.data);
+    if (!pm || ev.ev != Event::Param
+        || (pm->type != ClapEventParam_Type_Value && pm->type != ClapEventParam_Type_Modulation))
+        return false;
+
+    const auto key = (std::uint64_t(pm->paramId) << 32) | static_cast<std::uint32_t>(pm->type);
+    const auto [it, inserted] = mIndex.try_emplace(key, static_cast<std::uint32_t>(mSlots.size()));
+    const auto slot = it->second;
+    if (inserted) {
+        mSlots.push_back(ev);
+        mSlotPending.push_back(false);
+    } else {
+        mSlots[slot] = ev;
+    }
+    if (!mSlotPending[slot]) {
+        mSlotPending[slot] = true;
+        mPending.push_back(slot);
+    }
+    return true;
+}
+
+void ParamConflator::clear() noexcept
+{
+    mIndex.clear();
+    mSlots.clear();
+    mPending.clear();
+    mSlotPending.clear();
+    mNextEmitNs = 0;
+}
+
+RCLAP_END_NAMESPACE
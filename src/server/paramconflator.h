@@ -0,0 +1,78 @@
+#ifndef PARAMCONFLATOR_H
+#define PARAMCONFLATOR_H
+
+#include "wrappers.h"
+#include <core/global.h>
+
+#include <absl/container/flat_hash_map.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+RCLAP_BEGIN_NAMESPACE
+
+// Rate limits the param telemetry of a stream. Only the latest value and modulation of
+// every param is kept, and they are emitted at most once per interval, in the order
+// they first changed. Gesture edges aren't conflated: the pending values of their param
+// are emitted right before them.
+class ParamConflator
+{
+public:
+    // Disabled, nothing is conflated.
+    ParamConflator() = default;
+    explicit ParamConflator(std::uint32_t maxRateHz);
+
+    [[nodiscard]] bool enabled() const noexcept { return mIntervalNs != 0; }
+    [[nodiscard]] bool hasPending() const noexcept { return !mPending.empty(); }
+    // The earliest time the pending values are emitted.
+    [[nodiscard]] std::uint64_t dueNs() const noexcept { return mNextEmitNs; }
+    [[nodiscard]] std::uint64_t intervalNs() const noexcept { return mIntervalNs; }
+
+    // Keeps a param value or modulation. Returns false for all other events.
+    bool update(const ServerEventWrapper &ev);
+
+    // Emits the pending values of a param, regardless of the interval.
+    template <typename Fn>
+    void flushParam(std::uint32_t paramId, Fn &&emit)
+    {
+        std::erase_if(mPending, [&](std::uint32_t slot) {
+            const auto &ev = mSlots[slot];
+            if (std::get<ClapEventParamWrapper>(ev.data).paramId != paramId)
+                return false;
+            mSlotPending[slot] = false;
+            emit(ev);
+            return true;
+        });
+    }
+
+    // Emits all pending values if the interval since the last emit passed. Returns true
+    // if any were emitted.
+    template <typename Fn>
+    bool flushDue(std::uint64_t nowNs, Fn &&emit)
+    {
+        if (mPending.empty() || nowNs < mNextEmitNs)
+            return false;
+        for (const auto slot : mPending) {
+            mSlotPending[slot] = false;
+            emit(mSlots[slot]);
+        }
+        mPending.clear();
+        mNextEmitNs = nowNs + mIntervalNs;
+        return true;
+    }
+
+    void clear() noexcept;
+
+private:
+    std::uint64_t mIntervalNs = 0;
+    std::uint64_t mNextEmitNs = 0;
+    absl::flat_hash_map<std::uint64_t, std::uint32_t> mIndex; // Param id and type to slot
+    std::vector<ServerEventWrapper> mSlots;  // Latest event per param id and type
+    std::vector<std::uint32_t> mPending;     // Changed slots since the last emit
+    std::vector<bool> mSlotPending;
+};
+
+RCLAP_END_NAMESPACE
+
+#endif // PARAMCONFLATOR_H
@@ -0,0 +1,54 @@
+#include "paraminfosnapshot.h"
+
+#include <api.pb.h>
+
+#include <algorithm>
+#include <array>
+
+RCLAP_BEGIN_NAMESPACE
+
+using namespace api::v0;
+
+void ParamInfoSnapshot::add(const clap_param_info &info)
+{
+    // A message with a single entry serializes to exactly that entry's field.
+    const auto [it, inserted] = mModuleIndex.try_emplace(info.module, static_cast<std::uint32_t>(mModuleIndex.size()));
+    if (inserted) {
+        ParamInfos module;
+        module.add_modules(info.module);
+        module.AppendToString(&mModules);
+    }
+
+    ParamInfos param;
+    auto *p = param.add_params();
+    p->set_param_id(info.id);
+    p->set_name(info.name);
+    p->set_module(it->second);
+    p->set_min_value(info.min_value);
+    p->set_max_value(info.max_value);
+    p->set_default_value(info.default_value);
+    p->set_flags(info.flags);
+    param.AppendToString(&mParams);
+    mOffsets.push_back(mParams.size());
+}
+
+grpc::ByteBuffer ParamInfoSnapshot::page(std::uint32_t offset, std::uint32_t pageSize) const
+{
+    const auto first = std::min(offset, size());
+    const auto last = pageSize == 0 ? size() : static_cast<std::uint32_t>(std::min<std::uint64_t>(
+        std::uint64_t(first) + pageSize, size()));
+
+    ParamInfos trailer;
+    trailer.set_total(size());
+    trailer.set_next_offset(last);
+    const auto tail = trailer.SerializeAsString();
+
+    const std::array slices = {
+        grpc::Slice(mModules.data(), mModules.size(), grpc::Slice::STATIC_SLICE),
+        grpc::Slice(mParams.data() + mOffsets[first], mOffsets[last] - mOffsets[first], grpc::Slice::STATIC_SLICE),
+        grpc::Slice(tail),
+    };
+    return grpc::ByteBuffer(slices.data(), slices.size());
+}
+
+RCLAP_END_NAMESPACE
@@ -0,0 +1,44 @@
+#ifndef PARAMINFOSNAPSHOT_H
+#define PARAMINFOSNAPSHOT_H
+
+#include <core/global.h>
+
+#include <absl/container/flat_hash_map.h>
+#include <clap/ext/params.h>
+#include <grpcpp/support/byte_buffer.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+RCLAP_BEGIN_NAMESPACE
+
+// The param infos of a plugin instance, serialized once as the fields of a ParamInfos
+// message. Module names are interned. A page is a byte range of the serialized params,
+// it's sent without re-encoding. Built by the main thread while params are added and
+// published as an immutable copy.
+class ParamInfoSnapshot
+{
+public:
+    ParamInfoSnapshot() = default;
+
+    void add(const clap_param_info &info);
+
+    [[nodiscard]] std::uint32_t size() const noexcept { return static_cast<std::uint32_t>(mOffsets.size() - 1); }
+    [[nodiscard]] std::size_t nModules() const noexcept { return mModuleIndex.size(); }
+    [[nodiscard]] std::size_t bytes() const noexcept { return mModules.size() + mParams.size(); }
+
+    // The serialized ParamInfos of \a pageSize params from \a offset, all remaining ones
+    // for 0. The buffer references the snapshot, which must outlive it.
+    [[nodiscard]] grpc::ByteBuffer page(std::uint32_t offset, std::uint32_t pageSize) const;
+
+private:
+    absl::flat_hash_map<std::string, std::uint32_t> mModuleIndex;
+    std::string mModules;                    // ParamInfos.modules
+    std::string mParams;                     // ParamInfos.params
+    std::vector<std::size_t> mOffsets { 0 }; // Start of every param in mParams, and the end
+};
+
+RCLAP_END_NAMESPACE
+
+#endif // PARAMINFOSNAPSHOT_H
@@ -0,0 +1,38 @@
+#include "paramstate.h"
+
+RCLAP_BEGIN_NAMESPACE
+
+ParamState *ParamStateTable::add(std::uint32_t paramId, double value)
+{
+    const auto index = mSize.load(std::memory_order_relaxed);
+    const auto chunk = index / ChunkSize;
+    if (chunk >= MaxChunks)
+        return nullptr;
+    if (!mChunks[chunk])
+        mChunks[chunk] = std::make_unique<ParamState[]>(ChunkSize);
+
+    auto &state = mChunks[chunk][index % ChunkSize];
+    state.paramId = paramId;
+    state.value.store(value, std::memory_order_relaxed);
+    mSize.store(index + 1, std::memory_order_release);
+    return &state;
+}
+
+void ParamStateTable::read(ParamStates &out, std::uint64_t sinceVersion) const
+{
+    // Params changed while we read show up with a version beyond this one.
+    out.set_version(version());
+    const auto n = size();
+    for (std::uint32_t i = 0; i < n; ++i) {
+        const auto &state = mChunks[i / ChunkSize][i % ChunkSize];
+        const auto v = state.version.load(std::memory_order_acquire);
+        if (sinceVersion != 0 && v <= sinceVersion)
+            continue;
+        out.add_param_ids(state.paramId);
+        out.add_values(state.value.load(std::memory_order_relaxed));
+        out.add_modulations(state.modulation.load(std::memory_order_relaxed));
+        out.add_versions(v);
+    }
+}
+
+RCLAP_END_NAMESPACE
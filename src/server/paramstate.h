@@ -0,0 +1,74 @@
+#ifndef PARAMSTATE_H
+#define PARAMSTATE_H
+
+#include <core/global.h>
+
+#include <api.pb.h>
+using namespace api::v0;
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+RCLAP_BEGIN_NAMESPACE
+
+// The current value and modulation of a param, written by the thread that sets it.
+struct ParamState
+{
+    std::atomic<double> value = 0;
+    std::atomic<double> modulation = 0;
+    std::atomic<std::uint64_t> version = 0; // Of the last change
+    std::uint32_t paramId = 0;
+};
+static_assert(std::atomic<double>::is_always_lock_free);
+
+// The state of all params of a plugin instance, for clients that connect while it runs.
+// Every change takes the next version of the table. A snapshot holds the version of
+// every param, a param event carries the version of its change: clients apply an event
+// only if it's newer than what they have. Writers never wait, readers never block them.
+// Slots live in fixed chunks, so adding a param doesn't move the others.
+class ParamStateTable
+{
+public:
+    // Main thread, while the params are added. Returns nullptr once the table is full.
+    ParamState *add(std::uint32_t paramId, double value);
+
+    // Return the version of the change.
+    std::uint64_t setValue(ParamState &state, double value) noexcept
+    {
+        state.value.store(value, std::memory_order_relaxed);
+        return bump(state);
+    }
+    std::uint64_t setModulation(ParamState &state, double modulation) noexcept
+    {
+        state.modulation.store(modulation, std::memory_order_relaxed);
+        return bump(state);
+    }
+
+    [[nodiscard]] std::uint64_t version() const noexcept { return mVersion.load(std::memory_order_acquire); }
+    [[nodiscard]] std::uint32_t size() const noexcept { return mSize.load(std::memory_order_acquire); }
+
+    // Any thread. Fills \a out with the params changed after \a sinceVersion, all for 0.
+    // The values are at least as new as the versions read with them.
+    void read(ParamStates &out, std::uint64_t sinceVersion = 0) const;
+
+    static constexpr std::uint32_t ChunkSize = 1024;
+    static constexpr std::uint32_t MaxChunks = 256;
+
+private:
+    std::uint64_t bump(ParamState &state) noexcept
+    {
+        const auto v = mVersion.fetch_add(1, std::memory_order_relaxed) + 1;
+        state.version.store(v, std::memory_order_release);
+        return v;
+    }
+
+    std::array<std::unique_ptr<ParamState[]>, MaxChunks> mChunks;
+    std::atomic<std::uint32_t> mSize = 0;  // Published after the slot was initialized
+    std::atomic<std::uint64_t> mVersion = 0;
+};
+
+RCLAP_END_NAMESPACE
+
+#endif // PARAMSTATE_H
@@ -0,0 +1,57 @@
+#include "pluginregistry.h"
+#include "shareddata.h"
+
+#include <crill/progressive_backoff_wait.h>
+
+RCLAP_BEGIN_NAMESPACE
+
+PluginRegistry::PluginRegistry()
+    : mTable(new Table())
+{
+}
+
+PluginRegistry::~PluginRegistry()
+{
+    delete mTable.load();
+}
+
+PluginRegistry::ReadGuard::ReadGuard(const PluginRegistry &r) noexcept
+    : registry(r), slot(r.mEpoch.load() & 1)
+{
+    // A writer that flipped the epoch meanwhile already published its table, we read
+    // that one. It only waits for readers that could still see the previous table.
+    r.mReaders[slot].n.fetch_add(1);
+    table = r.mTable.load();
+}
+
+PluginRegistry::ReadGuard::~ReadGuard()
+{
+    registry.mReaders[slot].n.fetch_sub(1);
+}
+
+std::shared_ptr<SharedData> PluginRegistry::find(std::uint64_t hash) const noexcept
+{
+    ReadGuard guard(*this);
+    const auto it = guard.table->find(hash);
+    return it == guard.table->end() ? nullptr : it->second;
+}
+
+std::size_t PluginRegistry::size() const noexcept
+{
+    ReadGuard guard(*this);
+    return guard.table->size();
+}
+
+// Called with mWriteMtx held.
+void PluginRegistry::publish(std::unique_ptr<Table> next)
+{
+    const std::unique_ptr<const Table> previous(mTable.exchange(next.release()));
+    // Readers that may hold the previous table counted themselves before the exchange,
+    // in either slot. New readers go to the other slot while one drains.
+    for (int flip = 0; flip < 2; ++flip) {
+        const auto drain = mEpoch.fetch_add(1) & 1;
+        crill::progressive_backoff_wait([&] { return mReaders[drain].n.load() == 0; });
+    }
+}
+
+RCLAP_END_NAMESPACE
@@ -0,0 +1,84 @@
+#ifndef PLUGINREGISTRY_H
+#define PLUGINREGISTRY_H
+
+#include <core/global.h>
+
+#include <absl/container/flat_hash_map.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+RCLAP_BEGIN_NAMESPACE
+
+class SharedData;
+
+// The plugin instances of the process, by hash. Readers look up an immutable table
+// through an atomic pointer, without a lock and without waiting for writers. Writers
+// are rare. They copy the table, apply a batch of changes, publish the copy and free
+// the old table once no reader can hold it anymore (read-copy-update). A reader
+// announces itself in one of two counters. The writer flips the counter new readers
+// use and waits for the other one to drain, twice.
+class PluginRegistry
+{
+public:
+    using Table = absl::flat_hash_map<std::uint64_t, std::shared_ptr<SharedData>>;
+
+    PluginRegistry();
+    ~PluginRegistry();
+
+    PluginRegistry(const PluginRegistry &) = delete;
+    PluginRegistry &operator=(const PluginRegistry &) = delete;
+
+    [[nodiscard]] std::shared_ptr<SharedData> find(std::uint64_t hash) const noexcept;
+    [[nodiscard]] std::size_t size() const noexcept;
+    // Calls \a fn with every instance until it returns true. Returns whether it did.
+    // \a fn reads the table in place, it must not modify the registry.
+    template <typename Fn>
+    bool anyOf(Fn &&fn) const
+    {
+        ReadGuard guard(*this);
+        for (const auto &[hash, data] : *guard.table) {
+            if (fn(hash, data))
+                return true;
+        }
+        return false;
+    }
+
+    // Applies \a mutate to a copy of the table and publishes it, one update for all
+    // changes \a mutate makes. Returns what \a mutate returned. Writers are serialized.
+    template <typename Fn>
+    auto update(Fn &&mutate)
+    {
+        std::scoped_lock lock(mWriteMtx);
+        auto next = std::make_unique<Table>(*mTable.load());
+        auto ret = mutate(*next);
+        publish(std::move(next));
+        return ret;
+    }
+
+private:
+    struct ReadGuard
+    {
+        explicit ReadGuard(const PluginRegistry &r) noexcept;
+        ~ReadGuard();
+        const PluginRegistry &registry;
+        std::uint32_t slot;
+        const Table *table;
+    };
+
+    void publish(std::unique_ptr<Table> next);
+
+    std::atomic<const Table *> mTable;
+    std::atomic<std::uint32_t> mEpoch = 0;
+    // Apart, the readers of one slot don't invalidate the line of the other.
+    struct alignas(64) Readers { std::atomic<std::uint32_t> n = 0; };
+    mutable std::array<Readers, 2> mReaders;
+    std::mutex mWriteMtx;
+};
+
+RCLAP_END_NAMESPACE
+
+#endif // PLUGINREGISTRY_H
@@ -0,0 +1,184 @@
+#include <core/logging.h>
+#include "poller.h"
+#include "cqeventhandler.h"
+#include "shareddata.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+RCLAP_BEGIN_NAMESPACE
+
+namespace {
+
+std::uint64_t nowNs() noexcept
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count());
+}
+
+} // namespace
+
+Poller::Poller(CqEventHandler *cq)
+    : mCq(cq),
+      mWakeTag(cq, [this](bool ok) { onWake(ok); }),
+      mTimerTag(cq, [this](bool ok) { onTimer(ok); })
+{
+    assert(cq != nullptr);
+}
+
+void Poller::add(std::shared_ptr<SharedData> data)
+{
+    assert(data != nullptr);
+    {
+        std::scoped_lock lock(mPendingMtx);
+        mPending.emplace_back(std::move(data));
+        mHasPending = true;
+    }
+    wake();
+}
+
+void Poller::wake() noexcept
+{
+    // Pairs with the store in sweep(). Either we observe the wakeable poller, or
+    // the poller observes the activity flag when it re-checks after the store.
+    // Only a single thread can win the exchange, so there's at most one wake alarm in flight.
+    // Producers run on the audio thread, they never touch the timed alarm.
+    if (!mShutdown.load(std::memory_order_relaxed) && mWakeable.load() && mWakeable.exchange(false))
+        mCq->setAlarmNow(mWakeAlarm, &mWakeTag);
+}
+
+void Poller::shutdown() noexcept
+{
+    mShutdown = true;
+    // Run a last sweep that ends all instances, with the wake alarm if we can take it.
+    // Otherwise a pending timed alarm would only sweep at its deadline, cancel it.
+    if (mWakeable.exchange(false))
+        return mCq->setAlarmNow(mWakeAlarm, &mWakeTag);
+    std::scoped_lock lock(mTimerMtx);
+    if (mTimerNs != 0 && !mTimerCancelled) {
+        mTimerCancelled = true;
+        mTimerAlarm.Cancel();
+    }
+}
+
+void Poller::finish()
+{
+    endAll();
+}
+
+bool Poller::hasWork() const noexcept
+{
+    return mHasPending.load() || std::any_of(mInstances.begin(), mInstances.end(), [](const auto &data) {
+        return data->mActive.load();
+    });
+}
+
+void Poller::endAll()
+{
+    {
+        std::scoped_lock lock(mPendingMtx);
+        std::move(mPending.begin(), mPending.end(), std::back_inserter(mInstances));
+        mPending.clear();
+        mHasPending = false;
+    }
+    for (auto &data : mInstances)
+        data->endPolling();
+    mInstances.clear();
+    mNumInstances = 0;
+}
+
+void Poller::onWake(bool ok)
+{
+    mWakeOut = false;
+    sweep(ok);
+}
+
+void Poller::onTimer(bool ok)
+{
+    {
+        std::scoped_lock lock(mTimerMtx);
+        mTimerNs = 0;
+        // Only we and shutdown() cancel the alarm, that's a regular sweep or the last one.
+        if (std::exchange(mTimerCancelled, false))
+            ok = true;
+    }
+    sweep(ok);
+}
+
+void Poller::armTimer(std::uint64_t next, std::uint64_t now)
+{
+    std::scoped_lock lock(mTimerMtx);
+    if (mTimerNs != 0) {
+        // The cancelled alarm sweeps right away and arms the timer again.
+        if (next < mTimerNs && !mTimerCancelled) {
+            mTimerCancelled = true;
+            mTimerAlarm.Cancel();
+        }
+        return;
+    }
+    mTimerNs = next;
+    mCq->setAlarm(mTimerAlarm, &mTimerTag, next > now && !mShutdown ? next - now : 0);
+}
+
+void Poller::sweep(bool ok)
+{
+    mSweeps.fetch_add(1, std::memory_order_relaxed);
+    if (!ok || mShutdown) {
+        SPDLOG_TRACE("Poller stopped: ok: {}, shutdown: {}", ok, mShutdown.load());
+        return endAll();
+    }
+
+    const auto now = nowNs();
+    if (mHasPending.load()) {
+        std::scoped_lock lock(mPendingMtx);
+        mHasPending = false;
+        for (auto &data : mPending) {
+            data->mNextPollNs = now;
+            mInstances.emplace_back(std::move(data));
+        }
+        mPending.clear();
+    }
+
+    auto next = Idle;
+    // Instances in SharedData::PollMode::Wakeup rely on notify(), even with a deadline armed.
+    bool wakeable = false;
+    for (std::size_t i = 0; i < mInstances.size();) {
+        auto &data = *mInstances[i];
+        // The load keeps the cache line of idle instances shared with their producers.
+        if (data.mActive.load(std::memory_order_relaxed) && data.mActive.exchange(false))
+            data.mNextPollNs = now;
+        if (data.mNextPollNs <= now) {
+            const auto defer = data.poll();
+            if (!defer) { // Finished, the order of the instances doesn't matter.
+                mInstances[i] = std::move(mInstances.back());
+                mInstances.pop_back();
+                continue;
+            }
+            data.mNextPollNs = *defer == Idle ? Idle : now + *defer;
+        }
+        next = std::min(next, data.mNextPollNs);
+        wakeable = wakeable || data.pollMode() == SharedData::PollMode::Wakeup;
+        ++i;
+    }
+    mNumInstances = mInstances.size();
+
+    if (next != Idle)
+        armTimer(next, now);
+    if (next == Idle || wakeable) {
+        // A wake alarm that is still on its way sweeps anyway.
+        if (mWakeOut)
+            return;
+        mWakeOut = true;
+        mWakeable.store(true);
+        // We raced with a producer that flagged its instance after we looked at it.
+        if ((hasWork() || mShutdown.load()) && mWakeable.exchange(false))
+            mCq->setAlarmNow(mWakeAlarm, &mWakeTag);
+    } else if (mWakeOut && mWakeable.exchange(false)) {
+        // Only the timed alarm polls, as the backoff of PollMode::Backoff intends.
+        mWakeOut = false;
+    }
+}
+
+RCLAP_END_NAMESPACE
@@ -0,0 +1,86 @@
+#ifndef POLLER_H
+#define POLLER_H
+
+#include "tags/eventtag.h"
+#include <core/global.h>
+
+#include <grpcpp/alarm.h>
+
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+RCLAP_BEGIN_NAMESPACE
+
+class CqEventHandler;
+class SharedData;
+
+// Polls all plugin instances of a stream queue with a single reusable alarm.
+// Producers flag their instance as active in SharedData::notify(), a sweep only
+// polls flagged instances and the ones whose backoff expired. Instances without
+// events in PollMode::Wakeup are skipped entirely, and if no instance is due the
+// poller sleeps until the next notify(). Deadlines, e.g. the backoff or a conflation
+// deadline, arm a timed alarm that only the queue thread touches. While the poller sleeps
+// or an instance polls in PollMode::Wakeup, the first notify() sets a second, immediate
+// alarm instead of waiting for that deadline.
+class Poller
+{
+public:
+    // Returned by SharedData::poll() to wait for the next notify().
+    static constexpr std::uint64_t Idle = std::numeric_limits<std::uint64_t>::max();
+
+    explicit Poller(CqEventHandler *cq);
+    ~Poller() = default;
+
+    Poller(const Poller &) = delete;
+    Poller &operator=(const Poller &) = delete;
+
+    // Thread-safe. The instance is polled until SharedData::poll() reports it's done.
+    void add(std::shared_ptr<SharedData> data);
+    // Thread-safe and lock-free. Wait-free unless the poller is wakeable, then a single
+    // immediate alarm is set.
+    void wake() noexcept;
+    // Stops polling. Called before the queue is shut down.
+    void shutdown() noexcept;
+    // Ends the instances the last sweep didn't reach. Called after the queue thread exited.
+    void finish();
+
+    [[nodiscard]] std::size_t nInstances() const noexcept { return mNumInstances; }
+    [[nodiscard]] std::uint64_t sweeps() const noexcept { return mSweeps; }
+
+private:
+    void onWake(bool ok);
+    void onTimer(bool ok);
+    void sweep(bool ok);
+    // Arms the timed alarm for \a next, or cancels it if it's armed later.
+    void armTimer(std::uint64_t next, std::uint64_t now);
+    [[nodiscard]] bool hasWork() const noexcept;
+    void endAll();
+
+    CqEventHandler *mCq = nullptr;
+    PersistentEventTag mWakeTag;
+    PersistentEventTag mTimerTag;
+    grpc::Alarm mWakeAlarm; // Set by whoever wins the exchange of mWakeable
+    grpc::Alarm mTimerAlarm; // Set by the queue thread, cancelled by it or by shutdown()
+    std::vector<std::shared_ptr<SharedData>> mInstances; // Only touched by the queue thread
+
+    std::mutex mPendingMtx;
+    std::vector<std::shared_ptr<SharedData>> mPending;
+    std::atomic<bool> mHasPending = false;
+    std::atomic<bool> mWakeable = true; // Nothing to poll yet
+    bool mWakeOut = true; // mWakeable was handed out and the wake alarm didn't fire since
+    // The deadline of the armed timed alarm, 0 while none is. Never locked by producers.
+    std::uint64_t mTimerNs = 0;
+    bool mTimerCancelled = false;
+    std::mutex mTimerMtx;
+    std::atomic<bool> mShutdown = false;
+    std::atomic<std::size_t> mNumInstances = 0;
+    std::atomic<std::uint64_t> mSweeps = 0;
+};
+
+RCLAP_END_NAMESPACE
+
+#endif // POLLER_H
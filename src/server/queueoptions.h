@@ -0,0 +1,49 @@
+#ifndef QUEUEOPTIONS_H
+#define QUEUEOPTIONS_H
+
+#include <core/global.h>
+
+#include <cstdint>
+
+RCLAP_BEGIN_NAMESPACE
+
+// What a queue does with an event that doesn't fit.
+enum class OverflowPolicy : std::uint8_t
+{
+    DropNewest,      // The event is dropped
+    OverwriteOldest, // The oldest queued event is dropped to make room
+    ConflateByParam  // Param events keep their latest value per param until the consumer
+                     // catches up, other events are dropped
+};
+
+struct QueueOptions
+{
+    std::uint32_t capacity = 64; // Rounded up to a power of two
+    OverflowPolicy policy = OverflowPolicy::DropNewest;
+    // Distinct params ConflateByParam can hold, a power of two. Unused by the other policies.
+    std::uint32_t conflationSlots = 1024;
+};
+
+// The queues of a plugin instance, see SharedData.
+struct QueueConfig
+{
+    QueueOptions process;                                       // Audio thread -> Clients
+    QueueOptions main { 64, OverflowPolicy::OverwriteOldest };  // Main thread -> Clients
+    QueueOptions clients;                                       // Clients -> Audio thread
+};
+
+struct EventQueueStats
+{
+    std::uint32_t capacity = 0;
+    OverflowPolicy policy = OverflowPolicy::DropNewest;
+    std::uint32_t size = 0;      // Approximate while the queue is in use
+    std::uint32_t highWater = 0; // The largest size seen
+    std::uint64_t pushed = 0;
+    std::uint64_t dropped = 0;   // Events lost, the newest or the evicted oldest
+    std::uint64_t conflated = 0; // Events merged into a pending one of the same param
+    std::uint64_t failures = 0;  // Pushes that found the queue full
+};
+
+RCLAP_END_NAMESPACE
+
+#endif // QUEUEOPTIONS_H
@@ -5,10 +5,12 @@
 #include "tags/servereventstream.h"
 #include <crill/progressive_backoff_wait.h>
 
+#include <filesystem>
+
 RCLAP_BEGIN_NAMESPACE
 
-Server::Server(std::string_view address)
-    : serverAddress(address)
+Server::Server(std::string_view address, std::string_view unixPath)
+    : serverAddress(address), mUnixPath(unixPath)
 {
     if (!Log::Private::gLoggerSetup)
         Log::setupLogger("mServer");
@@ -23,39 +25,61 @@ Server::~Server()
 bool Server::start()
 {
     // Server can be started only once
-    if (state != CREATE)
+    if (state != CREATE || (serverAddress.empty() && mUnixPath.empty()))
         return false;
     state = RUNNING;
 
     // Specify the amount of cqs and threads to use
-    cqHandlers.reserve(2);
+    cqHandlers.reserve(mStreamCqs + mCallCqs);
     threads.reserve(cqHandlers.capacity());
     // Create the server and completion queues. Launch server
     {
         grpc::ServerBuilder builder;
-        builder.AddListeningPort(serverAddress, grpc::InsecureServerCredentials(), &mActivePort);
+        if (!serverAddress.empty())
+            builder.AddListeningPort(serverAddress, grpc::InsecureServerCredentials(), &mActivePort);
+        if (!mUnixPath.empty()) {
+            // A stale socket of a crashed process with the same pid would fail the bind.
+            std::error_code ec;
+            std::filesystem::remove(mUnixPath, ec);
+            builder.AddListeningPort("unix:" + mUnixPath, grpc::InsecureServerCredentials());
+        }
         builder.RegisterService(&aservice);
 
         // Create the amount of completion queues
-        CqEventHandler temp1(this, builder.AddCompletionQueue());
-        cqHandlers.emplace_back(std::make_unique<CqEventHandler>(std::move(temp1)));
-        CqEventHandler temp2(this, builder.AddCompletionQueue());
-        cqHandlers.emplace_back(std::make_unique<CqEventHandler>(std::move(temp2)));
+        for (std::size_t i = 0; i < mStreamCqs + mCallCqs; ++i)
+            cqHandlers.emplace_back(std::make_unique<CqEventHandler>(this, builder.AddCompletionQueue()));
         server = builder.BuildAndStart();
-        SPDLOG_INFO("Server listening on URI: {}, Port: {}", uri(), mActivePort);
+        if (!server) {
+            SPDLOG_ERROR("Failed to start server on {} {}", serverAddress, mUnixPath);
+            cqHandlers.clear();
+            state = FINISHED;
+            return false;
+        }
+        SPDLOG_INFO("Server listening on URI: {}, Port: {}, Unix socket: {}", uri(), mActivePort, mUnixPath);
     }
 
     // Create handlers to manage the RPCs and distribute them across
-    // the completion queues. We use the first completion queue for
-    // server-side streaming from the plugin to its client.
-    cqHandlers[PosStreamCq]->create<ServerEventStream>();
-    SPDLOG_TRACE("Server-Stream completion queue served @ {}", toTag(cqHandlers[PosStreamCq].get()));
-    cqHandlers[1]->create<ClientEventCallHandler>();
-    cqHandlers[1]->create<ClientParamCall>();
+    // the completion queues. The stream queues serve the server-side
+    // streaming from the plugins to their clients and run the pollers.
+    for (std::size_t i = 0; i < mStreamCqs; ++i) {
+        cqHandlers[PosStreamCq + i]->create<ServerEventStream>();
+        mPollers.emplace_back(std::make_unique<Poller>(cqHandlers[PosStreamCq + i].get()));
+        SPDLOG_TRACE("Server-Stream completion queue served @ {}", toTag(cqHandlers[PosStreamCq + i].get()));
+    }
+    for (std::size_t i = mStreamCqs; i < cqHandlers.size(); ++i) {
+        cqHandlers[i]->create<ClientEventCallHandler>();
+        cqHandlers[i]->create<ClientParamCall>();
+        cqHandlers[i]->create<ClientParamStream>();
+        cqHandlers[i]->create<GetParamInfos>();
+        cqHandlers[i]->create<GetParamStates>();
+        cqHandlers[i]->create<OpenSession>();
+        cqHandlers[i]->create<CloseSession>();
+        cqHandlers[i]->create<GetQueueStats>();
+    }
 
     // Distribute completion queues across threads
-    threads.emplace_back(&CqEventHandler::run, cqHandlers[PosStreamCq].get());
-    threads.emplace_back(&CqEventHandler::run, cqHandlers[1].get());
+    for (const auto &c : cqHandlers)
+        threads.emplace_back(&CqEventHandler::run, c.get());
 
     return true;
 }
@@ -67,6 +91,8 @@ bool Server::stop()
 
     // Shutdown the server and all completion queues. This drains
     // all the pending events and allows the threads to exit gracefully.
+    for (const auto &p : mPollers)
+        p->shutdown();
     for (const auto & c : cqHandlers)
         c->cancelAllPendingTags();
     server->Shutdown();         // shutdown server
@@ -81,11 +107,27 @@ bool Server::stop()
     // Wait for all threads to exit
     for (auto &j : threads) // commit
         j.join();
+    for (const auto &p : mPollers)
+        p->finish();
+
+    if (!mUnixPath.empty()) {
+        std::error_code ec;
+        std::filesystem::remove(mUnixPath, ec);
+    }
 
     state = FINISHED;
     return true;
 }
 
+bool Server::setCompletionQueues(std::size_t streamCqs, std::size_t callCqs)
+{
+    if (state != CREATE || streamCqs == 0 || callCqs == 0)
+        return false;
+    mStreamCqs = streamCqs;
+    mCallCqs = callCqs;
+    return true;
+}
+
 void Server::wait(std::uint32_t ms)
 {
     std::this_thread::sleep_for(std::chrono::milliseconds(ms));
@@ -2,6 +2,7 @@
 #define SERVER_H
 
 #include "cqeventhandler.h"
+#include "poller.h"
 #include <core/global.h>
 
 #include <thread>
@@ -20,7 +21,9 @@ class Server
 public:
     enum State { CREATE = 0, RUNNING, FINISHED };
 
-    explicit Server(std::string_view address = "0.0.0.0:0");
+    // An empty address disables the TCP listener. The unix domain socket at unixPath
+    // is optional and listens alongside TCP. At least one of them is required.
+    explicit Server(std::string_view address = "0.0.0.0:0", std::string_view unixPath = {});
     ~Server();
 
     Server(const Server &) = delete;
@@ -31,12 +34,29 @@ public:
     bool start();
     bool stop();
 
+    // Number of completion queues, each served by its own thread. Plugin instances are
+    // sharded across the stream queues, the unary calls across the call queues.
+    // Must be set before the server is started.
+    bool setCompletionQueues(std::size_t streamCqs, std::size_t callCqs);
+    [[nodiscard]] std::size_t streamCqCount() const noexcept { return mStreamCqs; }
+    [[nodiscard]] std::size_t callCqCount() const noexcept { return mCallCqs; }
+
     [[nodiscard]] bool isRunning() const noexcept { return state == RUNNING; }
     [[nodiscard]] State currentState() const { return state; }
-    [[nodiscard]] ClapInterface::AsyncService *service() noexcept { return &aservice; }
+    [[nodiscard]] AsyncService *service() noexcept { return &aservice; }
     [[nodiscard]] std::vector<std::unique_ptr<CqEventHandler>> *cqHandles() noexcept { return &cqHandlers; }
     // TODO: this is bad. Find something better
     [[nodiscard]] CqEventHandler *getServerStreamCqHandle() noexcept { return cqHandlers[PosStreamCq].get(); }
+    // The stream queue of a plugin instance. The assignment is stable for the lifetime of the server.
+    [[nodiscard]] CqEventHandler *getServerStreamCqHandle(std::uint64_t hash) noexcept
+    {
+        return cqHandlers[PosStreamCq + hash % mStreamCqs].get();
+    }
+    // Polls all plugin instances sharded to the same stream queue.
+    [[nodiscard]] Poller *getPoller(std::uint64_t hash) noexcept
+    {
+        return mPollers.empty() ? nullptr : mPollers[hash % mStreamCqs].get();
+    }
     [[nodiscard]] std::optional<std::string> address() const
     {
         if (auto p = port())
@@ -47,10 +67,16 @@ public:
     // This should be a true single use class by-design.
     [[nodiscard]] std::optional<int> port() const noexcept
     {
-        if (state != RUNNING)
+        if (state != RUNNING || serverAddress.empty())
             return std::nullopt;
         return mActivePort;
     }
+    [[nodiscard]] std::optional<std::string> unixAddress() const
+    {
+        if (state != RUNNING || mUnixPath.empty())
+            return std::nullopt;
+        return "unix:" + mUnixPath;
+    }
     [[nodiscard]] std::string uri() const
     {
         return serverAddress.substr(0, serverAddress.find_last_of(':'));
@@ -59,15 +85,19 @@ public:
     static void wait(std::uint32_t ms);
 
 private:
-    ClapInterface::AsyncService aservice;
+    AsyncService aservice;
     std::unique_ptr<grpc::Server> server;
 
-    static constexpr uint8_t  PosStreamCq = 0;
+    static constexpr uint8_t  PosStreamCq = 0; // Followed by the other stream queues, then the call queues
+    std::size_t mStreamCqs = 1;
+    std::size_t mCallCqs = 1;
     std::vector<std::unique_ptr<CqEventHandler>> cqHandlers;
+    std::vector<std::unique_ptr<Poller>> mPollers; // One per stream queue
     std::vector<std::jthread> threads;
 
     std::string serverAddress;
     int mActivePort = -1;
+    std::string mUnixPath;
 
     std::atomic<Server::State> state = Server::CREATE;
     static_assert(std::atomic<Server::State>::is_always_lock_free);
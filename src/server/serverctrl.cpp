@@ -3,8 +3,12 @@
 
 #include "cqeventhandler.h"
 #include "serverctrl.h"
+#include <core/processhandle.h>
 
+#include <charconv>
 #include <chrono>
+#include <cstring>
+#include <filesystem>
 #include <optional>
 #include <string>
 
@@ -32,8 +36,10 @@ bool ServerCtrl::start()  // TODO: noexcept?
 {
     std::unique_lock lock(mServerMtx);
 
-    if (!mServer)
-        mServer = std::make_unique<Server>();
+    if (!mServer) {
+        mServer = std::make_unique<Server>(mListenTcp ? "0.0.0.0:0" : "", mListenUnix ? unixSocketPath() : "");
+        mServer->setCompletionQueues(mStreamCqs, mCallCqs);
+    }
 
     if (isRunning()) {
         SPDLOG_DEBUG("Server already running.");
@@ -69,11 +75,35 @@ bool ServerCtrl::stop()
 
 std::shared_ptr<SharedData> ServerCtrl::getSharedData(uint64_t hash) noexcept
 {
-    std::scoped_lock lock(mSharedDataMtx);
-    const auto it = mSharedData.find(hash);
-    if (it == mSharedData.end())
-        return nullptr;
-    return it->second;
+    return mPlugins.find(hash);
+}
+
+std::optional<uint64_t> ServerCtrl::sessionId(const grpc::ServerContext &ctx) noexcept
+{
+    const auto &metadata = ctx.client_metadata();
+    const auto it = metadata.find(grpc::string_ref(Metadata::SessionId.data(), Metadata::SessionId.size()));
+    std::uint64_t id = 0;
+    if (it == metadata.end() || it->second.size() != sizeof(id))
+        return std::nullopt;
+    std::memcpy(&id, it->second.data(), sizeof(id));
+    return id;
+}
+
+std::optional<uint64_t> ServerCtrl::pluginHash(const grpc::ServerContext &ctx) const noexcept
+{
+    const auto &metadata = ctx.client_metadata();
+    if (metadata.find(grpc::string_ref(Metadata::SessionId.data(), Metadata::SessionId.size())) != metadata.end()) {
+        const auto id = sessionId(ctx);
+        return id ? mSessions.resolve(*id) : std::nullopt;
+    }
+
+    const auto it = metadata.find(grpc::string_ref(Metadata::PluginHashId.data(), Metadata::PluginHashId.size()));
+    if (it == metadata.end())
+        return std::nullopt;
+    std::uint64_t hash = 0;
+    if (std::from_chars(it->second.data(), it->second.data() + it->second.size(), hash).ec != std::errc())
+        return std::nullopt;
+    return hash;
 }
 
 /**
@@ -82,14 +112,16 @@ std::shared_ptr<SharedData> ServerCtrl::getSharedData(uint64_t hash) noexcept
  * @return The hash identifier if the plugin was successfully added, std::nullopt otherwise. This hash
  * is used to identify the plugin to the Server.
  */
-std::optional<uint64_t> ServerCtrl::addPlugin(CorePlugin *plugin) noexcept
+std::optional<uint64_t> ServerCtrl::addPlugin(CorePlugin *plugin, const QueueConfig &queues) noexcept
 {
     assert(plugin != nullptr);
     const auto hash = toHash(plugin);
 
-    std::scoped_lock lock(mSharedDataMtx);
-    const auto ret = mSharedData.emplace(hash, std::make_shared<SharedData>(plugin));
-    if (!ret.second) {
+    auto data = std::make_shared<SharedData>(plugin, queues);
+    const bool added = mPlugins.update([&](PluginRegistry::Table &table) {
+        return table.emplace(hash, std::move(data)).second;
+    });
+    if (!added) {
         SPDLOG_ERROR("Failed to add plugin; Plugin is already contained.");
         return std::nullopt;
     }
@@ -101,50 +133,40 @@ bool ServerCtrl::removePlugin(uint64_t hash) noexcept
     if (hash == 0)
         return false;
 
-    std::scoped_lock lock(mSharedDataMtx);
-    if (mSharedData.erase(hash) == 0) {
+    const bool removed = mPlugins.update([&](PluginRegistry::Table &table) {
+        return table.erase(hash) != 0;
+    });
+    if (!removed) {
         SPDLOG_ERROR("Failed to remove plugin with hash {}; Plugin is not contained.", hash);
         return false;
     }
+    mSessions.closeAll(hash);
     return true;
 }
 
 bool ServerCtrl::connectClient(ServerEventStream *stream, std::uint64_t hash) noexcept
 {
-    std::scoped_lock lock(mSharedDataMtx);
-    const auto it = mSharedData.find(hash);
-    if (it == mSharedData.end()) {
+    const auto data = mPlugins.find(hash);
+    if (!data) {
         SPDLOG_ERROR("Failed to connect handle; Plugin is not contained.");
         return false;
     }
-    return it->second->addStream(stream);
-}
-
-bool ServerCtrl::connectClient(ServerEventStream *stream, std::string_view shash) noexcept
-{
-    return connectClient(stream, std::stoull(std::string(shash)));
+    return data->addStream(stream);
 }
 
 bool ServerCtrl::disconnectClient(ServerEventStream *stream, std::uint64_t hash) noexcept
 {
     if (hash != 0) {        // Fast path
-        std::scoped_lock lock(mSharedDataMtx);
-        const auto it = mSharedData.find(hash);
-        if (it == mSharedData.end()) {
+        const auto data = mPlugins.find(hash);
+        if (!data) {
             SPDLOG_ERROR("Failed to disconnect client; Plugin is not contained.");
             return false;
         }
-        return it->second->removeStream(stream);
+        return data->removeStream(stream);
     }
 
-    std::scoped_lock lock(mSharedDataMtx);
-    auto it = mSharedData.begin();
-    while (it != mSharedData.end()) {
-        if (it->second->removeStream(stream)) {
-            return true;
-        }
-        ++it;
-    }
+    if (mPlugins.anyOf([stream](std::uint64_t, const auto &data) { return data->removeStream(stream); }))
+        return true;
 
     SPDLOG_ERROR("Failed to disconnect client; Client is not contained.");
     return false;
@@ -152,7 +174,54 @@ bool ServerCtrl::disconnectClient(ServerEventStream *stream, std::uint64_t hash)
 
 std::optional<std::string> ServerCtrl::address() const
 {
+    if (auto addr = unixAddress())
+        return addr;
+    return tcpAddress();
+}
+
+std::optional<std::string> ServerCtrl::tcpAddress() const
+{
+    if (!mServer)
+        return std::nullopt;
     return mServer->address();
 }
 
+std::optional<std::string> ServerCtrl::unixAddress() const
+{
+    if (!mServer)
+        return std::nullopt;
+    return mServer->unixAddress();
+}
+
+bool ServerCtrl::setListeners(bool tcp, bool unixSocket)
+{
+    std::unique_lock lock(mServerMtx);
+    if (isRunning() || (!tcp && !unixSocket))
+        return false;
+    mListenTcp = tcp;
+    mListenUnix = unixSocket;
+    mServer.reset();
+    return true;
+}
+
+bool ServerCtrl::setCompletionQueues(std::size_t streamCqs, std::size_t callCqs)
+{
+    std::unique_lock lock(mServerMtx);
+    if (isRunning() || streamCqs == 0 || callCqs == 0)
+        return false;
+    mStreamCqs = streamCqs;
+    mCallCqs = callCqs;
+    mServer.reset();
+    return true;
+}
+
+std::string ServerCtrl::unixSocketPath()
+{
+    std::error_code ec;
+    auto dir = std::filesystem::temp_directory_path(ec);
+    if (ec)
+        dir = "/tmp";
+    return (dir / ("clap-rci-" + std::to_string(ProcessHandle::getCurrentPid()) + ".sock")).string();
+}
+
 RCLAP_END_NAMESPACE
@@ -4,8 +4,11 @@
 #include <core/global.h>
 #include "shareddata.h"
 #include "server.h"
+#include "pluginregistry.h"
+#include "sessiontable.h"
+
+#include <grpcpp/server_context.h>
 
-#include <map>
 #include <cstdint>
 
 RCLAP_BEGIN_NAMESPACE
@@ -34,32 +37,53 @@ public:
     }
     Server* server() noexcept { return mServer.get(); }
 
-    [[nodiscard]] std::optional<uint64_t> addPlugin(CorePlugin *plugin) noexcept;
+    [[nodiscard]] std::optional<uint64_t> addPlugin(CorePlugin *plugin, const QueueConfig &queues = {}) noexcept;
     bool removePlugin(uint64_t hash) noexcept;
 
     std::shared_ptr<SharedData> getSharedData(uint64_t hash) noexcept;
+    // The plugin a call is for: its Metadata::SessionId, or the Metadata::PluginHashId of
+    // clients without a session. nullopt if neither is present or valid. Doesn't allocate.
+    [[nodiscard]] std::optional<uint64_t> pluginHash(const grpc::ServerContext &ctx) const noexcept;
+    SessionTable &sessions() noexcept { return mSessions; }
+    // The Metadata::SessionId of a call, nullopt if it has none or a malformed one.
+    [[nodiscard]] static std::optional<uint64_t> sessionId(const grpc::ServerContext &ctx) noexcept;
     bool connectClient(ServerEventStream *stream, std::uint64_t hash) noexcept;
-    bool connectClient(ServerEventStream *stream, std::string_view shash) noexcept;
     bool disconnectClient(ServerEventStream *stream, std::uint64_t hash = 0) noexcept;
 
-    [[nodiscard]] std::size_t nPlugins() const noexcept { return mSharedData.size(); }
-    [[nodiscard]] std::size_t nClients(uint64_t hash) const noexcept { return mSharedData.at(hash)->nStreams(); }
+    [[nodiscard]] std::size_t nPlugins() const noexcept { return mPlugins.size(); }
+    [[nodiscard]] std::size_t nClients(uint64_t hash) const noexcept
+    {
+        const auto data = mPlugins.find(hash);
+        return data ? data->nStreams() : 0;
+    }
     [[nodiscard]] std::size_t totalClients()
     {
         std::size_t total = 0;
-        for (auto &data : mSharedData)
-            total += data.second->nStreams();
+        mPlugins.anyOf([&total](std::uint64_t, const auto &data) {
+            total += data->nStreams();
+            return false;
+        });
         return total;
     }
 
-    [[nodiscard]] std::optional<CqEventHandler*> tryGetServerStreamCqHandle() {
-        if (mSharedData.empty() || !isRunning())
-            return std::nullopt;
-        return mServer->getServerStreamCqHandle();
+    [[nodiscard]] Poller *tryGetPoller(std::uint64_t hash) {
+        if (mPlugins.size() == 0 || !isRunning())
+            return nullptr;
+        return mServer->getPoller(hash);
     }
 
     [[nodiscard]] std::chrono::milliseconds getInitTimeout() const noexcept { return mInitTimeout; }
+    // The address handed to local clients: the unix domain socket if it's listening, TCP otherwise.
     std::optional<std::string> address() const;
+    std::optional<std::string> tcpAddress() const;
+    std::optional<std::string> unixAddress() const;
+
+    // Selects the listeners of the next server start. Fails while running.
+    bool setListeners(bool tcp, bool unixSocket);
+    // Per process, so multiple hosts don't collide.
+    static std::string unixSocketPath();
+    // Completion queues of the next server start. Fails while running.
+    bool setCompletionQueues(std::size_t streamCqs, std::size_t callCqs);
 
 private:
     ServerCtrl();
@@ -67,9 +91,18 @@ private:
 private:
     std::unique_ptr<Server> mServer;
     std::mutex mServerMtx;
-
-    std::map<uint64_t, std::shared_ptr<SharedData>> mSharedData;
-    std::mutex mSharedDataMtx;
+    bool mListenTcp = true;
+    std::size_t mStreamCqs = 1;
+    std::size_t mCallCqs = 1;
+#if defined _WIN32 || defined _WIN64
+    bool mListenUnix = false;
+#else
+    bool mListenUnix = true;
+#endif
+
+    // Looked up by every call, changed only when plugins are created or destroyed.
+    PluginRegistry mPlugins;
+    SessionTable mSessions;
 
     std::chrono::milliseconds mInitTimeout{10'000}; // TODO: for now. Remove entirely in the future.
 };
@@ -0,0 +1,29 @@
+#ifndef SERVICE_H
+#define SERVICE_H
+
+#include <api.pb.h>
+#include <api.grpc.pb.h>
+
+#include <core/global.h>
+
+RCLAP_BEGIN_NAMESPACE
+
+// The asynchronous service served by all completion queues. The ServerEventStream
+// is registered as a raw method: its events are serialized once per poll round and
+// the same bytes are written to every connected client. GetParamInfos writes pages
+// of a snapshot that was serialized in advance.
+using AsyncService = api::v0::ClapInterface::WithRawMethod_ServerEventStream<
+    api::v0::ClapInterface::WithRawMethod_GetParamInfos<
+    api::v0::ClapInterface::WithAsyncMethod_GetParamStates<
+    api::v0::ClapInterface::WithAsyncMethod_ClientEventCall<
+    api::v0::ClapInterface::WithAsyncMethod_ClientParamCall<
+    api::v0::ClapInterface::WithAsyncMethod_ClientParamStream<
+    api::v0::ClapInterface::WithAsyncMethod_OpenSession<
+    api::v0::ClapInterface::WithAsyncMethod_CloseSession<
+    api::v0::ClapInterface::WithAsyncMethod_GetQueueStats<
+    api::v0::ClapInterface::Service
+>>>>>>>>>;
+
+RCLAP_END_NAMESPACE
+
+#endif // SERVICE_H
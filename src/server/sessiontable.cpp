@@ -0,0 +1,98 @@
+#include "sessiontable.h"
+
+RCLAP_BEGIN_NAMESPACE
+
+SessionTable::SessionTable(std::uint32_t capacity)
+    : mSlots(std::make_unique<Slot[]>(capacity)), mCapacity(capacity)
+{
+    mFree.reserve(capacity);
+    for (auto index = capacity; index > 0; --index)
+        mFree.push_back(index - 1);
+}
+
+std::optional<std::uint64_t> SessionTable::open(std::uint64_t pluginHash)
+{
+    std::scoped_lock lock(mMtx);
+    if (mFree.empty())
+        return std::nullopt;
+    const auto index = mFree.back();
+    mFree.pop_back();
+    auto &slot = mSlots[index];
+    // Release: a reader that sees the new hash also sees that the old session was closed.
+    slot.pluginHash.store(pluginHash, std::memory_order_release);
+    const auto generation = slot.generation.load(std::memory_order_relaxed) + 1;
+    slot.generation.store(generation, std::memory_order_release);
+    return (static_cast<std::uint64_t>(generation) << 32) | index;
+}
+
+SessionTable::Slot *SessionTable::find(std::uint64_t id) noexcept
+{
+    const auto index = static_cast<std::uint32_t>(id);
+    const auto generation = static_cast<std::uint32_t>(id >> 32);
+    if (index >= mCapacity || (generation & 1) == 0
+        || mSlots[index].generation.load(std::memory_order_relaxed) != generation)
+        return nullptr;
+    return &mSlots[index];
+}
+
+// Called with mMtx held.
+void SessionTable::release(std::uint32_t index)
+{
+    auto &slot = mSlots[index];
+    slot.generation.store(slot.generation.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    slot.streams = 0;
+    mFree.push_back(index);
+}
+
+bool SessionTable::close(std::uint64_t id)
+{
+    std::scoped_lock lock(mMtx);
+    if (!find(id))
+        return false;
+    release(static_cast<std::uint32_t>(id));
+    return true;
+}
+
+bool SessionTable::bindStream(std::uint64_t id)
+{
+    std::scoped_lock lock(mMtx);
+    auto *slot = find(id);
+    if (!slot)
+        return false;
+    ++slot->streams;
+    return true;
+}
+
+bool SessionTable::unbindStream(std::uint64_t id)
+{
+    std::scoped_lock lock(mMtx);
+    auto *slot = find(id);
+    // Closed meanwhile, by the client or with its plugin.
+    if (!slot || slot->streams == 0 || --slot->streams != 0)
+        return false;
+    release(static_cast<std::uint32_t>(id));
+    return true;
+}
+
+std::size_t SessionTable::closeAll(std::uint64_t pluginHash)
+{
+    std::size_t closed = 0;
+    std::scoped_lock lock(mMtx);
+    for (std::uint32_t index = 0; index < mCapacity; ++index) {
+        const auto &slot = mSlots[index];
+        if ((slot.generation.load(std::memory_order_relaxed) & 1) != 0
+            && slot.pluginHash.load(std::memory_order_relaxed) == pluginHash) {
+            release(index);
+            ++closed;
+        }
+    }
+    return closed;
+}
+
+std::size_t SessionTable::size() const
+{
+    std::scoped_lock lock(mMtx);
+    return mCapacity - mFree.size();
+}
+
+RCLAP_END_NAMESPACE
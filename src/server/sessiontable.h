@@ -0,0 +1,78 @@
+#ifndef SESSIONTABLE_H
+#define SESSIONTABLE_H
+
+#include <core/global.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+RCLAP_BEGIN_NAMESPACE
+
+// The sessions opened by clients, each bound to a plugin instance. A session id is the
+// slot of the session in the low 32 bits and the generation of the slot in the high
+// ones. The generation is odd while the session is open and advances when it's closed,
+// so an id never resolves to a later session of the same slot. Opening and closing
+// take a lock, resolving is wait-free.
+// A session that ServerEventStreams are bound to is closed when the last of them ends,
+// the sessions of a client that crashed don't keep their slots.
+class SessionTable
+{
+public:
+    static constexpr std::uint32_t DefaultCapacity = 4096;
+
+    explicit SessionTable(std::uint32_t capacity = DefaultCapacity);
+
+    // Returns nullopt if all slots are taken.
+    std::optional<std::uint64_t> open(std::uint64_t pluginHash);
+    bool close(std::uint64_t id);
+    // Closes the sessions of a plugin instance that is destroyed. Returns how many.
+    std::size_t closeAll(std::uint64_t pluginHash);
+    // Binds a stream to the open session \a id. Returns false if it isn't open.
+    bool bindStream(std::uint64_t id);
+    // Closes the session once no stream is bound anymore. Returns true if it was closed.
+    bool unbindStream(std::uint64_t id);
+
+    // The plugin hash of the session \a id, nullopt if it's not open.
+    [[nodiscard]] std::optional<std::uint64_t> resolve(std::uint64_t id) const noexcept
+    {
+        const auto index = static_cast<std::uint32_t>(id);
+        const auto generation = static_cast<std::uint32_t>(id >> 32);
+        if (index >= mCapacity || (generation & 1) == 0)
+            return std::nullopt;
+        const auto &slot = mSlots[index];
+        if (slot.generation.load(std::memory_order_acquire) != generation)
+            return std::nullopt;
+        const auto hash = slot.pluginHash.load(std::memory_order_acquire);
+        // The slot may have been closed and reopened in between.
+        if (slot.generation.load(std::memory_order_relaxed) != generation)
+            return std::nullopt;
+        return hash;
+    }
+
+    [[nodiscard]] std::size_t size() const;
+    [[nodiscard]] std::uint32_t capacity() const noexcept { return mCapacity; }
+
+private:
+    struct Slot
+    {
+        std::atomic<std::uint32_t> generation = 0;
+        std::atomic<std::uint64_t> pluginHash = 0;
+        std::uint32_t streams = 0; // Guarded by mMtx
+    };
+    // The slot of the open session \a id, nullptr if it isn't. Called with mMtx held.
+    Slot *find(std::uint64_t id) noexcept;
+    void release(std::uint32_t index);
+
+    std::unique_ptr<Slot[]> mSlots;
+    std::uint32_t mCapacity;
+    std::vector<std::uint32_t> mFree; // Slots to open next, the last one first
+    mutable std::mutex mMtx;
+};
+
+RCLAP_END_NAMESPACE
+
+#endif // SESSIONTABLE_H
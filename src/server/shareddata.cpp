@@ -2,19 +2,50 @@
 #include "shareddata.h"
 #include "server/tags/servereventstream.h"
 #include "serverctrl.h"
-#include "cqeventhandler.h"
+#include "poller.h"
 #include <plugin/coreplugin.h>
 
 #include <crill/progressive_backoff_wait.h>
 
+#include <algorithm>
+#include <chrono>
+
 RCLAP_BEGIN_NAMESPACE
 
-SharedData::SharedData(CorePlugin *plugin)
-    : coreplugin(plugin), mPluginProcessToClientsQueue(64), mPluginMainToClientsQueue(64), mClientsToPluginQueue(64)
+namespace {
+
+std::uint64_t nowNs() noexcept
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count());
+}
+
+void toQueueStats(const EventQueueStats &stats, QueueStats::Queue &out)
+{
+    out.set_policy(static_cast<QueueStats::OverflowPolicy>(stats.policy));
+    out.set_capacity(stats.capacity);
+    out.set_size(stats.size);
+    out.set_high_water(stats.highWater);
+    out.set_pushed(stats.pushed);
+    out.set_dropped(stats.dropped);
+    out.set_conflated(stats.conflated);
+    out.set_failures(stats.failures);
+}
+
+} // namespace
+
+SharedData::SharedData(CorePlugin *plugin, const QueueConfig &queues)
+    : coreplugin(plugin), mPluginProcessToClientsQueue(queues.process), mPluginMainToClientsQueue(queues.main),
+      mClientsToPluginQueue(queues.clients)
 {
     assert(plugin != nullptr);
+    if (queues.main.policy != mPluginMainToClientsQueue.options().policy)
+        SPDLOG_WARN("Main thread events can't be conflated by param, they are dropped instead");
 }
 
+SharedData::~SharedData() = default;
+
 bool SharedData::addCorePlugin(CorePlugin *plugin)
 {
     assert(plugin != nullptr);
@@ -27,22 +58,74 @@ bool SharedData::addCorePlugin(CorePlugin *plugin)
 bool SharedData::addStream(ServerEventStream *stream)
 {
     assert(stream != nullptr);
-    return streams.insert(stream).second;
+    {
+        std::scoped_lock lock(mStreamsMtx);
+        if (std::find(streams.begin(), streams.end(), stream) != streams.end())
+            return false;
+        streams.push_back(stream);
+        mNumStreams.store(streams.size(), std::memory_order_release);
+        bool shm = false;
+        if (stream->wantsSharedMemory()) {
+            if (mShmRing && !mShmStream) {
+                mShmRing->reset();
+                mShmStream = stream;
+                shm = true;
+            } else {
+                SPDLOG_WARN("No shared memory ring available for {}, using the stream", toTag(stream));
+            }
+        }
+        if (!shm) {
+            if (stream->hasOwnBatch())
+                mOwnBatchStreams.push_back(stream);
+            else
+                ++mNumEncodingStreams[stream->encoding()];
+        }
+        // Under the lock, before the next poll round: every param event the stream misses
+        // is contained in the snapshot or the replay, the ones it still gets are newer.
+        if (!resumeStream(stream))
+            sendParamStates(stream);
+        ++mStreamGeneration;
+    }
+    notifyReady();
+    return true;
 }
 
 bool SharedData::removeStream(ServerEventStream *stream)
 {
     assert(stream != nullptr);
-    return streams.erase(stream) == 1;
+    std::scoped_lock lock(mStreamsMtx);
+    if (std::erase(streams, stream) != 1)
+        return false;
+    mNumStreams.store(streams.size(), std::memory_order_release);
+    if (stream == mShmStream) {
+        mShmRing->close();
+        mShmStream = nullptr;
+    } else if (stream->hasOwnBatch()) {
+        std::erase(mOwnBatchStreams, stream);
+    } else {
+        --mNumEncodingStreams[stream->encoding()];
+    }
+    return true;
+}
+
+bool SharedData::waitForStream(std::uint64_t generation, std::chrono::milliseconds timeout)
+{
+    std::unique_lock lock(mReadyMtx);
+    return mReadyCv.wait_for(lock, timeout, [&] {
+        return mStreamGeneration > generation && pollRunning && !pollStop;
+    });
 }
 
-std::size_t SharedData::nStreams() const
+void SharedData::notifyReady()
 {
-    return streams.size();
+    // Pairs with the predicate check of waitForStream(), so the wakeup can't get lost.
+    { std::scoped_lock lock(mReadyMtx); }
+    mReadyCv.notify_all();
 }
 
 std::optional<ServerEventStream*> SharedData::findStream(ServerEventStream *that)
 {
+    std::scoped_lock lock(mStreamsMtx);
     const auto it = std::find_if(streams.begin(), streams.end(), [&](const auto &stream) {
         return stream == that;
     });
@@ -51,91 +134,257 @@ std::optional<ServerEventStream*> SharedData::findStream(ServerEventStream *that
     return *it;
 }
 
+// Lock-free, the audio and main thread ask while a poll round holds the streams.
 bool SharedData::isValid() const noexcept
 {
-    return coreplugin && !streams.empty();
+    return coreplugin && nStreams() != 0;
 }
 
-bool SharedData::blockingVerifyEvent(Event e) {
-    Event extracted;
+// Called by the main thread. Waits for the client to acknowledge \a e and completes
+// its ClientEventCall.
+bool SharedData::blockingVerifyEvent(Event e)
+{
     SPDLOG_TRACE("Waiting for event: {}", static_cast<int>(e));
-    bool ok = mBlockingClientEventQueue.waitDequeueTimed(extracted, ServerCtrl::instance().getInitTimeout());
-    if (!ok) {
-        SPDLOG_ERROR("create error; No response from GUI proc");
-        return false;
+    PendingClientEvent pending;
+    {
+        std::unique_lock lock(mClientEventsMtx);
+        const auto ready = mClientEventsCv.wait_for(lock, ServerCtrl::instance().getInitTimeout(), [this] {
+            return !mPendingClientEvents.empty();
+        });
+        if (!ready) {
+            SPDLOG_ERROR("create error; No response from GUI proc");
+            return false;
+        }
+        pending = std::move(mPendingClientEvents.front());
+        mPendingClientEvents.pop_front();
     }
 
-    if (extracted != e) {
-        SPDLOG_ERROR("Unexpected event! Got: {}, Want: {}", static_cast<int>(extracted), static_cast<int>(e));
-        return false;
+    const bool verified = pending.event == e;
+    if (!verified)
+        SPDLOG_ERROR("Unexpected event! Got: {}, Want: {}", static_cast<int>(pending.event), static_cast<int>(e));
+    pending.done(verified);
+    return verified;
+}
+
+// The handshake of the GUI. Unlike the blocking queue it replaces, no server thread waits
+// for the main thread: the call completes from the done callback.
+std::optional<std::uint64_t> SharedData::pushClientEvent(Event e, ClientEventDone &&done)
+{
+    std::uint64_t ticket = 0;
+    {
+        std::scoped_lock lock(mClientEventsMtx);
+        if (mPendingClientEvents.size() >= MaxPendingClientEvents)
+            return std::nullopt;
+        ticket = mNextClientEventTicket++;
+        mPendingClientEvents.push_back({ ticket, e, std::move(done) });
     }
+    mClientEventsCv.notify_one();
+    return ticket;
+}
 
+bool SharedData::cancelClientEvent(std::uint64_t ticket)
+{
+    std::scoped_lock lock(mClientEventsMtx);
+    const auto it = std::find_if(mPendingClientEvents.begin(), mPendingClientEvents.end(), [&](const auto &p) {
+        return p.ticket == ticket;
+    });
+    if (it == mPendingClientEvents.end())
+        return false;
+    mPendingClientEvents.erase(it);
     return true;
 }
 
-// The previous event _has_ to be consumed. This is a blocking call and can only enqueue a single event.
-// It is used to synchronize the GUI startup.
-// TODO: Upon switch to client-streams/bi-dir streams, improve this.
-bool SharedData::blockingPushClientEvent(Event e)
+std::size_t SharedData::nPendingClientEvents() const
 {
-    return mBlockingClientEventQueue.waitEnqueueTimed(e, ServerCtrl::instance().getInitTimeout());
+    std::scoped_lock lock(mClientEventsMtx);
+    return mPendingClientEvents.size();
 }
 
 // Potentially blocks the Client upon equeueing.
 void SharedData::pushClientParam(const ClientParams &ev)
 {
-    for (const auto &p : ev.params()) {
+    int next = 0;
+    crill::progressive_backoff_wait([&] {
+        next = tryPushClientParams(ev, next);
+        return next == ev.params_size();
+    });
+}
+
+int SharedData::tryPushClientParams(const ClientParams &ev, int first)
+{
+    std::scoped_lock lock(mClientsToPluginMtx);
+    for (int i = first; i < ev.params_size(); ++i) {
+        const auto &p = ev.params(i);
         // If the timestamp is older than the last one we will discard this event to avoid
         // incorrect behavior if multiple clients are connected.
-        if (!mLastClientStamp.setIfNewer(p.timestamp().seconds(), p.timestamp().nanos())) {
+        const Stamp stamp(p.timestamp().seconds(), p.timestamp().nanos());
+        if (stamp <= mLastClientStamp) {
             SPDLOG_TRACE("ClientParam timestamp is in the past");
             continue;
         }
-        crill::progressive_backoff_wait([&] {
-            SPDLOG_TRACE("Pushing client param: {}s {}ns, value {}", p.timestamp().seconds(), p.timestamp().nanos(), p.param().value());
-            return mClientsToPluginQueue.push(ClientParamWrapper(p));
-        });
+        SPDLOG_TRACE("Pushing client param: {}s {}ns, value {}", p.timestamp().seconds(), p.timestamp().nanos(), p.param().value());
+        // With DropNewest the clients wait for room. The other policies make room, what
+        // they drop is counted by the queue.
+        if (mClientsToPluginQueue.options().policy != OverflowPolicy::DropNewest)
+            mClientsToPluginQueue.push(ClientParamWrapper(p));
+        else if (!mClientsToPluginQueue.tryPush(ClientParamWrapper(p)))
+            return i;
+        mLastClientStamp = stamp;
     }
+    return ev.params_size();
+}
+
+void SharedData::queueStats(QueueStats &out) const
+{
+    toQueueStats(mPluginProcessToClientsQueue.stats(), *out.mutable_process());
+    toQueueStats(mPluginMainToClientsQueue.stats(), *out.mutable_main());
+    toQueueStats(mClientsToPluginQueue.stats(), *out.mutable_clients());
+}
+
+void SharedData::sendParamStates(ServerEventStream *stream)
+{
+    if (mParamStates.size() == 0)
+        return;
+    ServerEvents evs;
+    mParamStates.read(*evs.mutable_param_states());
+    grpc::ByteBuffer bytes;
+    bool ownBuffer = false;
+    if (!grpc::SerializationTraits<ServerEvents>::Serialize(evs, &bytes, &ownBuffer).ok()
+        || !stream->sendEvents(bytes))
+        SPDLOG_WARN("Failed to send the param states to {}", toTag(stream));
+}
+
+// Replays the batches a reconnecting client missed. Returns false if it didn't ask to
+// resume or the history doesn't reach back far enough.
+bool SharedData::resumeStream(ServerEventStream *stream)
+{
+    const auto seq = stream->resumeAfterSeq();
+    if (seq == 0)
+        return false;
+    std::optional<grpc::ByteBuffer> missed;
+    {
+        std::scoped_lock lock(mHistoryMtx);
+        missed = mHistory.replayAfter(seq);
+    }
+    if (!missed) {
+        SPDLOG_INFO("Can't resume {} after seq {}, sending the param states", toTag(stream), seq);
+        return false;
+    }
+    return missed->Length() == 0 || stream->sendEvents(*missed);
+}
+
+std::uint64_t SharedData::recordHistory()
+{
+    std::scoped_lock lock(mHistoryMtx);
+    mEncoder.setSeq(mHistory.nextSeq());
+    mEncodedData = grpc::ByteBuffer(&mHistory.append(mEncoder.bytes()), 1);
+    return mHistory.lastSeq();
+}
+
+std::uint64_t SharedData::lastSeq() const
+{
+    std::scoped_lock lock(mHistoryMtx);
+    return mHistory.lastSeq();
 }
 
-// Start polling. This will run the callback and enqueue itself again, if there are active clients.
-// We poll all events out of the queues and send them to _all_ connected clients.
+void SharedData::setParamInfos(std::shared_ptr<const ParamInfoSnapshot> infos)
+{
+    std::scoped_lock lock(mParamInfosMtx);
+    mParamInfos = std::move(infos);
+}
+
+std::shared_ptr<const ParamInfoSnapshot> SharedData::paramInfos() const
+{
+    std::scoped_lock lock(mParamInfosMtx);
+    return mParamInfos;
+}
+
+// Start polling. The Poller of our stream queue polls all events out of the queues
+// and sends them to _all_ connected clients, as long as there are active clients.
 bool SharedData::tryStartPolling()
 {
-    if (!isValid() || pollRunning)
+    // Streams of this instance can connect on different queues at the same time.
+    bool expected = false;
+    if (!isValid() || !pollRunning.compare_exchange_strong(expected, true))
         return false;
 
-    auto cq = ServerCtrl::instance().tryGetServerStreamCqHandle();
-    if (cq && *cq != nullptr) {
-        mServerStreamCq = *cq;
-    } else {
-        SPDLOG_ERROR("Failed to get CqEventHandler");
+    // The poller keeps the instance alive until polling ended.
+    const auto hash = toHash(coreplugin);
+    auto *poller = ServerCtrl::instance().tryGetPoller(hash);
+    auto self = ServerCtrl::instance().getSharedData(hash);
+    if (!poller || self.get() != this) {
+        SPDLOG_ERROR("Failed to get Poller");
+        pollRunning = false;
         return false;
     }
 
-    pollRunning = true;
-    mServerStreamCq->enqueueFn([this](bool ok){ this->pollCallback(ok); }, mPollFreqNs);
+    pollStop = false;
+    mCurrExpBackoff = mPollFreqNs;
+    mPoller = poller;
+    poller->add(std::move(self));
+    notifyReady();
     return true;
 }
 
-void SharedData::pollCallback(bool ok)
+// The streams decide on the ring under mStreamsMtx, it's published under the same lock.
+// Mapped outside of it, a poll round doesn't wait for that.
+bool SharedData::createShmRing(std::size_t capacity)
 {
-    static auto endCallback = [&]() -> void {
-        pollRunning = false;
-        drainPollingQueue();
-    };
+    if (shmRing())
+        return true;
+    auto ring = ShmRing::create(capacity);
+    if (!ring)
+        return false;
+    std::scoped_lock lock(mStreamsMtx);
+    if (!mShmRing)
+        mShmRing = std::make_unique<ShmRing>(std::move(*ring));
+    return true;
+}
 
-    if (!ok || !coreplugin || !mServerStreamCq) {
-        SPDLOG_TRACE(
-            "PollCallback stopped: ok: {}, coreplugin: {}, mServerStreamCq: {}",
-            ok, coreplugin == nullptr, mServerStreamCq == nullptr
-        );
-        return endCallback();
+const ShmRing *SharedData::shmRing() const
+{
+    std::scoped_lock lock(mStreamsMtx);
+    return mShmRing.get();
+}
+
+bool SharedData::setPollMode(PollMode mode) noexcept
+{
+    if (pollRunning)
+        return false;
+    mPollMode = mode;
+    return true;
+}
+
+void SharedData::notify() noexcept
+{
+    // Only the first notify() after a sweep has to look at the poller.
+    if (mActive.exchange(true))
+        return;
+    if (auto *poller = mPoller.load())
+        poller->wake();
+}
+
+void SharedData::endPolling()
+{
+    mPoller = nullptr;
+    pollRunning = false;
+    clearStagedEvents();
+    drainPollingQueue();
+}
+
+std::optional<uint64_t> SharedData::poll()
+{
+    if (!coreplugin) {
+        SPDLOG_TRACE("Poll stopped: no coreplugin");
+        endPolling();
+        return std::nullopt;
     }
 
+    std::scoped_lock lock(mStreamsMtx);
     if (streams.empty()) {
         SPDLOG_ERROR("No streams connected. Stop polling.");
-        return endCallback();
+        endPolling();
+        return std::nullopt;
     }
 
     if (pollStop) { // Signal the end of streaming to our clients.
@@ -143,67 +392,156 @@ void SharedData::pollCallback(bool ok)
             if (!stream->endStream())
                 SPDLOG_ERROR("Failed to end stream {}", toTag(stream));
         }
-        SPDLOG_TRACE("PollCallback stopped: stop signal received");
-        return endCallback();
+        SPDLOG_TRACE("Poll stopped: stop signal received");
+        endPolling();
+        return std::nullopt;
     }
 
-    const auto nProcessEvs = consumeEventToStream(mPluginProcessToClientsQueue); // Consume events from process thread
-    const auto nMainEvs = consumeEventToStream(mPluginMainToClientsQueue); // Consume events from main thread
-//    SPDLOG_TRACE("{} {}, time: {}", nProcessEvs, nMainEvs, mCurrExpBackoff);
-    if (nProcessEvs == 0 && nMainEvs == 0) {
-        // We have no events to send, so we can just wait for the next callback with an increased backoff.
-        mServerStreamCq->enqueueFn([this](bool ok){ this->pollCallback(ok); }, nextExpBackoff());
-        return;
+    [[maybe_unused]] const auto nProcessEvs = consumeEventToStream<ProcessEventRecord>(mPluginProcessToClientsQueue, true); // Consume events from process thread
+    [[maybe_unused]] const auto nMainEvs = consumeEventToStream<ServerEventWrapper>(mPluginMainToClientsQueue, false); // Consume events from main thread
+    const auto now = mOwnBatchStreams.empty() ? 0 : nowNs();
+    const auto conflatedDueNs = flushConflated(now);
+    // Conflated params that are still pending need a poll once they are due, even without
+    // any further events. Other events don't wait for that deadline in PollMode::Wakeup,
+    // their notify() wakes the poller, see Poller::wake().
+    const auto untilConflated = [&](uint64_t deferNs) {
+        return conflatedDueNs == 0 ? deferNs : std::min(deferNs, conflatedDueNs - now);
+    };
+    // Every round with events is numbered and kept, whether or not a stream takes it:
+    // the history must be complete for the clients that resume. So is a round that only
+    // sends conflated params, a seq is never reused.
+    const bool send = hasStagedEvents();
+    if (send || !mEncoder.empty())
+        mRoundSeq = recordHistory();
+    if (!send) {
+        // No stream wants any of the events. Either wait until a producer flags us, or
+        // for the next poll with an increased backoff.
+        clearStagedEvents();
+        return untilConflated(mPollMode == PollMode::Wakeup ? Poller::Idle : nextExpBackoff());
+    }
+    // If we reached this point, we have events to send. They are already encoded,
+    // hand the same buffer to all streams of an encoding.
+    if (!mPackedEncoder.empty()) {
+        mPackedEncoder.setSeq(mRoundSeq);
+        mPackedData = mPackedEncoder.toByteBuffer();
+    }
+    if (!mShmControlEncoder.empty()) {
+        mShmControlEncoder.setSeq(mRoundSeq);
+        mShmControlData = mShmControlEncoder.toByteBuffer();
     }
-    // If we reached this point, we have events to send.
     bool success = false;
-    Timestamp ts;
+    if (mShmStream && !mShmEncoder.empty()) {
+        mShmEncoder.setSeq(mRoundSeq);
+        // The GUI can't keep up. Like the streams, drop rather than stall the others.
+        if (!mShmRing->write(mShmEncoder.bytes()) && mShmDroppedBatches++ == 0)
+            SPDLOG_WARN("Shared memory ring is full, dropping batches");
+        success = true;
+    }
     for (auto stream : streams) {       // For all streams/clients
-        if (stream->sendEvents(mPluginToClientsData))     // try to pump some events.
+        const auto *batch = stagedBatch(stream);
+        // Streams that connected during this round have nothing staged in their encoding yet.
+        if (!batch)
+            continue;
+        // A stream only refuses once it ends. It tells its client to resume after the last
+        // seq it received, the batch is replayed from the history.
+        if (stream->sendEvents(*batch))
             success = true;
     }
 
     if (!success) {
-        SPDLOG_ERROR("Failed to send events to {} clients.", streams.size());
-        mServerStreamCq->enqueueFn([this](bool ok){ this->pollCallback(ok); }, nextExpBackoff());
-        return;
+        SPDLOG_DEBUG("No stream took round {}, the clients resume from the history", mRoundSeq);
+        clearStagedEvents();
+        return untilConflated(nextExpBackoff());
     }
 
-    // Succefully completed a round. Enqueue the next callback with refgular poll-frequency and reset the backoff.
-    mPluginToClientsData.Clear();
+    // Succefully completed a round. Poll again with regular poll-frequency and reset the backoff.
+    // Events that arrive in Wakeup mode meanwhile flag the instance again.
+    clearStagedEvents();
     mCurrExpBackoff = mPollFreqNs;
-    mServerStreamCq->enqueueFn([this](bool ok){ this->pollCallback(ok); }, mPollFreqNs);
-    SPDLOG_TRACE("PollCallback has sent: {} Process Events and {} Main Events", nProcessEvs, nMainEvs);
+    SPDLOG_TRACE("Poll has sent: {} Process Events and {} Main Events", nProcessEvs, nMainEvs);
+    return untilConflated(mPollMode == PollMode::Wakeup ? Poller::Idle : mPollFreqNs);
 }
 
 bool SharedData::stopPoll()
 {
-    if (!coreplugin || !mServerStreamCq || !pollRunning) {
+    auto *poller = mPoller.load();
+    if (!coreplugin || !poller || !pollRunning) {
         SPDLOG_TRACE(
-            "stopPoll: coreplugin: {}, mServerStreamCq: {}, pollRunning: {}",
-             coreplugin == nullptr, mServerStreamCq == nullptr, pollRunning
+            "stopPoll: coreplugin: {}, poller: {}, pollRunning: {}",
+             coreplugin == nullptr, poller == nullptr, pollRunning
         );
         return false;
     }
 
     pollStop = true;
+    mActive = true;
+    poller->wake();
     return true;
 }
 
 
+// No stream is left to send to. The events are kept in the history, for the clients
+// that resume.
 size_t SharedData::drainPollingQueue()
 {
     size_t cnt = 0;
-    ServerEventWrapper tmp;
-    while (mPluginProcessToClientsQueue.pop(tmp))
+    ProcessEventRecord rec;
+    while (mPluginProcessToClientsQueue.pop(rec)) {
+        mEncoder.add(rec.toWrapper());
         ++cnt;
-    while (mPluginMainToClientsQueue.pop(tmp))
+    }
+    ServerEventWrapper tmp;
+    while (mPluginMainToClientsQueue.pop(tmp)) {
+        mEncoder.add(tmp);
         ++cnt;
+    }
+    if (!mEncoder.empty())
+        recordHistory();
+    mEncoder.clear();
     SPDLOG_TRACE("Drained {} events from polling queue", cnt);
     return cnt;
 }
 
 
+void SharedData::clearStagedEvents() noexcept
+{
+    mEncoder.clear();
+    mPackedEncoder.clear();
+    mShmEncoder.clear();
+    mShmControlEncoder.clear();
+    for (auto *stream : mOwnBatchStreams)
+        stream->clearStaged();
+    mOwnBatchStaged = false;
+}
+
+void SharedData::stageOwnBatches(const ServerEventWrapper &ev)
+{
+    for (auto *stream : mOwnBatchStreams)
+        mOwnBatchStaged |= stream->stage(ev);
+}
+
+uint64_t SharedData::flushConflated(uint64_t nowNs)
+{
+    uint64_t nextDueNs = 0;
+    for (auto *stream : mOwnBatchStreams) {
+        mOwnBatchStaged |= stream->flushConflated(nowNs);
+        if (const auto due = stream->conflatedDueNs(); due && (nextDueNs == 0 || *due < nextDueNs))
+            nextDueNs = *due;
+    }
+    return nextDueNs;
+}
+
+const grpc::ByteBuffer *SharedData::stagedBatch(ServerEventStream *stream)
+{
+    if (stream == mShmStream)
+        return mShmControlEncoder.empty() ? nullptr : &mShmControlData;
+    if (stream->hasOwnBatch())
+        return stream->finishStaged(mRoundSeq);
+    if (stream->encoding() == ClientRequest_Encoding_Packed)
+        return mPackedEncoder.empty() ? nullptr : &mPackedData;
+    return mEncoder.empty() ? nullptr : &mEncodedData;
+}
+
 uint64_t SharedData::nextExpBackoff()
 {
     mCurrExpBackoff = (mCurrExpBackoff < mExpBackoffLimitNs) ? mCurrExpBackoff * 2 : mExpBackoffLimitNs;
@@ -211,6 +549,7 @@ uint64_t SharedData::nextExpBackoff()
 }
 void SharedData::endStreams()
 {
+    std::scoped_lock lock(mStreamsMtx);
     for (auto stream : streams) {
         if (!stream->endStream())
             SPDLOG_ERROR("Failed to end stream {}", toTag(stream));
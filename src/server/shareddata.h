@@ -3,146 +3,252 @@
 #include <core/logging.h>
 #include <core/global.h>
 #include <core/timestamp.h>
-#include <core/blkringqueue.h>
+#include <core/shmring.h>
 #include "wrappers.h"
+#include "eventencoder.h"
+#include "eventqueue.h"
+#include "eventhistory.h"
+#include "paraminfosnapshot.h"
+#include "paramstate.h"
 
-#include <farbot/fifo.hpp>
+#include <grpcpp/support/byte_buffer.h>
 
-#include <set>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <vector>
 #include <memory>
+#include <mutex>
 #include <optional>
 
 RCLAP_BEGIN_NAMESPACE
 
+// The consumers are the server threads, see EventQueue for why they can be several.
 template <typename T>
-using SPMRQueue = farbot::fifo<T,
-    farbot::fifo_options::concurrency::multiple,                // consumer: server-thread
-    farbot::fifo_options::concurrency::single,                  // producer: audio-thread
-    farbot::fifo_options::full_empty_failure_mode::return_false_on_full_or_empty,
-    farbot::fifo_options::full_empty_failure_mode::return_false_on_full_or_empty>;
+using SPMRQueue = EventQueue<T, farbot::fifo_options::concurrency::single>;
 template <typename T>
-using MPMRQueue = farbot::fifo<T,
-    farbot::fifo_options::concurrency::multiple,
-    farbot::fifo_options::concurrency::multiple,
-    farbot::fifo_options::full_empty_failure_mode::return_false_on_full_or_empty,
-    farbot::fifo_options::full_empty_failure_mode::overwrite_or_return_default>;
-template <typename T>
-using SPSC = farbot::fifo<T,
-    farbot::fifo_options::concurrency::single,
-    farbot::fifo_options::concurrency::single,
-    farbot::fifo_options::full_empty_failure_mode::return_false_on_full_or_empty,
-    farbot::fifo_options::full_empty_failure_mode::return_false_on_full_or_empty>;
+using MPMRQueue = EventQueue<T, farbot::fifo_options::concurrency::multiple>;
 
 class CorePlugin;
 class ServerEventStream;
-class CqEventHandler;
+class Poller;
 
 // The shared data between <Audio, Main> <=> <Server, CQs>
 class SharedData
 {
 public:
-    explicit SharedData(CorePlugin *plugin);
+    // Backoff: poll every mPollFreqNs and back off exponentially when idle.
+    // Wakeup:  skipped by the poller while the queues are empty, producers flag the instance via notify().
+    enum class PollMode { Backoff, Wakeup };
+
+    explicit SharedData(CorePlugin *plugin, const QueueConfig &queues = {});
+    ~SharedData();
 
     bool addCorePlugin(CorePlugin *plugin);
     bool addStream(ServerEventStream *stream);
     bool removeStream(ServerEventStream *stream);
     std::optional<ServerEventStream*> findStream(ServerEventStream *that);
 
-    // Used to sync Main <-> ClientEventCall
+    // Used to sync Main <-> ClientEventCall. Called with true if the main thread
+    // consumed the expected event, false otherwise.
+    using ClientEventDone = std::function<void(bool)>;
     bool blockingVerifyEvent(Event e);
-    bool blockingPushClientEvent(Event e);
+    // Non-blocking. Queues a client acknowledgement for blockingVerifyEvent(), \a done is
+    // called on the main thread once it was consumed. Returns a ticket, or std::nullopt
+    // if too many acknowledgements are pending.
+    std::optional<std::uint64_t> pushClientEvent(Event e, ClientEventDone &&done);
+    // Withdraws a pending acknowledgement. Returns false if it was already consumed, its
+    // done callback is called then.
+    bool cancelClientEvent(std::uint64_t ticket);
+    [[nodiscard]] std::size_t nPendingClientEvents() const;
 
     void pushClientParam(const ClientParams &ev);
+    // Non-blocking. Pushes the params of \a ev, starting at \a first, until the queue is full.
+    // Returns the index of the first param that didn't fit, or ev.params_size() if all did.
+    int tryPushClientParams(const ClientParams &ev, int first = 0);
     void endStreams();
 
+    // Replaces the param infos served by GetParamInfos. Calls that are in flight keep
+    // the snapshot they started with.
+    void setParamInfos(std::shared_ptr<const ParamInfoSnapshot> infos);
+    [[nodiscard]] std::shared_ptr<const ParamInfoSnapshot> paramInfos() const;
+    // Fed by the params of the plugin, read by GetParamStates and connecting streams.
+    ParamStateTable &paramStates() noexcept { return mParamStates; }
+    [[nodiscard]] const ParamStateTable &paramStates() const noexcept { return mParamStates; }
+    // The ServerEvents.seq of the last batch with events.
+    [[nodiscard]] std::uint64_t lastSeq() const;
 
-    [[nodiscard]] std::size_t nStreams() const;
+
+    [[nodiscard]] std::size_t nStreams() const noexcept { return mNumStreams.load(std::memory_order_acquire); }
+    // Incremented for every stream that connects.
+    [[nodiscard]] std::uint64_t streamGeneration() const noexcept { return mStreamGeneration; }
+    // Waits until a stream connected after \a generation is polled. Streams of a previous
+    // client may still be connected, they don't count. Returns false after \a timeout.
+    bool waitForStream(std::uint64_t generation, std::chrono::milliseconds timeout);
     [[nodiscard]] bool isValid() const noexcept;
 
     auto &pluginToClientsQueue() { return mPluginProcessToClientsQueue; }
     auto &pluginMainToClientsQueue() { return mPluginMainToClientsQueue; }
     auto &clientsToPluginQueue() { return mClientsToPluginQueue; }
+    // The counters of the queues above, served by GetQueueStats.
+    void queueStats(QueueStats &out) const;
 
     bool tryStartPolling();
     bool stopPoll();
     bool isPolling() const noexcept { return pollRunning; }
 
+    // Must be set before polling is started.
+    bool setPollMode(PollMode mode) noexcept;
+    [[nodiscard]] PollMode pollMode() const noexcept { return mPollMode; }
+    // Called by the producers after pushing to one of the plugin queues. Flags the instance
+    // as active for the next sweep of its Poller. Lock-free, and wait-free unless the poller
+    // is wakeable, in which case a single immediate alarm is set. Safe on the audio thread.
+    void notify() noexcept;
+
+    // Creates the shared memory ring for the GUI process. Must be called from the main
+    // thread before the GUI is spawned. An existing ring is reused, it lives as long as
+    // the instance.
+    bool createShmRing(std::size_t capacity);
+    [[nodiscard]] const ShmRing *shmRing() const;
+    [[nodiscard]] std::uint64_t shmDroppedBatches() const noexcept { return mShmDroppedBatches; }
+
 private:
+    friend class Poller;
+
     size_t drainPollingQueue();
-    // Polling Callback responsible for handling all events from the plugin.
-    void pollCallback(bool ok);
+    // Called by the Poller. Sends all events from the plugin to the clients. Returns the
+    // nanoseconds until the next poll, Poller::Idle to wait for notify() or nullopt once
+    // polling ended.
+    std::optional<uint64_t> poll();
+    void endPolling();
+    void notifyReady();
+    // Queues the current param states as the first message of \a stream.
+    void sendParamStates(ServerEventStream *stream);
+    bool resumeStream(ServerEventStream *stream);
+    // Numbers the batch of mEncoder and keeps it, even an empty one. Returns the seq of the round.
+    std::uint64_t recordHistory();
     uint64_t nextExpBackoff();
+    // Whether any stream gets a batch this round. mEncoder is always staged, for the
+    // history, but only sent to unfiltered Events streams.
+    bool hasStagedEvents() const noexcept
+    {
+        return (!mEncoder.empty() && mNumEncodingStreams[ClientRequest_Encoding_Events] != 0)
+            || !mPackedEncoder.empty() || !mShmEncoder.empty() || !mShmControlEncoder.empty() || mOwnBatchStaged;
+    }
+    void clearStagedEvents() noexcept;
+    // Streams with a subscription or conflated params encode on their own.
+    void stageOwnBatches(const ServerEventWrapper &ev);
+    // Stages the conflated params that are due. Returns when the next ones are, or 0.
+    uint64_t flushConflated(uint64_t nowNs);
+    const grpc::ByteBuffer *stagedBatch(ServerEventStream *stream);
 
     std::string evToString(const Event &ev)
     {
         // TODO: better position and implement
         return {};
     }
-    uint64_t consumeEventToStream(auto &queue) {
-        ServerEventWrapper out;
-        // consume all events and copy them to our response.
+    // Consumes all events of a queue and encodes them straight into the wire format.
+    template <typename T>
+    uint64_t consumeEventToStream(auto &queue, bool isProcessQueue) {
+        T out;
         uint64_t cnt = 0;
         while(queue.pop(out)) {
             ++cnt;
-            auto *next = mPluginToClientsData.mutable_events()->Add();
-            // ServerEventWrapper syncs with ServerEvent. Collect the types.
-            std::visit([&](auto &&arg) {
-                using T = std::decay_t<decltype(arg)>;
-                next->set_event(out.ev);
-                // SPDLOG_TRACE("Consumed event: {}", evToString(out.ev));
-                if constexpr (std::is_same_v<T, ClapEventNoteWrapper>) {
-                    next->mutable_note()->set_note_id(arg.noteId);
-                    next->mutable_note()->set_port_index(arg.portIndex);
-                    next->mutable_note()->set_channel(arg.channel);
-                    next->mutable_note()->set_key(arg.key);
-                    next->mutable_note()->set_value(arg.value);
-                    next->mutable_note()->set_type(arg.getType());
-                    next->mutable_note()->set_expression(arg.getExpressionType());
-                } else if constexpr (std::is_same_v<T, ClapEventParamWrapper>) {
-                    next->mutable_param()->set_param_id(arg.paramId);
-                    next->mutable_param()->set_value(arg.value);
-                    next->mutable_param()->set_modulation(arg.modulation);
-                } else if constexpr (std::is_same_v<T, ClapEventParamInfoWrapper>) {
-                    next->mutable_param_info()->set_param_id(arg.paramId);
-                    next->mutable_param_info()->set_name(arg.name);
-                    next->mutable_param_info()->set_module(arg.module);
-                    next->mutable_param_info()->set_min_value(arg.minValue);
-                    next->mutable_param_info()->set_max_value(arg.maxValue);
-                    next->mutable_param_info()->set_default_value(arg.defaultValue);
-                } else if constexpr (std::is_same_v<T, ClapEventMainSyncWrapper>) {
-                    next->mutable_main_sync()->set_window_id(arg.windowId);
-                } else {
-                    assert(false);
-                }
-            }, out.data);
+            if constexpr (std::is_same_v<T, ProcessEventRecord>)
+                stageEvent(out.toWrapper(), isProcessQueue);
+            else
+                stageEvent(out, isProcessQueue);
         }
         return cnt;
     }
+    void stageEvent(const ServerEventWrapper &ev, bool isProcessQueue)
+    {
+        // The shared memory stream gets the process events through the ring.
+        if (mShmStream)
+            (isProcessQueue ? mShmEncoder : mShmControlEncoder).add(ev);
+        // Always encoded for the history, Events streams share the batch. Otherwise only
+        // encode what the connected clients asked for.
+        mEncoder.add(ev);
+        if (mNumEncodingStreams[ClientRequest_Encoding_Packed] != 0)
+            mPackedEncoder.add(ev);
+        if (!mOwnBatchStreams.empty())
+            stageOwnBatches(ev);
+    }
 
 private:
     CorePlugin *coreplugin = nullptr;
-    std::set<ServerEventStream*> streams;
+    std::vector<ServerEventStream*> streams; // Iterated by every poll round
+    std::atomic<std::size_t> mNumStreams = 0; // Read without the lock
+    // Streams connect and disconnect on any stream queue, the Poller runs on the queue
+    // of this instance. Held for a whole poll round.
+    mutable std::mutex mStreamsMtx;
+    std::atomic<std::uint64_t> mStreamGeneration = 0;
+    std::mutex mReadyMtx;
+    std::condition_variable mReadyCv;
 
     // Poll callback
-    ServerEvents mPluginToClientsData; // GRPC server response
-    CqEventHandler *mServerStreamCq = nullptr;
+    EventEncoder mEncoder;             // Staged events of the current round
+    PackedEventEncoder mPackedEncoder; // The same events for ClientRequest::Packed streams
+    grpc::ByteBuffer mEncodedData;     // mEncoder's batch, shared by all streams
+    grpc::ByteBuffer mPackedData;      // mPackedEncoder's batch
+    std::array<std::size_t, ClientRequest_Encoding_Encoding_ARRAYSIZE> mNumEncodingStreams = {}; // Unfiltered
+    std::vector<ServerEventStream *> mOwnBatchStreams;
+    bool mOwnBatchStaged = false;
+    std::uint64_t mRoundSeq = 0;
+
+    // The batches of mEncoder, for clients that resume. Appended by the poll round and
+    // when polling ends, read by connecting streams.
+    EventHistory mHistory;
+    mutable std::mutex mHistoryMtx;
+
+    // Shared memory transport of the GUI process
+    std::unique_ptr<ShmRing> mShmRing; // Set once, under mStreamsMtx
+    ServerEventStream *mShmStream = nullptr;
+    EventEncoder mShmEncoder;          // Process events, written to the ring
+    EventEncoder mShmControlEncoder;   // Main thread events, sent through mShmStream
+    grpc::ByteBuffer mShmControlData;
+    std::uint64_t mShmDroppedBatches = 0;
     std::atomic<bool> pollRunning = false;
     std::atomic<bool> pollStop = false;
     static constexpr uint64_t mPollFreqNs = 5'000; // 5 us
     static constexpr uint64_t mExpBackoffLimitNs = 250'000;
     uint64_t mCurrExpBackoff = mPollFreqNs;
+    PollMode mPollMode = PollMode::Backoff;
+
+    // Activity tracking of the Poller
+    std::atomic<Poller *> mPoller = nullptr;
+    std::atomic<bool> mActive = false;
+    static_assert(std::atomic<bool>::is_always_lock_free);
+    uint64_t mNextPollNs = 0; // Owned by the poller
 
     // Plugin -> Clients
-    SPMRQueue<ServerEventWrapper> mPluginProcessToClientsQueue;
+    SPMRQueue<ProcessEventRecord> mPluginProcessToClientsQueue;
     MPMRQueue<ServerEventWrapper> mPluginMainToClientsQueue;
 
-    // Clients -> Plugin (Blocking)
-    BlkRingQueue<Event> mBlockingClientEventQueue { 1 };
-    std::mutex mBlockingClientEventQueueMtx;
+    // Clients -> Main (Acknowledgements)
+    struct PendingClientEvent
+    {
+        std::uint64_t ticket = 0;
+        Event event = Event::EventInvalid;
+        ClientEventDone done;
+    };
+    static constexpr std::size_t MaxPendingClientEvents = 16;
+    std::deque<PendingClientEvent> mPendingClientEvents;
+    std::uint64_t mNextClientEventTicket = 1;
+    mutable std::mutex mClientEventsMtx;
+    std::condition_variable mClientEventsCv;
 
     // Clients -> Plugin
-    SPSC<ClientParamWrapper> mClientsToPluginQueue;
+    SPMRQueue<ClientParamWrapper> mClientsToPluginQueue;
+    std::mutex mClientsToPluginMtx; // Calls and streams push from any queue, one at a time
     Stamp mLastClientStamp;
+
+    // Plugin -> Clients, on request
+    std::shared_ptr<const ParamInfoSnapshot> mParamInfos;
+    mutable std::mutex mParamInfosMtx;
+    ParamStateTable mParamStates;
 };
 
 RCLAP_END_NAMESPACE
@@ -3,28 +3,51 @@
 #include "../cqeventhandler.h"
 #include "../serverctrl.h"
 
+#include <chrono>
+
 RCLAP_BEGIN_NAMESPACE
 
 ClientEventCallHandler::ClientEventCallHandler(CqEventHandler *parent, grpc::ServerCompletionQueue *cq)
-    : EventTag(parent), cq(cq), writer(&ctx), idHash(toHash(this))
+    : EventTag(parent), cq(cq), idHash(toHash(this))
 {
-    service->RequestClientEventCall(&ctx, &request, &writer, cq, cq, this);
+    rearm();
 }
 
 ClientEventCallHandler::~ClientEventCallHandler() = default;
 
+void ClientEventCallHandler::rearm()
+{
+    ctx.emplace();
+    writer.emplace(&*ctx);
+    state = PROCESS;
+    service->RequestClientEventCall(&*ctx, &request, &*writer, cq, cq, this);
+}
+
+void ClientEventCallHandler::reset()
+{
+    ++mGeneration;
+    sharedData.reset();
+    mTicket = 0;
+    mTimeoutId = TimerWheel::InvalidId;
+    writer.reset();
+    ctx.reset();
+    request.Clear();
+}
+
 void ClientEventCallHandler::process(bool ok)
 {
     if (!ok)
         return kill();
 
     if (state == PROCESS) {
-        // Spawn a new Handler to serve new clients while we process the
-        // one for this Handler.
+        // Arm another Handler, a pooled one if available, to serve new
+        // clients while we process the one for this Handler.
         parent->create<ClientEventCallHandler>();
 
-        state = FINISH;
-        writer.Finish(response, handleEvent(), this);
+        // Finished from the verification or the timeout of the event.
+        state = VERIFY;
+        if (const auto status = handleEvent(); !status.ok())
+            finish(status);
     } else {
         return kill();
     }
@@ -32,36 +55,60 @@ void ClientEventCallHandler::process(bool ok)
 
 void ClientEventCallHandler::kill()
 {
-    parent->destroyTag(hash());
-}
-
-GrpcMetadata ClientEventCallHandler::metadata() const noexcept { return ctx.client_metadata(); }
-
-// TODO: remove the one in servereventstream
-std::optional<std::string> ClientEventCallHandler::extractMetadata(const std::string_view &cmp) const noexcept
-{
-    for (const auto &[key, value] : std::as_const(metadata())) {
-        if (std::string(key.data(), key.size()) == cmp)
-            return std::string(value.data(), value.length());
-    }
-    return std::nullopt;
+    parent->recycle(this);
 }
 
 grpc::Status ClientEventCallHandler::handleEvent()
 {
-    auto id = extractMetadata(Metadata::PluginHashId);
-    if (!id)
-        return {grpc::StatusCode::INVALID_ARGUMENT, "No PluginHashId"};
+    const auto hash = ServerCtrl::instance().pluginHash(*ctx);
+    if (!hash)
+        return {grpc::StatusCode::INVALID_ARGUMENT, "No session or PluginHashId"};
 
-    auto sharedData = ServerCtrl::instance().getSharedData(std::stoull(*id));
+    sharedData = ServerCtrl::instance().getSharedData(*hash);
     if (!sharedData)
         return {grpc::StatusCode::NOT_FOUND, "Plugin not found"};
-    SPDLOG_TRACE("ClientEventCall: enqueue blocking event {}", static_cast<int>(request.event()));
-    bool ok = sharedData->blockingPushClientEvent(request.event());
-    if (!ok)
-        return {grpc::StatusCode::INTERNAL, "Failed to push event"};
+    SPDLOG_TRACE("ClientEventCall: enqueue event {}", static_cast<int>(request.event()));
+    // Called by the main thread, hop back to our queue.
+    const auto ticket = sharedData->pushClientEvent(request.event(), [this, handler = parent, generation = mGeneration](bool verified) {
+        handler->enqueueFn([this, generation, verified](bool) {
+            if (generation == mGeneration)
+                onVerified(verified);
+        });
+    });
+    if (!ticket)
+        return {grpc::StatusCode::RESOURCE_EXHAUSTED, "Too many pending events"};
 
+    mTicket = *ticket;
+    const auto timeout = std::chrono::duration_cast<std::chrono::nanoseconds>(ServerCtrl::instance().getInitTimeout());
+    mTimeoutId = parent->enqueueFn([this, generation = mGeneration](bool ok) {
+        if (generation == mGeneration)
+            onTimeout(ok);
+    }, static_cast<std::uint64_t>(timeout.count()));
     return grpc::Status::OK;
 }
 
+void ClientEventCallHandler::onVerified(bool verified)
+{
+    parent->cancelFn(mTimeoutId);
+    if (!verified)
+        return finish({grpc::StatusCode::FAILED_PRECONDITION, "Unexpected event"});
+    finish(grpc::Status::OK);
+}
+
+void ClientEventCallHandler::onTimeout(bool ok)
+{
+    // Lost the race against the main thread, onVerified() is on its way.
+    if (!sharedData->cancelClientEvent(mTicket))
+        return;
+    if (!ok) // The queue is shutting down.
+        return finish({grpc::StatusCode::CANCELLED, "Server shutting down"});
+    finish({grpc::StatusCode::DEADLINE_EXCEEDED, "No response from the plugin"});
+}
+
+void ClientEventCallHandler::finish(const grpc::Status &status)
+{
+    state = FINISH;
+    writer->Finish(response, status, this);
+}
+
 RCLAP_END_NAMESPACE
@@ -2,11 +2,17 @@
 #define CLIENTEVENTCALLHANDLER_H
 
 #include "eventtag.h"
+#include "../timerwheel.h"
 #include <core/global.h>
+#include <memory>
 #include <optional>
 
 RCLAP_BEGIN_NAMESPACE
 
+class SharedData;
+
+// Acknowledgements of the GUI handshake. The call is parked until the main thread
+// consumed the event in SharedData::blockingVerifyEvent(), without blocking the queue.
 class ClientEventCallHandler : public EventTag
 {
 public:
@@ -23,21 +29,34 @@ public:
     std::uint64_t hash() const noexcept override { return idHash; }
     void kill() override;
 
+    // Called by the HandlerPool. reset() releases the finished call, rearm() requests the next one.
+    void rearm();
+    void reset();
+
 private:
-    GrpcMetadata metadata() const noexcept;
-    std::optional<std::string> extractMetadata(const std::string_view &cmp) const noexcept;
     grpc::Status handleEvent();
+    void onVerified(bool verified);
+    void onTimeout(bool ok);
+    void finish(const grpc::Status &status);
 
 private:
-    [[maybe_unused]] grpc::ServerCompletionQueue *cq = nullptr;
-    grpc::ServerContext ctx;
+    grpc::ServerCompletionQueue *cq = nullptr;
+    // A ServerContext can't be reused, they are constructed in place for every call.
+    std::optional<grpc::ServerContext> ctx;
 
-    grpc::ServerAsyncResponseWriter<None> writer;
+    std::optional<grpc::ServerAsyncResponseWriter<None>> writer;
     ClientEvent request;
     None response;
 
+    // The pending acknowledgement and its timeout
+    std::shared_ptr<SharedData> sharedData;
+    std::uint64_t mTicket = 0;
+    TimerWheel::Id mTimeoutId = TimerWheel::InvalidId;
+    // Incremented on reset, so callbacks of a previous call are ignored.
+    std::uint64_t mGeneration = 0;
+
     std::uint64_t idHash = {};
-    enum State { PROCESS, FINISH };
+    enum State { PROCESS, VERIFY, FINISH };
     State state = PROCESS;
 };
 
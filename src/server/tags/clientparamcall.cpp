@@ -8,25 +8,40 @@
 RCLAP_BEGIN_NAMESPACE
 
 ClientParamCall::ClientParamCall(CqEventHandler *parent, grpc::ServerCompletionQueue *cq)
-    : EventTag(parent), cq(cq), writer(&ctx), idHash(toHash(this))
+    : EventTag(parent), cq(cq), idHash(toHash(this))
 {
-    service->RequestClientParamCall(&ctx, &request, &writer, cq, cq, this);
+    rearm();
 }
 
 ClientParamCall::~ClientParamCall() = default;
 
+void ClientParamCall::rearm()
+{
+    ctx.emplace();
+    writer.emplace(&*ctx);
+    state = PROCESS;
+    service->RequestClientParamCall(&*ctx, &request, &*writer, cq, cq, this);
+}
+
+void ClientParamCall::reset()
+{
+    writer.reset();
+    ctx.reset();
+    request.Clear();
+}
+
 void ClientParamCall::process(bool ok)
 {
     if (!ok)
         return kill();
 
     if (state == PROCESS) {
-        // Spawn a new Handler to serve new clients while we process the
-        // one for this Handler.
+        // Arm another Handler, a pooled one if available, to serve new
+        // clients while we process the one for this Handler.
         parent->create<ClientParamCall>();
 
         state = FINISH;
-        writer.Finish(response, handleEvent(), this);
+        writer->Finish(response, handleEvent(), this);
     } else {
         return kill();
     }
@@ -34,28 +49,16 @@ void ClientParamCall::process(bool ok)
 
 void ClientParamCall::kill()
 {
-    parent->destroyTag(hash());
-}
-
-GrpcMetadata ClientParamCall::metadata() const noexcept { return ctx.client_metadata(); }
-
-// TODO: remove in favor of servereventstream.
-std::optional<std::string> ClientParamCall::extractMetadata(const std::string_view &cmp) const noexcept
-{
-    for (const auto &[key, value] : std::as_const(metadata())) {
-        if (std::string(key.data(), key.size()) == cmp)
-            return std::string(value.data(), value.length());
-    }
-    return std::nullopt;
+    parent->recycle(this);
 }
 
 grpc::Status ClientParamCall::handleEvent()
 {
-    auto id = extractMetadata(Metadata::PluginHashId);
-    if (!id)
-        return {grpc::StatusCode::INVALID_ARGUMENT, "No PluginHashId"};
+    const auto hash = ServerCtrl::instance().pluginHash(*ctx);
+    if (!hash)
+        return {grpc::StatusCode::INVALID_ARGUMENT, "No session or PluginHashId"};
 
-    auto sharedData = ServerCtrl::instance().getSharedData(std::stoull(*id));
+    auto sharedData = ServerCtrl::instance().getSharedData(*hash);
     if (!sharedData)
         return {grpc::StatusCode::NOT_FOUND, "Plugin not found"};
 
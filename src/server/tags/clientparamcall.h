@@ -23,16 +23,19 @@ public:
     std::uint64_t hash() const noexcept override { return idHash; }
     void kill() override;
 
+    // Called by the HandlerPool. reset() releases the finished call, rearm() requests the next one.
+    void rearm();
+    void reset();
+
 private:
-    GrpcMetadata metadata() const noexcept;
-    std::optional<std::string> extractMetadata(const std::string_view &cmp) const noexcept;
     grpc::Status handleEvent();
 
 private:
-    [[maybe_unused]] grpc::ServerCompletionQueue *cq = nullptr;
-    grpc::ServerContext ctx;
+    grpc::ServerCompletionQueue *cq = nullptr;
+    // A ServerContext can't be reused, they are constructed in place for every call.
+    std::optional<grpc::ServerContext> ctx;
 
-    grpc::ServerAsyncResponseWriter<None> writer;
+    std::optional<grpc::ServerAsyncResponseWriter<None>> writer;
     ClientParams request;
     None response;
 
@@ -0,0 +1,135 @@
+#include <core/logging.h>
+#include "clientparamstream.h"
+#include "../cqeventhandler.h"
+#include "../serverctrl.h"
+
+#include <algorithm>
+
+RCLAP_BEGIN_NAMESPACE
+
+ClientParamStream::ClientParamStream(CqEventHandler *parent, grpc::ServerCompletionQueue *cq)
+    : EventTag(parent), cq(cq), mDoneTag(parent, [this](bool) { onDone(); }), idHash(toHash(this))
+{
+    rearm();
+}
+
+ClientParamStream::~ClientParamStream() = default;
+
+void ClientParamStream::rearm()
+{
+    ctx.emplace();
+    reader.emplace(&*ctx);
+    state = CONNECT;
+    // Delivered once the call was matched, the stream isn't recycled before.
+    mDonePending = true;
+    ctx->AsyncNotifyWhenDone(toTag(&mDoneTag));
+    service->RequestClientParamStream(&*ctx, &*reader, cq, cq, this);
+}
+
+void ClientParamStream::reset()
+{
+    ++mGeneration;
+    reader.reset();
+    ctx.reset();
+    request.Clear();
+    sharedData.reset();
+    mNextParam = 0;
+    mRetryNs = 0;
+    mKillPending = false;
+}
+
+void ClientParamStream::process(bool ok)
+{
+    switch (state) {
+
+        case CONNECT: {
+            if (!ok) {
+                mDonePending = false; // Never matched, there won't be a done notification.
+                return kill();
+            }
+            // Arm another handler to serve new clients while we're processing this one.
+            parent->create<ClientParamStream>();
+            if (!connectClient())
+                return finish({ grpc::StatusCode::UNAUTHENTICATED, "Couldn't authenticate client" });
+            state = READ;
+            reader->Read(&request, this);
+        } break;
+
+        case READ: {
+            if (!ok) // The client is done writing.
+                return finish(grpc::Status::OK);
+            mNextParam = 0;
+            pushBatch();
+        } break;
+
+        case FINISH: {
+            kill();
+        } break;
+
+    }
+}
+
+void ClientParamStream::kill()
+{
+    // The done tag belongs to us, wait for it before the next call can reuse it.
+    if (mDonePending) {
+        mKillPending = true;
+        return;
+    }
+    parent->recycle(this);
+}
+
+void ClientParamStream::onDone()
+{
+    mDonePending = false;
+    if (mKillPending)
+        return parent->recycle(this);
+    // A pending read or finish brings us back. A pending retry doesn't, the plugin may not
+    // drain its queue for a long time. Drop the retry and finish now.
+    if (state == READ && mRetryNs != 0) {
+        ++mGeneration;
+        finish({ grpc::StatusCode::CANCELLED, "Client Disconnected" });
+    }
+}
+
+bool ClientParamStream::connectClient()
+{
+    const auto hash = ServerCtrl::instance().pluginHash(*ctx);
+    if (!hash) {
+        SPDLOG_ERROR("ClientParamStream: No session or PluginHashId {}", toTag(this));
+        return false;
+    }
+    sharedData = ServerCtrl::instance().getSharedData(*hash);
+    return sharedData != nullptr;
+}
+
+// Queues the current batch and reads the next one. Backs off if the plugin can't keep up.
+void ClientParamStream::pushBatch()
+{
+    mNextParam = sharedData->tryPushClientParams(request, mNextParam);
+    if (mNextParam == request.params_size()) {
+        mRetryNs = 0;
+        reader->Read(&request, this);
+        return;
+    }
+    mRetryNs = std::clamp(mRetryNs * 2, MinRetryNs, MaxRetryNs);
+    parent->enqueueFn([this, generation = mGeneration](bool ok) {
+        if (generation == mGeneration)
+            retryPush(ok);
+    }, mRetryNs);
+}
+
+void ClientParamStream::retryPush(bool ok)
+{
+    if (!ok) // Cancelled, the queue is shutting down.
+        return finish({ grpc::StatusCode::CANCELLED, "Server shutting down" });
+    pushBatch();
+}
+
+void ClientParamStream::finish(const grpc::Status &status)
+{
+    state = FINISH;
+    reader->Finish(response, status, this);
+}
+
+RCLAP_END_NAMESPACE
@@ -0,0 +1,72 @@
+#ifndef CLIENTPARAMSTREAM_H
+#define CLIENTPARAMSTREAM_H
+
+#include "eventtag.h"
+#include <core/global.h>
+#include <optional>
+
+RCLAP_BEGIN_NAMESPACE
+
+class SharedData;
+
+// Long-lived client stream of parameter changes. The client is authenticated once
+// when the stream starts. Only a single read is in flight: the next batch is read
+// once the previous one was queued for the plugin. If the queue is full, the rest of
+// the batch is retried with a backoff instead of blocking the completion queue. The
+// retries stop once the client is gone.
+class ClientParamStream : public EventTag
+{
+public:
+    ClientParamStream(CqEventHandler *parent, grpc::ServerCompletionQueue *cq);
+    ~ClientParamStream() override;
+
+    ClientParamStream(ClientParamStream &&) = delete;
+    ClientParamStream &operator=(ClientParamStream &&) = delete;
+
+    ClientParamStream(const ClientParamStream &) = delete;
+    ClientParamStream &operator=(const ClientParamStream &) = delete;
+
+    void process(bool ok) override;
+    std::uint64_t hash() const noexcept override { return idHash; }
+    void kill() override;
+
+    // Called by the HandlerPool. reset() releases the finished call, rearm() requests the next one.
+    void rearm();
+    void reset();
+
+private:
+    bool connectClient();
+    void pushBatch();
+    void retryPush(bool ok);
+    void onDone();
+    void finish(const grpc::Status &status);
+
+private:
+    grpc::ServerCompletionQueue *cq = nullptr;
+    // A ServerContext can't be reused, they are constructed in place for every call.
+    std::optional<grpc::ServerContext> ctx;
+
+    std::optional<grpc::ServerAsyncReader<None, ClientParams>> reader;
+    ClientParams request;
+    None response;
+
+    std::shared_ptr<SharedData> sharedData;
+    int mNextParam = 0; // First param of the current batch that isn't queued yet
+    std::uint64_t mRetryNs = 0;
+    static constexpr std::uint64_t MinRetryNs = 50'000;
+    static constexpr std::uint64_t MaxRetryNs = 1'000'000;
+    // Incremented on reset and once the client is gone, so a pending retry is ignored.
+    std::uint64_t mGeneration = 0;
+    // Notified when the call is done, also if the client cancelled while we wait for a retry.
+    PersistentEventTag mDoneTag;
+    bool mDonePending = false;
+    bool mKillPending = false;
+
+    std::uint64_t idHash = {};
+    enum State { CONNECT, READ, FINISH };
+    State state = CONNECT;
+};
+
+RCLAP_END_NAMESPACE
+
+#endif // CLIENTPARAMSTREAM_H
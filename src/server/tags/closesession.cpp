@@ -0,0 +1,69 @@
+#include <core/logging.h>
+#include "closesession.h"
+#include "../cqeventhandler.h"
+#include "../serverctrl.h"
+
+
+RCLAP_BEGIN_NAMESPACE
+
+CloseSession::CloseSession(CqEventHandler *parent, grpc::ServerCompletionQueue *cq)
+    : EventTag(parent), cq(cq), idHash(toHash(this))
+{
+    rearm();
+}
+
+CloseSession::~CloseSession() = default;
+
+void CloseSession::rearm()
+{
+    ctx.emplace();
+    writer.emplace(&*ctx);
+    state = PROCESS;
+    service->RequestCloseSession(&*ctx, &request, &*writer, cq, cq, this);
+}
+
+void CloseSession::reset()
+{
+    writer.reset();
+    ctx.reset();
+    request.Clear();
+    response.Clear();
+}
+
+void CloseSession::process(bool ok)
+{
+    if (!ok)
+        return kill();
+
+    if (state == PROCESS) {
+        // Arm another Handler, a pooled one if available, to serve new
+        // clients while we process the one for this Handler.
+        parent->create<CloseSession>();
+
+        state = FINISH;
+        const auto status = handleRequest();
+        if (status.ok())
+            writer->Finish(response, status, this);
+        else
+            writer->FinishWithError(status, this);
+    } else {
+        return kill();
+    }
+}
+
+void CloseSession::kill()
+{
+    parent->recycle(this);
+}
+
+grpc::Status CloseSession::handleRequest()
+{
+    const auto id = ServerCtrl::sessionId(*ctx);
+    if (!id)
+        return { grpc::StatusCode::INVALID_ARGUMENT, "No session" };
+    if (!ServerCtrl::instance().sessions().close(*id))
+        return { grpc::StatusCode::NOT_FOUND, "Session not open" };
+    return grpc::Status::OK;
+}
+
+RCLAP_END_NAMESPACE
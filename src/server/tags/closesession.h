@@ -0,0 +1,50 @@
+#ifndef CLOSESESSION_H
+#define CLOSESESSION_H
+
+#include "eventtag.h"
+#include <core/global.h>
+#include <optional>
+
+RCLAP_BEGIN_NAMESPACE
+
+// Closes the session of the session-bin metadata.
+class CloseSession : public EventTag
+{
+public:
+    CloseSession(CqEventHandler *parent, grpc::ServerCompletionQueue *cq);
+    ~CloseSession() override;
+
+    CloseSession(CloseSession &&) = delete;
+    CloseSession &operator=(CloseSession &&) = delete;
+
+    CloseSession(const CloseSession &) = delete;
+    CloseSession &operator=(const CloseSession &) = delete;
+
+    void process(bool ok) override;
+    std::uint64_t hash() const noexcept override { return idHash; }
+    void kill() override;
+
+    // Called by the HandlerPool. reset() releases the finished call, rearm() requests the next one.
+    void rearm();
+    void reset();
+
+private:
+    grpc::Status handleRequest();
+
+private:
+    grpc::ServerCompletionQueue *cq = nullptr;
+    // A ServerContext can't be reused, they are constructed in place for every call.
+    std::optional<grpc::ServerContext> ctx;
+
+    std::optional<grpc::ServerAsyncResponseWriter<None>> writer;
+    None request;
+    None response;
+
+    std::uint64_t idHash = {};
+    enum State { PROCESS, FINISH };
+    State state = PROCESS;
+};
+
+RCLAP_END_NAMESPACE
+
+#endif // CLOSESESSION_H
@@ -36,9 +36,10 @@ void EventTag::process(bool ok)
     kill();
 }
 
+// Plain tags are single-shot and own themselves.
 void EventTag::kill()
 {
-    parent->destroyAlarmTag(this);
+    delete this;
 }
 
 void EventTag::setFn(FnType &&fn) noexcept
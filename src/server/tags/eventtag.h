@@ -5,6 +5,7 @@
 #include <api.grpc.pb.h>
 using namespace api::v0;
 
+#include "../service.h"
 #include <core/global.h>
 #include <core/timestamp.h>
 
@@ -42,12 +43,23 @@ public:
 
 protected:
     CqEventHandler *parent = nullptr;
-    ClapInterface::AsyncService *service = nullptr;
+    AsyncService *service = nullptr;
 
     std::unique_ptr<FnType> func{};
     Timestamp ts{};
 };
 
+// A reusable tag that survives being processed. The owner is responsible for
+// its lifetime. Used to re-arm the same alarm over and over, e.g. for wakeups.
+class PersistentEventTag : public EventTag
+{
+public:
+    using EventTag::EventTag;
+
+    void process(bool ok) override { (*func)(ok); }
+    void kill() override {}
+};
+
 RCLAP_END_NAMESPACE
 
 #endif // EVENTTAG_H
@@ -0,0 +1,83 @@
+#include <core/logging.h>
+#include "getparaminfos.h"
+#include "../cqeventhandler.h"
+#include "../serverctrl.h"
+#include "../shareddata.h"
+
+RCLAP_BEGIN_NAMESPACE
+
+GetParamInfos::GetParamInfos(CqEventHandler *parent, grpc::ServerCompletionQueue *cq)
+    : EventTag(parent), cq(cq), idHash(toHash(this))
+{
+    rearm();
+}
+
+GetParamInfos::~GetParamInfos() = default;
+
+void GetParamInfos::rearm()
+{
+    ctx.emplace();
+    writer.emplace(&*ctx);
+    state = PROCESS;
+    service->RequestGetParamInfos(&*ctx, &rawRequest, &*writer, cq, cq, this);
+}
+
+void GetParamInfos::reset()
+{
+    writer.reset();
+    ctx.reset();
+    rawRequest.Clear();
+    response.Clear();
+    mSnapshot.reset();
+}
+
+void GetParamInfos::process(bool ok)
+{
+    if (!ok)
+        return kill();
+
+    if (state == PROCESS) {
+        // Arm another Handler, a pooled one if available, to serve new
+        // clients while we process the one for this Handler.
+        parent->create<GetParamInfos>();
+
+        state = FINISH;
+        const auto status = handleRequest();
+        if (status.ok())
+            writer->Finish(response, status, this);
+        else
+            writer->FinishWithError(status, this);
+    } else {
+        return kill();
+    }
+}
+
+void GetParamInfos::kill()
+{
+    parent->recycle(this);
+}
+
+grpc::Status GetParamInfos::handleRequest()
+{
+    ParamInfoRequest request;
+    if (!grpc::SerializationTraits<ParamInfoRequest>::Deserialize(&rawRequest, &request).ok())
+        return { grpc::StatusCode::INVALID_ARGUMENT, "Malformed ParamInfoRequest" };
+
+    const auto hash = ServerCtrl::instance().pluginHash(*ctx);
+    if (!hash)
+        return { grpc::StatusCode::INVALID_ARGUMENT, "No session or PluginHashId" };
+
+    const auto sharedData = ServerCtrl::instance().getSharedData(*hash);
+    if (!sharedData)
+        return { grpc::StatusCode::NOT_FOUND, "Plugin not found" };
+    mSnapshot = sharedData->paramInfos();
+    if (!mSnapshot)
+        return { grpc::StatusCode::UNAVAILABLE, "No param infos yet" };
+    if (request.offset() > mSnapshot->size())
+        return { grpc::StatusCode::OUT_OF_RANGE, "Offset beyond the last param" };
+
+    response = mSnapshot->page(request.offset(), request.page_size());
+    return grpc::Status::OK;
+}
+
+RCLAP_END_NAMESPACE
@@ -0,0 +1,56 @@
+#ifndef GETPARAMINFOS_H
+#define GETPARAMINFOS_H
+
+#include "eventtag.h"
+#include "../paraminfosnapshot.h"
+#include <core/global.h>
+#include <grpcpp/support/byte_buffer.h>
+#include <memory>
+#include <optional>
+
+RCLAP_BEGIN_NAMESPACE
+
+// Serves a page of the ParamInfoSnapshot of a plugin instance. A raw method, the page
+// is written as it was serialized when the params were added.
+class GetParamInfos : public EventTag
+{
+public:
+    GetParamInfos(CqEventHandler *parent, grpc::ServerCompletionQueue *cq);
+    ~GetParamInfos() override;
+
+    GetParamInfos(GetParamInfos &&) = delete;
+    GetParamInfos &operator=(GetParamInfos &&) = delete;
+
+    GetParamInfos(const GetParamInfos &) = delete;
+    GetParamInfos &operator=(const GetParamInfos &) = delete;
+
+    void process(bool ok) override;
+    std::uint64_t hash() const noexcept override { return idHash; }
+    void kill() override;
+
+    // Called by the HandlerPool. reset() releases the finished call, rearm() requests the next one.
+    void rearm();
+    void reset();
+
+private:
+    grpc::Status handleRequest();
+
+private:
+    grpc::ServerCompletionQueue *cq = nullptr;
+    // A ServerContext can't be reused, they are constructed in place for every call.
+    std::optional<grpc::ServerContext> ctx;
+
+    std::optional<grpc::ServerAsyncResponseWriter<grpc::ByteBuffer>> writer;
+    grpc::ByteBuffer rawRequest;
+    grpc::ByteBuffer response;
+    // The response references it until the call finished.
+    std::shared_ptr<const ParamInfoSnapshot> mSnapshot;
+
+    std::uint64_t idHash = {};
+    enum State { PROCESS, FINISH };
+    State state = PROCESS;
+};
+
+RCLAP_END_NAMESPACE
+
+#endif // GETPARAMINFOS_H
@@ -0,0 +1,51 @@
+#ifndef GETPARAMSTATES_H
+#define GETPARAMSTATES_H
+
+#include "eventtag.h"
+#include <core/global.h>
+#include <optional>
+
+RCLAP_BEGIN_NAMESPACE
+
+// Serves the current param states of a plugin instance from its ParamStateTable.
+// The audio thread is never involved.
+class GetParamStates : public EventTag
+{
+public:
+    GetParamStates(CqEventHandler *parent, grpc::ServerCompletionQueue *cq);
+    ~GetParamStates() override;
+
+    GetParamStates(GetParamStates &&) = delete;
+    GetParamStates &operator=(GetParamStates &&) = delete;
+
+    GetParamStates(const GetParamStates &) = delete;
+    GetParamStates &operator=(const GetParamStates &) = delete;
+
+    void process(bool ok) override;
+    std::uint64_t hash() const noexcept override { return idHash; }
+    void kill() override;
+
+    // Called by the HandlerPool. reset() releases the finished call, rearm() requests the next one.
+    void rearm();
+    void reset();
+
+private:
+    grpc::Status handleRequest();
+
+private:
+    grpc::ServerCompletionQueue *cq = nullptr;
+    // A ServerContext can't be reused, they are constructed in place for every call.
+    std::optional<grpc::ServerContext> ctx;
+
+    std::optional<grpc::ServerAsyncResponseWriter<ParamStates>> writer;
+    ParamStatesRequest request;
+    ParamStates response;
+
+    std::uint64_t idHash = {};
+    enum State { PROCESS, FINISH };
+    State state = PROCESS;
+};
+
+RCLAP_END_NAMESPACE
+
+#endif // GETPARAMSTATES_H
@@ -0,0 +1,72 @@
+#include <core/logging.h>
+#include "getqueuestats.h"
+#include "../cqeventhandler.h"
+#include "../serverctrl.h"
+#include "../shareddata.h"
+
+RCLAP_BEGIN_NAMESPACE
+
+GetQueueStats::GetQueueStats(CqEventHandler *parent, grpc::ServerCompletionQueue *cq)
+    : EventTag(parent), cq(cq), idHash(toHash(this))
+{
+    rearm();
+}
+
+GetQueueStats::~GetQueueStats() = default;
+
+void GetQueueStats::rearm()
+{
+    ctx.emplace();
+    writer.emplace(&*ctx);
+    state = PROCESS;
+    service->RequestGetQueueStats(&*ctx, &request, &*writer, cq, cq, this);
+}
+
+void GetQueueStats::reset()
+{
+    writer.reset();
+    ctx.reset();
+    request.Clear();
+    response.Clear();
+}
+
+void GetQueueStats::process(bool ok)
+{
+    if (!ok)
+        return kill();
+
+    if (state == PROCESS) {
+        // Arm another Handler, a pooled one if available, to serve new
+        // clients while we process the one for this Handler.
+        parent->create<GetQueueStats>();
+
+        state = FINISH;
+        const auto status = handleRequest();
+        if (status.ok())
+            writer->Finish(response, status, this);
+        else
+            writer->FinishWithError(status, this);
+    } else {
+        return kill();
+    }
+}
+
+void GetQueueStats::kill()
+{
+    parent->recycle(this);
+}
+
+grpc::Status GetQueueStats::handleRequest()
+{
+    const auto hash = ServerCtrl::instance().pluginHash(*ctx);
+    if (!hash)
+        return { grpc::StatusCode::INVALID_ARGUMENT, "No session or PluginHashId" };
+
+    const auto sharedData = ServerCtrl::instance().getSharedData(*hash);
+    if (!sharedData)
+        return { grpc::StatusCode::NOT_FOUND, "Plugin not found" };
+    sharedData->queueStats(response);
+    return grpc::Status::OK;
+}
+
+RCLAP_END_NAMESPACE
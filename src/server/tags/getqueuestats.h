@@ -0,0 +1,50 @@
+#ifndef GETQUEUESTATS_H
+#define GETQUEUESTATS_H
+
+#include "eventtag.h"
+#include <core/global.h>
+#include <optional>
+
+RCLAP_BEGIN_NAMESPACE
+
+// Serves the counters of the event queues of a plugin instance.
+class GetQueueStats : public EventTag
+{
+public:
+    GetQueueStats(CqEventHandler *parent, grpc::ServerCompletionQueue *cq);
+    ~GetQueueStats() override;
+
+    GetQueueStats(GetQueueStats &&) = delete;
+    GetQueueStats &operator=(GetQueueStats &&) = delete;
+
+    GetQueueStats(const GetQueueStats &) = delete;
+    GetQueueStats &operator=(const GetQueueStats &) = delete;
+
+    void process(bool ok) override;
+    std::uint64_t hash() const noexcept override { return idHash; }
+    void kill() override;
+
+    // Called by the HandlerPool. reset() releases the finished call, rearm() requests the next one.
+    void rearm();
+    void reset();
+
+private:
+    grpc::Status handleRequest();
+
+private:
+    grpc::ServerCompletionQueue *cq = nullptr;
+    // A ServerContext can't be reused, they are constructed in place for every call.
+    std::optional<grpc::ServerContext> ctx;
+
+    std::optional<grpc::ServerAsyncResponseWriter<QueueStats>> writer;
+    None request;
+    QueueStats response;
+
+    std::uint64_t idHash = {};
+    enum State { PROCESS, FINISH };
+    State state = PROCESS;
+};
+
+RCLAP_END_NAMESPACE
+
+#endif // GETQUEUESTATS_H
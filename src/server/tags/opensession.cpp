@@ -0,0 +1,77 @@
+#include <core/logging.h>
+#include "opensession.h"
+#include "../cqeventhandler.h"
+#include "../serverctrl.h"
+
+RCLAP_BEGIN_NAMESPACE
+
+OpenSession::OpenSession(CqEventHandler *parent, grpc::ServerCompletionQueue *cq)
+    : EventTag(parent), cq(cq), idHash(toHash(this))
+{
+    rearm();
+}
+
+OpenSession::~OpenSession() = default;
+
+void OpenSession::rearm()
+{
+    ctx.emplace();
+    writer.emplace(&*ctx);
+    state = PROCESS;
+    service->RequestOpenSession(&*ctx, &request, &*writer, cq, cq, this);
+}
+
+void OpenSession::reset()
+{
+    writer.reset();
+    ctx.reset();
+    request.Clear();
+    response.Clear();
+}
+
+void OpenSession::process(bool ok)
+{
+    if (!ok)
+        return kill();
+
+    if (state == PROCESS) {
+        // Arm another Handler, a pooled one if available, to serve new
+        // clients while we process the one for this Handler.
+        parent->create<OpenSession>();
+
+        state = FINISH;
+        const auto status = handleRequest();
+        if (status.ok())
+            writer->Finish(response, status, this);
+        else
+            writer->FinishWithError(status, this);
+    } else {
+        return kill();
+    }
+}
+
+void OpenSession::kill()
+{
+    parent->recycle(this);
+}
+
+grpc::Status OpenSession::handleRequest()
+{
+    const auto &metadata = ctx->client_metadata();
+    if (metadata.find(grpc::string_ref(Metadata::PluginHashId.data(), Metadata::PluginHashId.size())) == metadata.end())
+        return { grpc::StatusCode::INVALID_ARGUMENT, "No PluginHashId" };
+    const auto hash = ServerCtrl::instance().pluginHash(*ctx);
+    if (!hash)
+        return { grpc::StatusCode::INVALID_ARGUMENT, "Malformed PluginHashId" };
+    if (!ServerCtrl::instance().getSharedData(*hash))
+        return { grpc::StatusCode::NOT_FOUND, "Plugin not found" };
+
+    const auto id = ServerCtrl::instance().sessions().open(*hash);
+    if (!id)
+        return { grpc::StatusCode::RESOURCE_EXHAUSTED, "Too many sessions" };
+    response.mutable_id()->assign(reinterpret_cast<const char *>(&*id), sizeof(*id));
+    SPDLOG_DEBUG("OpenSession: {} for plugin {}", *id, *hash);
+    return grpc::Status::OK;
+}
+
+RCLAP_END_NAMESPACE
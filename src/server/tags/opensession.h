@@ -0,0 +1,51 @@
+#ifndef OPENSESSION_H
+#define OPENSESSION_H
+
+#include "eventtag.h"
+#include <core/global.h>
+#include <optional>
+
+RCLAP_BEGIN_NAMESPACE
+
+// Opens a session for the plugin instance of the PluginHashId metadata. Later calls
+// identify the instance with the returned id, see ServerCtrl::pluginHash().
+class OpenSession : public EventTag
+{
+public:
+    OpenSession(CqEventHandler *parent, grpc::ServerCompletionQueue *cq);
+    ~OpenSession() override;
+
+    OpenSession(OpenSession &&) = delete;
+    OpenSession &operator=(OpenSession &&) = delete;
+
+    OpenSession(const OpenSession &) = delete;
+    OpenSession &operator=(const OpenSession &) = delete;
+
+    void process(bool ok) override;
+    std::uint64_t hash() const noexcept override { return idHash; }
+    void kill() override;
+
+    // Called by the HandlerPool. reset() releases the finished call, rearm() requests the next one.
+    void rearm();
+    void reset();
+
+private:
+    grpc::Status handleRequest();
+
+private:
+    grpc::ServerCompletionQueue *cq = nullptr;
+    // A ServerContext can't be reused, they are constructed in place for every call.
+    std::optional<grpc::ServerContext> ctx;
+
+    std::optional<grpc::ServerAsyncResponseWriter<Session>> writer;
+    None request;
+    Session response;
+
+    std::uint64_t idHash = {};
+    enum State { PROCESS, FINISH };
+    State state = PROCESS;
+};
+
+RCLAP_END_NAMESPACE
+
+#endif // OPENSESSION_H
@@ -8,33 +8,99 @@
 RCLAP_BEGIN_NAMESPACE
 
 ServerEventStream::ServerEventStream(CqEventHandler *parent, grpc::ServerCompletionQueue *cq)
-    : EventTag(parent), cq(cq), stream(&ctx), idHash(toHash(this))
+    : EventTag(parent), cq(cq), mDoneTag(parent, [this](bool) { onDone(); }), idHash(toHash(this))
 {
-    SPDLOG_TRACE("ServerEventStream created {}", toTag(this));
-    ctx.AsyncNotifyWhenDone(toTag(new EventTag(parent, [&](bool ok) {
-        SPDLOG_INFO("Disconnecting ServerEventStream {}", toTag(this));
-        state = FINISH;
-        // kill();
-    })));
-    service->RequestServerEventStream(&ctx, &request, &stream, cq, cq, this);
+    rearm();
 }
 
 ServerEventStream::~ServerEventStream() = default;
 
+void ServerEventStream::rearm()
+{
+    SPDLOG_TRACE("ServerEventStream armed {}", toTag(this));
+    ctx.emplace();
+    stream.emplace(&*ctx);
+    state = CONNECT;
+    // Delivered once the call was matched, the stream isn't recycled before.
+    mDonePending = true;
+    ctx->AsyncNotifyWhenDone(toTag(&mDoneTag));
+    service->RequestServerEventStream(&*ctx, &rawRequest, &*stream, cq, cq, this);
+}
+
+void ServerEventStream::reset()
+{
+    std::scoped_lock lock(mOutboundMtx);
+    stream.reset();
+    ctx.reset();
+    rawRequest.Clear();
+    request.Clear();
+    mFilter = {};
+    mConflator = {};
+    clearStaged();
+    response.Clear();
+    sharedData.reset();
+    sharedHash = 0;
+    mSessionId = 0;
+    mOutbound.clear();
+    mDroppedBatches = 0;
+    mWriteInFlight = false;
+    mEndPending = false;
+    mRefused = false;
+    mKillPending = false;
+}
+
+// Batches refused while the stream ended are only in the history. The client is told to
+// reconnect and resume after the last seq it received. Must be called with mOutboundMtx held.
+grpc::Status ServerEventStream::endStatus() const
+{
+    if (mRefused)
+        return { grpc::StatusCode::UNAVAILABLE, "Events were not sent, resume after the last seq" };
+    return { grpc::StatusCode::OK, "Client Disconnected" };
+}
+
+void ServerEventStream::onDone()
+{
+    mDonePending = false;
+    if (mKillPending)
+        return parent->recycle(this);
+
+    SPDLOG_INFO("Disconnecting ServerEventStream {}", toTag(this));
+    std::scoped_lock lock(mOutboundMtx);
+    if (state == WRITE && !mWriteInFlight) {
+        // Nothing in flight would bring us back, finish now.
+        state = FINISH;
+        stream->Finish({ grpc::StatusCode::CANCELLED, "Client Disconnected" }, toTag(this));
+    } else if (state != CONNECT) {
+        state = FINISH;
+    }
+}
+
 void ServerEventStream::process(bool ok)
 {
     switch (state) {
 
         case CONNECT: {
-            if (!ok)
+            if (!ok) {
+                mDonePending = false; // Never matched, there won't be a done notification.
                 return kill();
+            }
             // Create a new instance to serve new clients while we're processing this one.
             parent->create<ServerEventStream>();
+            if (!grpc::SerializationTraits<ClientRequest>::Deserialize(&rawRequest, &request).ok()
+                || !ClientRequest_Encoding_IsValid(request.encoding())) {
+                state = FINISH;
+                stream->Finish({ grpc::StatusCode::INVALID_ARGUMENT, "Malformed ClientRequest" }, toTag(this));
+                return;
+            }
+            mFilter = EventFilter(request.subscription());
+            mConflator = ParamConflator(request.max_param_rate_hz());
+            // Writable before the stream is added, the param states are queued while it is.
+            state = WRITE;
             // Try to connect the client. The client must provide a valid hash-id of a plugin instance
             // in the metadata to successfully connect.
             if (!connectClient()) {
                 state = FINISH;
-                stream.Finish({ grpc::StatusCode::UNAUTHENTICATED, "Couldn't authenticate client" }, toTag(this));
+                stream->Finish({ grpc::StatusCode::UNAUTHENTICATED, "Couldn't authenticate client" }, toTag(this));
                 SPDLOG_ERROR("ServerEventStream failed to connect to client", toTag(this));
                 return;
             }
@@ -43,23 +109,31 @@ void ServerEventStream::process(bool ok)
             if (!sharedData->tryStartPolling()) {
                 SPDLOG_DEBUG("ServerEventStream couldn't start polling: {}", toTag(this));
             }
-            state = WRITE;
             SPDLOG_INFO("ServerEventStream new client @ {} connected", toTag(this));
         } break;
 
         case WRITE: {
+            std::scoped_lock lock(mOutboundMtx);
+            mWriteInFlight = false;
             if (!ok) {
                 SPDLOG_DEBUG("ServerEventStream: Write finished");
-                stream.Finish({ grpc::StatusCode::OK, "Client Write Finished" }, toTag(this));
-                state = DISCONNECT;
+                mOutbound.clear();
+                state = FINISH;
+                stream->Finish({ grpc::StatusCode::OK, "Client Write Finished" }, toTag(this));
                 return;
             }
+            // The previous write completed. Send everything that queued up meanwhile.
+            if (!writeNext() && mEndPending) {
+                state = FINISH;
+                stream->Finish(endStatus(), toTag(this));
+            }
         } break;
 
         case DISCONNECT: {
             SPDLOG_TRACE("ServerEventStream DISCONNECT {}", toTag(this));
-            stream.Finish({ grpc::StatusCode::OK, "Client Disconnected" }, toTag(this));
+            std::scoped_lock lock(mOutboundMtx);
             state = FINISH;
+            stream->Finish(endStatus(), toTag(this));
         } break;
 
         case FINISH: {
@@ -70,53 +144,171 @@ void ServerEventStream::process(bool ok)
     }
 }
 
-// TODO: is this safe? Or should we rather use a queue? and poll these events
 bool ServerEventStream::sendEventNow(const ServerEvent &ev)
 {
-    if (state != WRITE)
+    ServerEvents evs;
+    evs.add_events()->CopyFrom(ev);
+    grpc::ByteBuffer bytes;
+    bool ownBuffer = false;
+    if (!grpc::SerializationTraits<ServerEvents>::Serialize(evs, &bytes, &ownBuffer).ok())
         return false;
+    return sendEvents(bytes);
+}
 
-    response.Clear();
-    response.add_events()->CopyFrom(ev);
-    stream.Write(response, toTag(this));
+bool ServerEventStream::sendEvents(const grpc::ByteBuffer &evs)
+{
+    std::scoped_lock lock(mOutboundMtx);
+    if (state.load() != WRITE || mEndPending) {
+        SPDLOG_TRACE("sendEvent() {}, not in write state", toTag(this));
+        mRefused = true;
+        return false;
+    }
+
+    // A slow client must not hold back the others, nor miss batches without noticing.
+    // The stream ends once the write in flight completes, the client resumes after the
+    // last seq it received.
+    if (mOutbound.size() >= MaxQueuedBatches) {
+        assert(mWriteInFlight); // Batches only queue up behind a write
+        SPDLOG_WARN("ServerEventStream {} can't keep up, ending it", toTag(this));
+        mDroppedBatches += mOutbound.size() + 1;
+        mOutbound.clear();
+        mEndPending = true;
+        mRefused = true;
+        return false;
+    }
+    mOutbound.push_back(evs);
+
+    if (!mWriteInFlight)
+        writeNext();
     return true;
 }
 
-bool ServerEventStream::sendEvents(const ServerEvents &evs)
+// Merges all queued batches into a single write. Returns false if there was nothing to write.
+// Must be called with mOutboundMtx held.
+// Concatenated ServerEvents messages parse as a single merged message, so merging is just
+// a matter of chaining the slices of the queued buffers.
+bool ServerEventStream::writeNext()
 {
-    if (state.load() != WRITE) {
-        SPDLOG_TRACE("sendEvent() {}, not in write state", toTag(this));
+    if (mOutbound.empty())
         return false;
+
+    if (mOutbound.size() == 1) {
+        response.Swap(&mOutbound.front());
+    } else {
+        mSlices.clear();
+        std::vector<grpc::Slice> slices;
+        for (const auto &batch : mOutbound) {
+            if (!batch.Dump(&slices).ok())
+                continue;
+            mSlices.insert(mSlices.end(), slices.begin(), slices.end());
+        }
+        response = grpc::ByteBuffer(mSlices.data(), mSlices.size());
     }
-    stream.Write(evs, toTag(this));
+    mOutbound.clear();
+
+    mWriteInFlight = true;
+    stream->Write(response, toTag(this));
     return true;
 }
 
 bool ServerEventStream::endStream()
 {
+    std::scoped_lock lock(mOutboundMtx);
     if (state != WRITE)
         return false;
+    if (mWriteInFlight) { // Flush the queue first, the write completion finishes the stream.
+        mEndPending = true;
+        return true;
+    }
     state = DISCONNECT;
     alarmSignal.Set(cq, gpr_now(gpr_clock_type::GPR_CLOCK_REALTIME) , toTag(this));
     return true;
 }
 
+bool ServerEventStream::stage(const ServerEventWrapper &ev)
+{
+    if (!mFilter.accepts(ev))
+        return false;
+    if (mConflator.enabled()) {
+        if (mConflator.update(ev))
+            return false;
+        // A gesture edge. The values that changed before it must not arrive after it.
+        if (const auto *pm = std::get_if<ClapEventParamWrapper>(&ev.data))
+            mConflator.flushParam(pm->paramId, [this](const auto &pending) { addStaged(pending); });
+    }
+    addStaged(ev);
+    return true;
+}
+
+bool ServerEventStream::flushConflated(std::uint64_t nowNs)
+{
+    return mConflator.flushDue(nowNs, [this](const auto &pending) { addStaged(pending); });
+}
+
+void ServerEventStream::addStaged(const ServerEventWrapper &ev)
+{
+    if (encoding() == ClientRequest_Encoding_Packed)
+        mStagedPacked.add(ev);
+    else
+        mStagedEvents.add(ev);
+}
+
+const grpc::ByteBuffer *ServerEventStream::finishStaged(std::uint64_t seq)
+{
+    if (encoding() == ClientRequest_Encoding_Packed) {
+        if (mStagedPacked.empty())
+            return nullptr;
+        mStagedPacked.setSeq(seq);
+        mStagedData = mStagedPacked.toByteBuffer();
+    } else {
+        if (mStagedEvents.empty())
+            return nullptr;
+        mStagedEvents.setSeq(seq);
+        mStagedData = mStagedEvents.toByteBuffer();
+    }
+    return &mStagedData;
+}
+
+void ServerEventStream::clearStaged() noexcept
+{
+    mStagedEvents.clear();
+    mStagedPacked.clear();
+}
+
 void ServerEventStream::kill()
 {
     if (sharedData)
         sharedData->removeStream(this);
-    parent->destroyTag(hash());
+    if (mSessionId != 0) {
+        ServerCtrl::instance().sessions().unbindStream(mSessionId);
+        mSessionId = 0;
+    }
+    // The done tag belongs to us, wait for it before the next call can reuse it.
+    if (mDonePending) {
+        mKillPending = true;
+        return;
+    }
+    parent->recycle(this);
 }
 
 bool ServerEventStream::connectClient()
 {
-    auto id = extractMetadata(Metadata::PluginHashId);
-    if (!id) {
-        SPDLOG_ERROR("ServerEventStream: No PluginHashId {}", toTag(this));
+    const auto hash = ServerCtrl::instance().pluginHash(*ctx);
+    if (!hash) {
+        SPDLOG_ERROR("ServerEventStream: No session or PluginHashId {}", toTag(this));
         return false;
     }
 
-    sharedHash = std::stoull(*id);
+    // The session ends with the last stream of its client.
+    if (const auto session = ServerCtrl::sessionId(*ctx)) {
+        if (!ServerCtrl::instance().sessions().bindStream(*session)) {
+            SPDLOG_ERROR("ServerEventStream: Session closed {}", toTag(this));
+            return false;
+        }
+        mSessionId = *session;
+    }
+
+    sharedHash = *hash;
     if(!ServerCtrl::instance().connectClient(this, sharedHash)) {
         return false;
     }
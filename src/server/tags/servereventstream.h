@@ -2,9 +2,16 @@
 #define SERVEREVENTSTREAM_H
 
 #include "eventtag.h"
+#include "../eventencoder.h"
+#include "../eventfilter.h"
+#include "../paramconflator.h"
 #include <core/global.h>
 #include <grpcpp/alarm.h>
+#include <grpcpp/support/byte_buffer.h>
+#include <deque>
+#include <mutex>
 #include <optional>
+#include <vector>
 
 RCLAP_BEGIN_NAMESPACE
 
@@ -26,37 +33,97 @@ public:
     std::uint64_t hash() const noexcept override { return idHash; }
     void kill() override;
 
+    // Called by the HandlerPool. reset() releases the finished call, rearm() requests the next one.
+    void rearm();
+    void reset();
+
     bool sendEventNow(const ServerEvent &ev);
-    bool sendEvents(const ServerEvents &evs);
+    // Queues an encoded ServerEvents batch for this client. The buffer is shared, not
+    // copied. Only a single write is in flight at any time, batches that queue up in
+    // the meantime are concatenated into the next write. A client that falls
+    // MaxQueuedBatches behind is ended with UNAVAILABLE, to resume from the history.
+    bool sendEvents(const grpc::ByteBuffer &evs);
     bool endStream();
 
-private:
-    bool connectClient();
-    GrpcMetadata metadata() const noexcept { return ctx.client_metadata(); }
-    std::optional<std::string> extractMetadata(const std::string_view &cmp) const noexcept
+    // Streams with a Subscription or a max_param_rate_hz get a batch of their own, encoded
+    // from the events that pass their filter. Only used by the poll loop, with the streams
+    // of SharedData locked.
+    [[nodiscard]] bool hasOwnBatch() const noexcept { return !mFilter.acceptsAll() || mConflator.enabled(); }
+    // Returns true if \a ev was staged. Conflated params are staged by flushConflated().
+    bool stage(const ServerEventWrapper &ev);
+    // Stages the conflated params if their interval passed. Returns true if any were staged.
+    bool flushConflated(std::uint64_t nowNs);
+    // When the pending conflated params are due, if there are any.
+    [[nodiscard]] std::optional<std::uint64_t> conflatedDueNs() const noexcept
+    {
+        return mConflator.hasPending() ? std::optional(mConflator.dueNs()) : std::nullopt;
+    }
+    // Encodes the staged events with the \a seq of the round. Returns nullptr if none
+    // passed the filter.
+    const grpc::ByteBuffer *finishStaged(std::uint64_t seq);
+    void clearStaged() noexcept;
+
+    [[nodiscard]] ClientRequest::Encoding encoding() const noexcept { return request.encoding(); }
+    [[nodiscard]] bool wantsSharedMemory() const noexcept { return request.shared_memory(); }
+    [[nodiscard]] std::uint64_t resumeAfterSeq() const noexcept { return request.resume_after_seq(); }
+    [[nodiscard]] std::size_t queuedBatches() const noexcept
+    {
+        std::scoped_lock lock(mOutboundMtx);
+        return mOutbound.size();
+    }
+    [[nodiscard]] std::uint64_t droppedBatches() const noexcept
     {
-        for (const auto &[key, value] : std::as_const(metadata())) {
-            if (std::string(key.data(), key.size()) == cmp)
-                return std::string(value.data(), value.length());
-        }
-        return std::nullopt;
+        std::scoped_lock lock(mOutboundMtx);
+        return mDroppedBatches;
     }
 
+private:
+    bool writeNext();
+    void addStaged(const ServerEventWrapper &ev);
+    bool connectClient();
+    void onDone();
+    grpc::Status endStatus() const;
+
 private:
     grpc::ServerCompletionQueue *cq = nullptr;
-    grpc::ServerContext ctx;
+    // A ServerContext can't be reused, they are constructed in place for every call.
+    std::optional<grpc::ServerContext> ctx;
 
-    grpc::ServerAsyncWriter<ServerEvents> stream;
-    ServerEvents response;
+    std::optional<grpc::ServerAsyncWriter<grpc::ByteBuffer>> stream;
+    grpc::ByteBuffer response;
+    grpc::ByteBuffer rawRequest;
     ClientRequest request;
 
+    EventFilter mFilter;
+    ParamConflator mConflator;
+    EventEncoder mStagedEvents { 1024 };
+    PackedEventEncoder mStagedPacked { 64 };
+    grpc::ByteBuffer mStagedData;
+
     std::uint64_t sharedHash = {};
+    std::uint64_t mSessionId = 0; // The session the stream is bound to, if any
     std::shared_ptr<SharedData> sharedData;
     grpc::Alarm alarmSignal;
 
+    // Outbound queue. Filled by the poll loop of the plugin instance, which may run on
+    // another completion queue than the one of this stream.
+    static constexpr std::size_t MaxQueuedBatches = 64;
+    mutable std::mutex mOutboundMtx;
+    std::deque<grpc::ByteBuffer> mOutbound;
+    std::vector<grpc::Slice> mSlices;
+    std::uint64_t mDroppedBatches = 0; // Not sent because the client fell behind
+    bool mWriteInFlight = false;
+    bool mEndPending = false;
+    bool mRefused = false; // A batch came in after the end
+
     enum State { CONNECT, WRITE, DISCONNECT, FINISH };
     std::atomic<State> state = CONNECT;
     static_assert(std::atomic<State>::is_always_lock_free);
+    // Notified when the call is done, reused by every call of this handler. Only touched
+    // by the thread of the completion queue, like the flags.
+    PersistentEventTag mDoneTag;
+    bool mDonePending = false;
+    bool mKillPending = false;
 
     std::uint64_t idHash = {};
 };
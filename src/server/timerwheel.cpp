@@ -0,0 +1,179 @@
+#include "timerwheel.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <limits>
+
+RCLAP_BEGIN_NAMESPACE
+
+TimerWheel::TimerWheel(std::size_t capacity, std::uint64_t now) : mNow(now)
+{
+    mSlots.fill(Nil);
+    mTimers.reserve(capacity);
+    while (mTimers.size() < capacity)
+        grow();
+    mCascade.reserve(capacity);
+}
+
+TimerWheel::Id TimerWheel::add(Fn &&fn, std::uint64_t expiry)
+{
+    if (mFree == Nil)
+        grow();
+    const auto index = mFree;
+    auto &t = mTimers[index];
+    mFree = t.next;
+    t.fn = std::move(fn);
+    t.expiry = std::max(expiry, mNow + 1);
+    link(index);
+    ++mSize;
+    return (static_cast<Id>(t.generation) << 32) | index;
+}
+
+bool TimerWheel::cancel(Id id)
+{
+    const auto index = static_cast<std::uint32_t>(id);
+    if (index >= mTimers.size())
+        return false;
+    auto &t = mTimers[index];
+    if (t.generation != static_cast<std::uint32_t>(id >> 32) || t.slot == NoSlot)
+        return false;
+    unlink(index);
+    t.fn = nullptr;
+    if (++t.generation == 0)
+        t.generation = 1;
+    t.next = mFree;
+    mFree = index;
+    --mSize;
+    return true;
+}
+
+void TimerWheel::advance(std::uint64_t now, std::vector<Fn> &expired)
+{
+    if (now <= mNow)
+        return;
+
+    // Collect the slots of every level the clock passed. If a level didn't move,
+    // neither did the ones above.
+    for (std::size_t level = 0; level < Levels; ++level) {
+        const auto shift = level * SlotBits;
+        const auto oldPos = mNow >> shift;
+        const auto newPos = now >> shift;
+        if (oldPos == newPos)
+            break;
+        auto passed = std::numeric_limits<std::uint64_t>::max();
+        if (newPos - oldPos < SlotsPerLevel) {
+            // The slots after the current one, up to and including the new one.
+            passed = std::rotl((std::uint64_t(1) << (newPos - oldPos)) - 1, static_cast<int>((oldPos + 1) % SlotsPerLevel));
+        }
+        for (auto pending = mOccupied[level] & passed; pending != 0; pending &= pending - 1) {
+            auto &head = mSlots[level * SlotsPerLevel + static_cast<std::size_t>(std::countr_zero(pending))];
+            for (auto index = head; index != Nil; index = mTimers[index].next) {
+                mTimers[index].slot = NoSlot;
+                mCascade.push_back(index);
+            }
+            head = Nil;
+        }
+        mOccupied[level] &= ~passed;
+    }
+
+    mNow = now;
+    for (const auto index : mCascade) {
+        if (mTimers[index].expiry <= mNow)
+            release(index, expired);
+        else
+            link(index);
+    }
+    mCascade.clear();
+}
+
+void TimerWheel::clear(std::vector<Fn> &expired)
+{
+    for (std::uint32_t index = 0; index < mTimers.size(); ++index) {
+        if (mTimers[index].slot == NoSlot)
+            continue;
+        unlink(index);
+        release(index, expired);
+    }
+}
+
+std::optional<std::uint64_t> TimerWheel::nextExpiry() const noexcept
+{
+    if (mSize == 0)
+        return std::nullopt;
+
+    auto next = std::numeric_limits<std::uint64_t>::max();
+    for (std::size_t level = 0; level < Levels; ++level) {
+        if (mOccupied[level] == 0)
+            continue;
+        const auto shift = level * SlotBits;
+        const auto pos = mNow >> shift;
+        // Distance to the next occupied slot after the current one.
+        const auto first = static_cast<int>((pos + 1) % SlotsPerLevel);
+        const auto distance = static_cast<std::uint64_t>(std::countr_zero(std::rotr(mOccupied[level], first))) + 1;
+        next = std::min(next, (pos + distance) << shift);
+    }
+    return next;
+}
+
+void TimerWheel::grow()
+{
+    const auto oldSize = mTimers.size();
+    const auto newSize = std::max<std::size_t>(16, oldSize * 2);
+    assert(newSize < Nil);
+    mTimers.resize(newSize);
+    for (auto index = newSize; index-- > oldSize;) {
+        mTimers[index].next = mFree;
+        mFree = static_cast<std::uint32_t>(index);
+    }
+}
+
+void TimerWheel::link(std::uint32_t index)
+{
+    auto &t = mTimers[index];
+    assert(t.expiry > mNow);
+    const auto level = std::min(static_cast<std::size_t>(std::bit_width(t.expiry ^ mNow) - 1) / SlotBits, Levels - 1);
+    const auto shift = level * SlotBits;
+    // The top level also takes the timers beyond the range of the wheel. They are parked
+    // in the slot that is visited last and linked again from there.
+    const auto pos = std::min(t.expiry >> shift, (mNow >> shift) + SlotsPerLevel - 1);
+    const auto slot = static_cast<std::size_t>(pos % SlotsPerLevel);
+
+    auto &head = mSlots[level * SlotsPerLevel + slot];
+    t.slot = static_cast<std::uint16_t>(level * SlotsPerLevel + slot);
+    t.prev = Nil;
+    t.next = head;
+    if (head != Nil)
+        mTimers[head].prev = index;
+    head = index;
+    mOccupied[level] |= std::uint64_t(1) << slot;
+}
+
+void TimerWheel::unlink(std::uint32_t index)
+{
+    auto &t = mTimers[index];
+    auto &head = mSlots[t.slot];
+    if (t.prev != Nil)
+        mTimers[t.prev].next = t.next;
+    else
+        head = t.next;
+    if (t.next != Nil)
+        mTimers[t.next].prev = t.prev;
+    if (head == Nil)
+        mOccupied[t.slot / SlotsPerLevel] &= ~(std::uint64_t(1) << (t.slot % SlotsPerLevel));
+    t.slot = NoSlot;
+}
+
+void TimerWheel::release(std::uint32_t index, std::vector<Fn> &expired)
+{
+    auto &t = mTimers[index];
+    expired.push_back(std::move(t.fn));
+    t.fn = nullptr;
+    if (++t.generation == 0)
+        t.generation = 1;
+    t.next = mFree;
+    mFree = index;
+    --mSize;
+}
+
+RCLAP_END_NAMESPACE
@@ -0,0 +1,81 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <core/global.h>
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+
+RCLAP_BEGIN_NAMESPACE
+
+// A hierarchical timer wheel with Levels levels of 64 slots each. Level l holds the
+// timers whose expiry differs from now() first in the bits [6l, 6l + 6), advancing
+// cascades them down until they expire in level 0.
+// Timers live in a preallocated pool and are linked into their slot by index, so
+// adding, cancelling and firing a timer doesn't allocate unless the pool is full.
+// The wheel has no notion of time, expiries are in ticks of the owner's clock.
+// Not thread-safe.
+class TimerWheel
+{
+public:
+    using Fn = std::function<void(bool)>;
+    // Index and generation of the slot. Stale ids of fired or cancelled timers are rejected.
+    using Id = std::uint64_t;
+    static constexpr Id InvalidId = 0;
+    static constexpr std::size_t Levels = 4;
+    static constexpr std::size_t SlotsPerLevel = 64;
+
+    explicit TimerWheel(std::size_t capacity = 1024, std::uint64_t now = 0);
+
+    // Timers that already expired fire on the next tick.
+    Id add(Fn &&fn, std::uint64_t expiry);
+    // Removes the timer without calling its function. O(1).
+    bool cancel(Id id);
+    // Moves the functions of all timers that expired up to \a now into \a expired.
+    void advance(std::uint64_t now, std::vector<Fn> &expired);
+    // Moves the functions of all pending timers into \a expired.
+    void clear(std::vector<Fn> &expired);
+    // The tick at which advance() has to be called next. This is exact for timers in
+    // level 0 and the time of the next cascade for the others.
+    [[nodiscard]] std::optional<std::uint64_t> nextExpiry() const noexcept;
+
+    [[nodiscard]] std::uint64_t now() const noexcept { return mNow; }
+    [[nodiscard]] std::size_t size() const noexcept { return mSize; }
+    [[nodiscard]] bool empty() const noexcept { return mSize == 0; }
+    [[nodiscard]] std::size_t capacity() const noexcept { return mTimers.size(); }
+
+private:
+    static constexpr std::uint32_t Nil = 0xffffffff;
+    static constexpr std::uint32_t SlotBits = 6;
+    static constexpr std::uint16_t NoSlot = 0xffff;
+
+    struct Timer
+    {
+        Fn fn;
+        std::uint64_t expiry = 0;
+        std::uint32_t prev = Nil;
+        std::uint32_t next = Nil;
+        std::uint32_t generation = 1;
+        std::uint16_t slot = NoSlot; // level * SlotsPerLevel + slot while linked
+    };
+
+    void grow();
+    void link(std::uint32_t index);
+    void unlink(std::uint32_t index);
+    void release(std::uint32_t index, std::vector<Fn> &expired);
+
+    std::vector<Timer> mTimers;
+    std::uint32_t mFree = Nil; // Free list, chained through Timer::next
+    std::array<std::uint32_t, Levels * SlotsPerLevel> mSlots;
+    std::array<std::uint64_t, Levels> mOccupied = {}; // Bit per non-empty slot
+    std::vector<std::uint32_t> mCascade;
+    std::uint64_t mNow = 0;
+    std::size_t mSize = 0;
+};
+
+RCLAP_END_NAMESPACE
+
+#endif // TIMERWHEEL_H
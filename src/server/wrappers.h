@@ -9,6 +9,8 @@ using namespace api::v0;
 
 #include <clap/events.h>
 
+#include <optional>
+#include <type_traits>
 #include <variant>
 
 RCLAP_BEGIN_NAMESPACE
@@ -17,13 +19,13 @@ struct ClapEventNoteWrapper {
     ClapEventNoteWrapper() = default;
     ClapEventNoteWrapper(const clap_event_note* note, uint32_t type)
        : noteId(note->note_id), portIndex(note->port_index), channel(note->channel),
-         key(note->key), value(note->velocity), type(type)
+         key(note->key), value(note->velocity), type(type), frameOffset(note->header.time)
     {
         assert(type != CLAP_EVENT_NOTE_EXPRESSION);
     }
     ClapEventNoteWrapper(const clap_event_note_expression* expr, uint32_t type, int32_t exprType)
        : noteId(expr->note_id), portIndex(expr->port_index), channel(expr->channel), key(expr->key),
-         value(expr->value), type(type), expression(exprType)
+         value(expr->value), type(type), expression(exprType), frameOffset(expr->header.time)
     {
         assert(type == CLAP_EVENT_NOTE_EXPRESSION);
     }
@@ -42,20 +44,30 @@ struct ClapEventNoteWrapper {
     double value = 0;
     uint32_t type = 0;
     int32_t expression = ClapEventNote_ExpressionType_None;
+    uint32_t frameOffset = 0;
 };
 
 struct ClapEventParamWrapper {
     ClapEventParamWrapper() = default;
-    ClapEventParamWrapper(const clap_event_param_value* param)
-       : type(ClapEventParam_Type_Value), paramId(param->param_id), value(param->value)
+    ClapEventParamWrapper(const clap_event_param_value* param, uint64_t version = 0)
+       : type(ClapEventParam_Type_Value), paramId(param->param_id), value(param->value),
+         frameOffset(param->header.time), version(version)
     {}
-    ClapEventParamWrapper(const clap_event_param_mod* param)
-       : type(ClapEventParam_Type_Modulation), paramId(param->param_id), modulation(param->amount)
+    ClapEventParamWrapper(const clap_event_param_mod* param, uint64_t version = 0)
+       : type(ClapEventParam_Type_Modulation), paramId(param->param_id), modulation(param->amount),
+         frameOffset(param->header.time), version(version)
+    {}
+    ClapEventParamWrapper(const clap_event_param_gesture* param)
+       : type(param->header.type == CLAP_EVENT_PARAM_GESTURE_BEGIN
+              ? ClapEventParam_Type_GestureBegin : ClapEventParam_Type_GestureEnd),
+         paramId(param->param_id), frameOffset(param->header.time)
     {}
     ClapEventParam::Type type = ClapEventParam_Type_Value;
     uint32_t paramId = 0;
     double value = 0;
     double modulation = 0;
+    uint32_t frameOffset = 0;
+    uint64_t version = 0; // ParamStates.version of the change, 0 if untracked
 };
 
 struct ClapEventParamInfoWrapper {
@@ -71,6 +83,13 @@ struct ClapEventMainSyncWrapper {
     int64_t windowId = 0;
 };
 
+// When an event was produced by process(). Zero for events of the main thread.
+struct EventTime
+{
+    uint64_t block = 0;  // Sequence number of the process block
+    uint64_t timeNs = 0; // Steady clock at the start of the block
+};
+
 struct ServerEventWrapper
 {
     using T = std::variant<
@@ -89,22 +108,111 @@ struct ServerEventWrapper
     ServerEventWrapper(Event e, ClapEventMainSyncWrapper &&data)
         : ev(e), data(std::move(data)) {}
 
+    // Frame offset of the event within its block, if the payload has one.
+    [[nodiscard]] uint32_t frameOffset() const noexcept
+    {
+        if (const auto *n = std::get_if<ClapEventNoteWrapper>(&data))
+            return n->frameOffset;
+        if (const auto *p = std::get_if<ClapEventParamWrapper>(&data))
+            return p->frameOffset;
+        return 0;
+    }
+
     Event ev;
     T data;
-    std::optional<Stamp> ts;
+    EventTime time;
+};
+
+// An event of process() as it's queued on the audio thread. Fixed size and trivially
+// copyable, a push is a plain copy into the slot. Events with strings, like the param
+// infos, go through the main thread queue. Expanded by the poll loop.
+struct ProcessEventRecord
+{
+    enum class Kind : uint8_t { Note, Param };
+
+    ProcessEventRecord() = default;
+    ProcessEventRecord(const ClapEventNoteWrapper &n)
+        : id(static_cast<uint32_t>(n.noteId)), frameOffset(n.frameOffset), kind(Kind::Note),
+          type(static_cast<uint8_t>(n.type)), expression(static_cast<int8_t>(n.expression)),
+          channel(static_cast<int8_t>(n.channel)), key(static_cast<int8_t>(n.key)),
+          port(static_cast<int16_t>(n.portIndex)), value(n.value)
+    {}
+    ProcessEventRecord(const ClapEventParamWrapper &p)
+        : id(p.paramId), frameOffset(p.frameOffset), kind(Kind::Param), type(static_cast<uint8_t>(p.type)),
+          value(p.type == ClapEventParam_Type_Modulation ? p.modulation : p.value), version(p.version)
+    {}
+
+    [[nodiscard]] ServerEventWrapper toWrapper() const
+    {
+        ServerEventWrapper ev;
+        if (kind == Kind::Note) {
+            ClapEventNoteWrapper n;
+            n.noteId = static_cast<int32_t>(id);
+            n.portIndex = port;
+            n.channel = channel;
+            n.key = key;
+            n.value = value;
+            n.type = type;
+            n.expression = expression;
+            n.frameOffset = frameOffset;
+            ev = { Event::Note, std::move(n) };
+        } else {
+            ClapEventParamWrapper p;
+            p.type = static_cast<ClapEventParam::Type>(type);
+            p.paramId = id;
+            (p.type == ClapEventParam_Type_Modulation ? p.modulation : p.value) = value;
+            p.frameOffset = frameOffset;
+            p.version = version;
+            ev = { Event::Param, std::move(p) };
+        }
+        ev.time = time;
+        return ev;
+    }
+
+    uint32_t id = 0;            // Note or param id
+    uint32_t frameOffset = 0;
+    Kind kind = Kind::Param;
+    uint8_t type = 0;           // ClapEventNote::Type or ClapEventParam::Type
+    int8_t expression = ClapEventNote_ExpressionType_None;
+    int8_t channel = 0;         // -1 to 15
+    int8_t key = 0;             // -1 to 127
+    int16_t port = 0;
+    double value = 0;           // Velocity, expression, param value or modulation amount
+    uint64_t version = 0;       // Of the param change
+    EventTime time;
 };
+static_assert(std::is_trivially_copyable_v<ProcessEventRecord>);
+static_assert(sizeof(ProcessEventRecord) == 48);
+
+// Values and modulations of a param are conflated separately, gestures and notes never.
+inline std::optional<uint64_t> conflationKey(const ProcessEventRecord &ev) noexcept
+{
+    if (ev.kind != ProcessEventRecord::Kind::Param
+        || (ev.type != ClapEventParam_Type_Value && ev.type != ClapEventParam_Type_Modulation))
+        return std::nullopt;
+    return (static_cast<uint64_t>(ev.type) << 32) | ev.id;
+}
 
 struct ClientParamWrapper
 {
     ClientParamWrapper()
-        : ev(Event::EventInvalid), paramId(0), value(0) {}
+        : ev(Event::EventInvalid), paramId(0), value(0), timeNs(0) {}
     explicit ClientParamWrapper(const ClientParam &other)
-        : ev(other.event()), paramId(other.param().param_id()), value(other.param().value()) {}
+        : ev(other.event()), paramId(other.param().param_id()), value(other.param().value()),
+          timeNs(other.time_ns()) {}
     Event ev;
     uint32_t paramId;
     double value;
+    uint64_t timeNs; // Target time on the steady clock, 0 for as soon as possible
 };
 
+inline std::optional<uint64_t> conflationKey(const ClientParamWrapper &ev) noexcept
+{
+    if (ev.ev != Event::Param)
+        return std::nullopt;
+    return ev.paramId;
+}
+
 RCLAP_END_NAMESPACE
 
 #endif // WRAPPERS_H
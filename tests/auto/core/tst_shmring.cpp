@@ -0,0 +1,89 @@
+#include <core/shmring.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+using namespace RCLAP_NAMESPACE;
+
+TEST_CASE("ShmRing", "[Core]")
+{
+    auto producer = ShmRing::create(4096);
+    REQUIRE(producer);
+    REQUIRE(producer->capacity() == 4096);
+
+    // The consumer maps the same memory through its own fds, just like a child process would.
+    auto consumer = ShmRing::attach(dup(producer->memFd()), dup(producer->eventFd()));
+    REQUIRE(consumer);
+    REQUIRE(consumer->capacity() == producer->capacity());
+
+    std::string record;
+    SECTION("Write and read")
+    {
+        REQUIRE(!consumer->read(record));
+        REQUIRE(producer->write("hello"));
+        REQUIRE(producer->write(""));
+        REQUIRE(consumer->read(record));
+        CHECK(record == "hello");
+        REQUIRE(consumer->read(record));
+        CHECK(record.empty());
+        CHECK(!consumer->read(record));
+    }
+
+    SECTION("Full ring and wrap around")
+    {
+        const std::string big(1000, 'x');
+        int written = 0;
+        while (producer->write(big))
+            ++written;
+        CHECK(written == 4);
+        CHECK(!producer->write(std::string(producer->maxRecordSize() + 1, 'y')));
+
+        // Records must stay intact across the end of the ring.
+        for (int round = 0; round < 16; ++round) {
+            REQUIRE(consumer->read(record));
+            CHECK(record == big);
+            const auto next = std::string(static_cast<std::size_t>(700 + round * 13), static_cast<char>('a' + round));
+            REQUIRE(producer->write(next));
+            while (consumer->read(record)) {
+                if (record != big)
+                    CHECK(record == next);
+            }
+            REQUIRE(producer->write(big));
+        }
+    }
+
+    SECTION("Wait is woken by the producer")
+    {
+        CHECK(!consumer->wait(std::chrono::milliseconds(1)));
+        std::jthread writer([&] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            producer->write("wake up");
+        });
+        REQUIRE(consumer->wait(std::chrono::seconds(5)));
+        REQUIRE(consumer->read(record));
+        CHECK(record == "wake up");
+    }
+
+    SECTION("Close")
+    {
+        CHECK(!consumer->isClosed());
+        producer->close();
+        CHECK(consumer->wait(std::chrono::seconds(5)));
+        CHECK(consumer->isClosed());
+        producer->reset();
+        CHECK(!consumer->isClosed());
+    }
+
+    SECTION("Fd argument")
+    {
+        CHECK(!ShmRing::attach("no-fds"));
+        auto again = ShmRing::attach(std::to_string(dup(producer->memFd())) + ":" + std::to_string(dup(producer->eventFd())));
+        REQUIRE(again);
+        REQUIRE(producer->write("shared"));
+        REQUIRE(again->read(record));
+        CHECK(record == "shared");
+    }
+}
@@ -0,0 +1,192 @@
+#include <plugin/coreplugin.h>
+#include <plugin/modules/module.h>
+#include <plugin/parameter/decibel_valuetype.h>
+#include <server/serverctrl.h>
+#include <server/shareddata.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace RCLAP_NAMESPACE;
+
+// One frame per millisecond, a block spans 100ms. Generous enough for the time that passes
+// between stamping a param and the block that schedules it.
+static constexpr double SampleRate = 1000.0;
+static constexpr uint32_t Frames = 100;
+static constexpr uint64_t MsNs = 1'000'000;
+
+static uint64_t nowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count());
+}
+
+class TestModule : public Module
+{
+public:
+    using Module::Module;
+    void init() noexcept override
+    {
+        for (uint32_t i = 0; i < 4; ++i)
+            addParameter(i, "Param " + std::to_string(i), 0, std::make_unique<DecibelValueType>(-40.0, 0.0, 0.0));
+    }
+};
+
+class TestPlugin : public CorePlugin
+{
+public:
+    TestPlugin(const Settings &settings, const clap_plugin_descriptor *desc, const clap_host *host)
+        : CorePlugin(settings, desc, host, std::make_unique<TestModule>(*this, "Test", 0))
+    {}
+};
+
+// The out_events of the host. Collects the params, or refuses them all.
+struct OutEvents
+{
+    clap_output_events ov { this, &OutEvents::tryPush };
+    std::vector<clap_event_param_value> params;
+    bool accept = true;
+
+    static bool tryPush(const clap_output_events *ov, const clap_event_header_t *ev)
+    {
+        auto *self = static_cast<OutEvents *>(ov->ctx);
+        if (!self->accept)
+            return false;
+        REQUIRE(ev->type == CLAP_EVENT_PARAM_VALUE);
+        self->params.push_back(*reinterpret_cast<const clap_event_param_value *>(ev));
+        return true;
+    }
+};
+
+static uint32_t noInEvents(const clap_input_events *) { return 0; }
+static const clap_event_header_t *noInEvent(const clap_input_events *, uint32_t) { return nullptr; }
+
+class Fixture
+{
+public:
+    Fixture()
+    {
+        desc.id = "tst_coreplugin";
+        desc.name = "CorePlugin Test";
+        host.name = "Test Host";
+        host.version = "0.0";
+        in.size = &noInEvents;
+        in.get = &noInEvent;
+
+        QueueConfig queues;
+        queues.clients.capacity = 1024;
+        plugin = std::make_unique<TestPlugin>(Settings().withQueues(queues), &desc, &host);
+        REQUIRE(plugin->activate(SampleRate, Frames, Frames));
+        sd = ServerCtrl::instance().getSharedData(plugin->hashId());
+        REQUIRE(sd);
+    }
+
+    void push(uint32_t paramId, double value, uint64_t timeNs)
+    {
+        ClientParamWrapper ev;
+        ev.ev = Event::Param;
+        ev.paramId = paramId;
+        ev.value = value;
+        ev.timeNs = timeNs;
+        REQUIRE(sd->clientsToPluginQueue().push(std::move(ev)));
+    }
+
+    // Runs a block and returns the params it passed to the host.
+    std::vector<clap_event_param_value> process()
+    {
+        out.params.clear();
+        clap_process proc {};
+        proc.frames_count = Frames;
+        proc.in_events = &in;
+        proc.out_events = &out.ov;
+        plugin->process(&proc);
+        return out.params;
+    }
+
+    clap_plugin_descriptor desc {};
+    clap_host host {};
+    clap_input_events in {};
+    OutEvents out;
+    std::unique_ptr<TestPlugin> plugin;
+    std::shared_ptr<SharedData> sd;
+};
+
+TEST_CASE("CorePlugin schedules client params")
+{
+    Fixture f;
+
+    SECTION("Ordered by time, past and untimed ones at the first frame")
+    {
+        const auto now = nowNs();
+        f.push(0, -1.0, now + 60 * MsNs);
+        f.push(1, -2.0, 0);                // As soon as possible
+        f.push(2, -3.0, now + 20 * MsNs);
+        f.push(3, -4.0, 1);                // Long past
+
+        const auto params = f.process();
+        REQUIRE(params.size() == 4);
+        CHECK(params[0].param_id == 1);
+        CHECK(params[0].header.time == 0);
+        CHECK(params[1].param_id == 3);
+        CHECK(params[1].header.time == 0);
+        // The block starts a little after the params were stamped.
+        CHECK(params[2].param_id == 2);
+        CHECK(params[2].header.time <= 20);
+        CHECK(params[2].header.time >= 10);
+        CHECK(params[3].param_id == 0);
+        CHECK(params[3].header.time <= 60);
+        CHECK(params[3].header.time >= 50);
+        for (const auto &p : params)
+            CHECK(p.value == -1.0 - p.param_id);
+    }
+
+    SECTION("Params past the block carry over")
+    {
+        const auto due = nowNs() + 150 * MsNs;
+        f.push(0, -1.0, due);
+        f.push(1, -2.0, 0);
+
+        auto params = f.process();
+        REQUIRE(params.size() == 1);
+        CHECK(params[0].param_id == 1);
+
+        while (nowNs() <= due)
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        // Late by now, it lands on the first frame of the next block.
+        params = f.process();
+        REQUIRE(params.size() == 1);
+        CHECK(params[0].param_id == 0);
+        CHECK(params[0].header.time == 0);
+
+        CHECK(f.process().empty());
+    }
+
+    SECTION("At most 512 params are pending, the rest waits in the queue")
+    {
+        for (uint32_t i = 0; i < 600; ++i)
+            f.push(i % 4, -1.0, 1);
+
+        CHECK(f.process().size() == 512);
+        CHECK(f.process().size() == 88);
+        CHECK(f.process().empty());
+    }
+
+    SECTION("Params the host refuses are applied and counted")
+    {
+        f.out.accept = false;
+        f.push(0, -5.0, 0);
+        f.push(1, -6.0, 0);
+
+        CHECK(f.process().empty());
+        CHECK(f.plugin->droppedClientParams() == 2);
+        double value = 0;
+        REQUIRE(f.plugin->paramsValue(0, &value));
+        CHECK(value == -5.0);
+        REQUIRE(f.plugin->paramsValue(1, &value));
+        CHECK(value == -6.0);
+    }
+}
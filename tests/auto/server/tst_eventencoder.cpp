@@ -0,0 +1,262 @@
+#include <server/eventencoder.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <limits>
+
+using namespace RCLAP_NAMESPACE;
+
+namespace {
+
+// The reference path: build the message tree and let protobuf serialize it.
+void addReference(ServerEvents &evs, const ServerEventWrapper &w)
+{
+    auto *next = evs.add_events();
+    next->set_event(w.ev);
+    std::visit([&](auto &&arg) {
+        using T = std::decay_t<decltype(arg)>;
+        if constexpr (std::is_same_v<T, ClapEventNoteWrapper>) {
+            next->mutable_note()->set_note_id(arg.noteId);
+            next->mutable_note()->set_port_index(arg.portIndex);
+            next->mutable_note()->set_channel(arg.channel);
+            next->mutable_note()->set_key(arg.key);
+            next->mutable_note()->set_value(arg.value);
+            next->mutable_note()->set_type(arg.getType());
+            next->mutable_note()->set_expression(arg.getExpressionType());
+        } else if constexpr (std::is_same_v<T, ClapEventParamWrapper>) {
+            next->mutable_param()->set_type(arg.type);
+            next->mutable_param()->set_param_id(arg.paramId);
+            next->mutable_param()->set_value(arg.value);
+            next->mutable_param()->set_modulation(arg.modulation);
+            next->mutable_param()->set_version(arg.version);
+        } else if constexpr (std::is_same_v<T, ClapEventParamInfoWrapper>) {
+            next->mutable_param_info()->set_param_id(arg.paramId);
+            next->mutable_param_info()->set_name(arg.name);
+            next->mutable_param_info()->set_module(arg.module);
+            next->mutable_param_info()->set_min_value(arg.minValue);
+            next->mutable_param_info()->set_max_value(arg.maxValue);
+            next->mutable_param_info()->set_default_value(arg.defaultValue);
+        } else if constexpr (std::is_same_v<T, ClapEventMainSyncWrapper>) {
+            next->mutable_main_sync()->set_window_id(arg.windowId);
+        }
+    }, w.data);
+    next->set_frame(w.frameOffset());
+    next->set_block(w.time.block);
+    next->set_time_ns(w.time.timeNs);
+}
+
+void addPackedBlock(PackedEvents &packed, const EventTime &time)
+{
+    if (time.block == 0 || (packed.blocks_size() != 0 && packed.blocks(packed.blocks_size() - 1) == time.block))
+        return;
+    packed.add_blocks(time.block);
+    packed.add_block_times_ns(time.timeNs);
+}
+
+ServerEventWrapper timed(ServerEventWrapper ev, uint64_t block, uint64_t timeNs)
+{
+    ev.time = { block, timeNs };
+    return ev;
+}
+
+void addPackedReference(ServerEvents &evs, const ServerEventWrapper &w)
+{
+    if (w.ev == Event::Param) {
+        const auto &pm = std::get<ClapEventParamWrapper>(w.data);
+        auto *packed = evs.mutable_packed();
+        packed->add_param_ids(pm.paramId);
+        packed->add_param_types(pm.type);
+        packed->add_param_values(static_cast<float>(pm.type == ClapEventParam_Type_Modulation ? pm.modulation : pm.value));
+        packed->add_param_frames(pm.frameOffset);
+        packed->add_param_blocks(w.time.block);
+        packed->add_param_versions(pm.version);
+        addPackedBlock(*packed, w.time);
+    } else if (w.ev == Event::Note) {
+        const auto &n = std::get<ClapEventNoteWrapper>(w.data);
+        auto *packed = evs.mutable_packed();
+        packed->add_note_ids(n.noteId);
+        packed->add_note_ports(n.portIndex);
+        packed->add_note_channels(n.channel);
+        packed->add_note_keys(n.key);
+        packed->add_note_types(n.getType());
+        packed->add_note_expressions(n.expression);
+        packed->add_note_values(static_cast<float>(n.value));
+        packed->add_note_frames(n.frameOffset);
+        packed->add_note_blocks(w.time.block);
+        addPackedBlock(*packed, w.time);
+    } else {
+        addReference(evs, w);
+    }
+}
+
+ClapEventNoteWrapper note(int32_t id, int32_t port, int32_t channel, int32_t key, double value,
+                          uint32_t type, int32_t expression = ClapEventNote_ExpressionType_None)
+{
+    ClapEventNoteWrapper n;
+    n.noteId = id;
+    n.portIndex = port;
+    n.channel = channel;
+    n.key = key;
+    n.value = value;
+    n.type = type;
+    n.expression = expression;
+    n.frameOffset = static_cast<uint32_t>(key);
+    return n;
+}
+
+ClapEventParamWrapper param(ClapEventParam::Type type, uint32_t id, double value, double mod, uint64_t version = 0)
+{
+    ClapEventParamWrapper p;
+    p.type = type;
+    p.paramId = id;
+    p.value = value;
+    p.modulation = mod;
+    p.frameOffset = id % 512;
+    p.version = version;
+    return p;
+}
+
+} // namespace
+
+TEST_CASE("EventEncoder")
+{
+    std::vector<ServerEventWrapper> events;
+    events.emplace_back(Event::Note, note(0, 0, 0, 0, 0.0, ClapEventNote_Type_NoteOn, 0));
+    events.emplace_back(Event::Note, note(-1, -1, -1, 60, 0.5, ClapEventNote_Type_NoteOff));
+    events.emplace_back(Event::Note, note(1234567, 3, 15, 127, -0.0, ClapEventNote_Type_NoteExpression, 6));
+    events.emplace_back(Event::Note, note(std::numeric_limits<int32_t>::min(), 1, 2, 3, 1e300, ClapEventNote_Type_NoteChoke));
+    events.emplace_back(Event::Param, param(ClapEventParam_Type_Value, 0, 0.0, 0.0));
+    events.emplace_back(Event::Param, param(ClapEventParam_Type_Modulation, 4096, 0.25, -1.5));
+    events.emplace_back(Event::Param, param(ClapEventParam_Type_GestureEnd, std::numeric_limits<uint32_t>::max(), 1.0, 0.0));
+    events.emplace_back(Event::ParamInfo, ClapEventParamInfoWrapper{ 7, "Gain", "Main/Amp", -60.0, 12.0, 0.0 });
+    events.emplace_back(Event::ParamInfo, ClapEventParamInfoWrapper{ 0, "", "", 0.0, 0.0, 0.0 });
+    events.emplace_back(Event::ParamInfo, ClapEventParamInfoWrapper{ 1, std::string(300, 'x'), "m", 0.0, 1.0, 0.5 });
+    events.emplace_back(Event::GuiSetTransient, ClapEventMainSyncWrapper{ 0x7fff'0000'1234 });
+    events.emplace_back(Event::PluginActivate, ClapEventMainSyncWrapper{});
+    events.emplace_back(Event::GuiCreate, ClapEventMainSyncWrapper{ -1 });
+    events.emplace_back();
+    events.push_back(timed({ Event::Note, note(2, 0, 1, 64, 0.8, ClapEventNote_Type_NoteOn) }, 1, 1'700'000'000'123'456'789));
+    events.push_back(timed({ Event::Param, param(ClapEventParam_Type_Value, 3, 0.1, 0.0) }, 1ull << 40, 1));
+    events.push_back(timed({ Event::Param, param(ClapEventParam_Type_Value, 3, 0.2, 0.0, 1ull << 35) }, 2, 1));
+
+    SECTION("Single events are byte-compatible")
+    {
+        EventEncoder encoder;
+        for (const auto &ev : events) {
+            ServerEvents ref;
+            addReference(ref, ev);
+            encoder.clear();
+            encoder.add(ev);
+            CHECK(encoder.count() == 1);
+            CHECK(encoder.bytes() == ref.SerializeAsString());
+        }
+    }
+
+    SECTION("Batches are byte-compatible and the buffer is reusable")
+    {
+        EventEncoder encoder(16);
+        for (int round = 0; round < 3; ++round) {
+            ServerEvents ref;
+            encoder.clear();
+            for (const auto &ev : events) {
+                addReference(ref, ev);
+                encoder.add(ev);
+            }
+            REQUIRE(encoder.count() == events.size());
+            REQUIRE(encoder.bytes() == ref.SerializeAsString());
+
+            ServerEvents parsed;
+            REQUIRE(parsed.ParseFromArray(encoder.bytes().data(), static_cast<int>(encoder.bytes().size())));
+            REQUIRE(parsed.events_size() == static_cast<int>(events.size()));
+            CHECK(parsed.events(1).note().note_id() == -1);
+            CHECK(parsed.events(7).param_info().module() == "Main/Amp");
+        }
+        encoder.clear();
+        CHECK(encoder.empty());
+        CHECK(encoder.bytes().empty());
+    }
+}
+
+TEST_CASE("PackedEventEncoder")
+{
+    std::vector<ServerEventWrapper> events;
+    events.emplace_back(Event::GuiCreate, ClapEventMainSyncWrapper{ 3 });
+    events.emplace_back(Event::Note, note(-1, 0, 15, 60, 0.5, ClapEventNote_Type_NoteOn));
+    events.emplace_back(Event::Param, param(ClapEventParam_Type_Value, 12, 0.75, 0.0));
+    events.emplace_back(Event::Param, param(ClapEventParam_Type_Modulation, 1'000'000, 0.0, -0.5));
+    events.emplace_back(Event::Note, note(std::numeric_limits<int32_t>::min(), -1, 2, 127, 1.0, ClapEventNote_Type_NoteExpression, 4));
+    events.emplace_back(Event::ParamInfo, ClapEventParamInfoWrapper{ 7, "Gain", "Main/Amp", -60.0, 12.0, 0.0 });
+    events.emplace_back(Event::Param, param(ClapEventParam_Type_GestureBegin, 0, 0.0, 0.0));
+    events.push_back(timed({ Event::Param, param(ClapEventParam_Type_Value, 5, 0.3, 0.0) }, 41, 9'000));
+    events.push_back(timed({ Event::Note, note(4, 0, 0, 72, 1.0, ClapEventNote_Type_NoteOff) }, 41, 9'000));
+    events.push_back(timed({ Event::Param, param(ClapEventParam_Type_Value, 6, 0.4, 0.0, 300) }, 42, 12'000));
+
+    PackedEventEncoder encoder(2);
+    for (int round = 0; round < 2; ++round) {
+        ServerEvents ref;
+        encoder.clear();
+        for (const auto &ev : events) {
+            addPackedReference(ref, ev);
+            encoder.add(ev);
+        }
+        REQUIRE(encoder.count() == events.size());
+        const auto bytes = encoder.finish();
+        REQUIRE(bytes == ref.SerializeAsString());
+
+        ServerEvents parsed;
+        REQUIRE(parsed.ParseFromArray(bytes.data(), static_cast<int>(bytes.size())));
+        CHECK(parsed.events_size() == 2);
+        CHECK(parsed.packed().param_ids_size() == 5);
+        CHECK(parsed.packed().param_versions(4) == 300);
+        CHECK(parsed.packed().param_blocks(3) == 41);
+        CHECK(parsed.packed().blocks_size() == 2);
+        CHECK(parsed.packed().block_times_ns(1) == 12'000);
+        CHECK(parsed.packed().param_values(1) == -0.5f);
+        CHECK(parsed.packed().note_ids(0) == -1);
+        CHECK(parsed.packed().note_ports(1) == -1);
+        CHECK(parsed.packed().note_frames(1) == 127);
+    }
+
+    SECTION("Batches without params and notes have no columns")
+    {
+        encoder.clear();
+        encoder.add(events.front());
+        ServerEvents ref;
+        addPackedReference(ref, events.front());
+        CHECK(encoder.finish() == ref.SerializeAsString());
+        CHECK(!ref.has_packed());
+    }
+}
+
+TEST_CASE("ProcessEventRecord")
+{
+    ClapEventNoteWrapper note;
+    note.noteId = 42;
+    note.portIndex = 1;
+    note.channel = -1;
+    note.key = 127;
+    note.value = 0.25;
+    note.type = ClapEventNote_Type_NoteExpression;
+    note.expression = ClapEventNote_ExpressionType_Pressure;
+    note.frameOffset = 300;
+    ClapEventParamWrapper mod;
+    mod.type = ClapEventParam_Type_Modulation;
+    mod.paramId = std::numeric_limits<uint32_t>::max();
+    mod.modulation = -0.5;
+    mod.frameOffset = 7;
+    mod.version = 99;
+
+    // The expanded record encodes exactly like the event it was made of.
+    for (const auto &ev : { timed({ Event::Note, ClapEventNoteWrapper(note) }, 3, 1000),
+                            timed({ Event::Param, ClapEventParamWrapper(mod) }, 4, 2000) }) {
+        ProcessEventRecord rec = ev.ev == Event::Note
+            ? ProcessEventRecord(std::get<ClapEventNoteWrapper>(ev.data))
+            : ProcessEventRecord(std::get<ClapEventParamWrapper>(ev.data));
+        rec.time = ev.time;
+        EventEncoder expected;
+        expected.add(ev);
+        EventEncoder expanded;
+        expanded.add(rec.toWrapper());
+        CHECK(expanded.bytes() == expected.bytes());
+    }
+}
@@ -0,0 +1,89 @@
+#include <server/eventfilter.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace RCLAP_NAMESPACE;
+
+namespace {
+
+ServerEventWrapper param(uint32_t id)
+{
+    ClapEventParamWrapper p;
+    p.paramId = id;
+    return { Event::Param, std::move(p) };
+}
+
+ServerEventWrapper note(int32_t port, int32_t channel)
+{
+    ClapEventNoteWrapper n;
+    n.portIndex = port;
+    n.channel = channel;
+    return { Event::Note, std::move(n) };
+}
+
+void addRange(Subscription &s, uint32_t first, uint32_t last)
+{
+    auto *r = s.add_params();
+    r->set_first(first);
+    r->set_last(last);
+}
+
+} // namespace
+
+TEST_CASE("EventFilter")
+{
+    SECTION("No subscription accepts all")
+    {
+        const EventFilter filter{ Subscription() };
+        CHECK(filter.acceptsAll());
+        CHECK(filter.accepts(param(7)));
+        CHECK(filter.accepts(note(3, 15)));
+        CHECK(filter.accepts({ Event::GuiShow, ClapEventMainSyncWrapper{} }));
+    }
+
+    SECTION("Event types")
+    {
+        Subscription s;
+        s.add_events(Event::Param);
+        const EventFilter filter(s);
+        CHECK(!filter.acceptsAll());
+        CHECK(filter.accepts(param(0)));
+        CHECK(!filter.accepts(note(0, 0)));
+        CHECK(!filter.accepts({ Event::PluginActivate, ClapEventMainSyncWrapper{} }));
+    }
+
+    SECTION("Param ranges")
+    {
+        Subscription s;
+        addRange(s, 3, 4);
+        addRange(s, 100, 100);
+        addRange(s, EventFilter::MaxDenseParamId - 2, EventFilter::MaxDenseParamId + 10);
+        addRange(s, 1'000'000, 2'000'000);
+        addRange(s, 1'500'000, 3'000'000);
+        addRange(s, 0xffff'fff0, 0xffff'ffff);
+        addRange(s, 9, 8); // Empty
+        const EventFilter filter(s);
+        for (const uint32_t id : { 3u, 4u, 100u, EventFilter::MaxDenseParamId - 1, EventFilter::MaxDenseParamId,
+                                   EventFilter::MaxDenseParamId + 10, 1'000'000u, 2'500'000u, 3'000'000u, 0xffff'ffffu })
+            CHECK(filter.accepts(param(id)));
+        for (const uint32_t id : { 0u, 2u, 5u, 8u, 9u, 99u, 101u, EventFilter::MaxDenseParamId + 11, 999'999u,
+                                   3'000'001u, 0xffff'ffefu })
+            CHECK(!filter.accepts(param(id)));
+        // Params don't restrict the other events.
+        CHECK(filter.accepts(note(0, 0)));
+    }
+
+    SECTION("Note ports and channels")
+    {
+        Subscription s;
+        s.set_note_port_mask(0b10);
+        s.set_note_channel_mask(1u << 9);
+        const EventFilter filter(s);
+        CHECK(filter.accepts(note(1, 9)));
+        CHECK(filter.accepts(note(1, -1)));
+        CHECK(!filter.accepts(note(0, 9)));
+        CHECK(!filter.accepts(note(1, 10)));
+        CHECK(!filter.accepts(note(40, 9)));
+        CHECK(filter.accepts(param(1)));
+    }
+}
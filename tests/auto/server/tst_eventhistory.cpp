@@ -0,0 +1,102 @@
+#include <server/eventencoder.h>
+#include <server/eventhistory.h>
+
+#include <api.pb.h>
+#include <api.grpc.pb.h>
+#include <grpcpp/grpcpp.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace RCLAP_NAMESPACE;
+using namespace api::v0;
+
+namespace {
+
+ServerEventWrapper paramEvent(uint32_t id, double value)
+{
+    ClapEventParamWrapper p;
+    p.paramId = id;
+    p.value = value;
+    return { Event::Param, std::move(p) };
+}
+
+// Appends a batch with a single param event, stamped with its seq.
+uint64_t appendBatch(EventHistory &history, uint32_t id)
+{
+    EventEncoder encoder;
+    encoder.add(paramEvent(id, 0.5));
+    const auto seq = history.nextSeq();
+    encoder.setSeq(seq);
+    history.append(encoder.bytes());
+    return seq;
+}
+
+ServerEvents parse(const grpc::ByteBuffer &buffer)
+{
+    ServerEvents evs;
+    grpc::ByteBuffer copy(buffer);
+    REQUIRE(grpc::SerializationTraits<ServerEvents>::Deserialize(&copy, &evs).ok());
+    return evs;
+}
+
+} // namespace
+
+TEST_CASE("EventHistory")
+{
+    EventHistory history(4, 1024);
+    CHECK(history.lastSeq() == 0);
+    for (uint32_t id = 1; id <= 3; ++id)
+        CHECK(appendBatch(history, id) == id);
+
+    SECTION("Replays the missed batches as one message with the last seq")
+    {
+        const auto missed = history.replayAfter(1);
+        REQUIRE(missed);
+        const auto evs = parse(*missed);
+        REQUIRE(evs.events_size() == 2);
+        CHECK(evs.events(0).param().param_id() == 2);
+        CHECK(evs.events(1).param().param_id() == 3);
+        CHECK(evs.seq() == 3);
+
+        CHECK(history.replayAfter(3)->Length() == 0);
+        CHECK(!history.replayAfter(4));
+    }
+
+    SECTION("Evicts the oldest batches")
+    {
+        for (uint32_t id = 4; id <= 6; ++id)
+            appendBatch(history, id);
+        CHECK(history.size() == 4);
+        CHECK(history.firstSeq() == 3);
+        CHECK(!history.replayAfter(1));
+        REQUIRE(history.replayAfter(2));
+        CHECK(parse(*history.replayAfter(2)).events(0).param().param_id() == 3);
+
+        EventHistory small(16, history.bytes() / 4);
+        appendBatch(small, 1);
+        appendBatch(small, 2);
+        CHECK(small.size() == 1);
+        CHECK(small.firstSeq() == 2);
+    }
+}
+
+TEST_CASE("PackedEventEncoder seq")
+{
+    PackedEventEncoder encoder;
+    encoder.add(paramEvent(7, 0.25));
+    encoder.setSeq(42);
+    const auto bytes = encoder.finish();
+    ServerEvents evs;
+    REQUIRE(evs.ParseFromArray(bytes.data(), static_cast<int>(bytes.size())));
+    CHECK(evs.packed().param_ids(0) == 7);
+    CHECK(evs.seq() == 42);
+    CHECK(bytes == evs.SerializeAsString());
+
+    encoder.clear();
+    encoder.add({ Event::GuiCreate, ClapEventMainSyncWrapper{ 1 } });
+    encoder.setSeq(43);
+    evs.Clear();
+    const auto other = encoder.finish();
+    REQUIRE(evs.ParseFromArray(other.data(), static_cast<int>(other.size())));
+    CHECK(evs.seq() == 43);
+}
@@ -0,0 +1,258 @@
+#include <server/eventqueue.h>
+#include <server/shareddata.h>
+#include <server/wrappers.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+#include <atomic>
+#include <barrier>
+#include <thread>
+#include <vector>
+
+using namespace RCLAP_NAMESPACE;
+
+namespace {
+
+ProcessEventRecord param(uint32_t id, double value, ClapEventParam::Type type = ClapEventParam_Type_Value)
+{
+    ClapEventParamWrapper p;
+    p.paramId = id;
+    p.type = type;
+    (type == ClapEventParam_Type_Modulation ? p.modulation : p.value) = value;
+    return p;
+}
+
+ProcessEventRecord note(int32_t id)
+{
+    ClapEventNoteWrapper n;
+    n.noteId = id;
+    return n;
+}
+
+std::vector<ProcessEventRecord> popAll(SPMRQueue<ProcessEventRecord> &queue)
+{
+    std::vector<ProcessEventRecord> out;
+    ProcessEventRecord rec;
+    while (queue.pop(rec))
+        out.push_back(rec);
+    return out;
+}
+
+} // namespace
+
+TEST_CASE("EventQueue")
+{
+    SECTION("Capacity is rounded up") {
+        SPMRQueue<ProcessEventRecord> queue(QueueOptions { 5 });
+        CHECK(queue.options().capacity == 8);
+        CHECK(queue.stats().capacity == 8);
+    }
+
+    SECTION("DropNewest") {
+        SPMRQueue<ProcessEventRecord> queue(QueueOptions { 4, OverflowPolicy::DropNewest });
+        for (uint32_t i = 0; i < 6; ++i)
+            CHECK(queue.push(param(i, 0)) == (i < 4));
+        auto stats = queue.stats();
+        CHECK(stats.pushed == 4);
+        CHECK(stats.dropped == 2);
+        CHECK(stats.failures == 2);
+        CHECK(stats.highWater == 4);
+        CHECK(stats.size == 4);
+
+        const auto out = popAll(queue);
+        REQUIRE(out.size() == 4);
+        CHECK(out.front().id == 0);
+        CHECK(out.back().id == 3);
+        stats = queue.stats();
+        CHECK(stats.size == 0);
+        CHECK(stats.highWater == 4);
+
+        // Callers that wait for room fail without dropping.
+        for (uint32_t i = 0; i < 5; ++i)
+            queue.tryPush(note(0));
+        CHECK(queue.stats().dropped == 2);
+        CHECK(queue.stats().failures == 3);
+    }
+
+    SECTION("OverwriteOldest") {
+        SPMRQueue<ProcessEventRecord> queue(QueueOptions { 4, OverflowPolicy::OverwriteOldest });
+        for (uint32_t i = 0; i < 6; ++i)
+            CHECK(queue.push(param(i, 0)));
+        const auto stats = queue.stats();
+        CHECK(stats.pushed == 6);
+        CHECK(stats.dropped == 2);
+        CHECK(stats.size == 4);
+
+        const auto out = popAll(queue);
+        REQUIRE(out.size() == 4);
+        CHECK(out.front().id == 2);
+        CHECK(out.back().id == 5);
+    }
+
+    SECTION("ConflateByParam") {
+        SPMRQueue<ProcessEventRecord> queue(QueueOptions { 2, OverflowPolicy::ConflateByParam, 8 });
+        CHECK(queue.push(param(1, 0.1)));
+        CHECK(queue.push(param(2, 0.1)));
+        // Full, the latest value per param and type is kept.
+        CHECK(queue.push(param(1, 0.2)));
+        CHECK(queue.push(param(1, 0.3)));
+        CHECK(queue.push(param(1, 0.5, ClapEventParam_Type_Modulation)));
+        CHECK(!queue.push(note(7)));
+        CHECK(!queue.push(param(3, 0, ClapEventParam_Type_GestureBegin)));
+
+        auto stats = queue.stats();
+        CHECK(stats.pushed == 2);
+        CHECK(stats.conflated == 3);
+        CHECK(stats.dropped == 2);
+
+        // A param waiting in the table takes the later events too, even with room.
+        ProcessEventRecord rec;
+        REQUIRE(queue.pop(rec));
+        CHECK(rec.id == 1);
+        CHECK(rec.value == 0.1);
+        CHECK(queue.push(param(1, 0.4)));
+        CHECK(queue.push(param(4, 0.4)));
+        CHECK(queue.stats().conflated == 4);
+
+        // The conflated events keep their place, after the events queued before them.
+        const auto out = popAll(queue);
+        REQUIRE(out.size() == 4);
+        CHECK(out[0].id == 2);
+        double value = 0;
+        double modulation = 0;
+        for (std::size_t i = 1; i < 3; ++i) {
+            CHECK(out[i].id == 1);
+            (out[i].type == ClapEventParam_Type_Modulation ? modulation : value) = out[i].value;
+        }
+        CHECK(value == 0.4);
+        CHECK(modulation == 0.5);
+        CHECK(out[3].id == 4);
+        CHECK(!queue.pop(rec));
+    }
+
+    SECTION("ConflateByParam keeps gesture edges and notes after the values before them") {
+        SPMRQueue<ProcessEventRecord> queue(QueueOptions { 2, OverflowPolicy::ConflateByParam, 8 });
+        CHECK(queue.push(note(1)));
+        CHECK(queue.push(note(2)));
+        CHECK(queue.push(param(1, 0.5)));
+        ProcessEventRecord rec;
+        REQUIRE(queue.pop(rec));
+        CHECK(rec.kind == ProcessEventRecord::Kind::Note);
+        CHECK(rec.id == 1);
+
+        // Queued with room, but after the conflated value.
+        CHECK(queue.push(param(1, 0, ClapEventParam_Type_GestureEnd)));
+        // Full again, conflated behind the edge.
+        CHECK(queue.push(param(2, 0.7)));
+
+        const auto out = popAll(queue);
+        REQUIRE(out.size() == 4);
+        CHECK(out[0].kind == ProcessEventRecord::Kind::Note);
+        CHECK(out[0].id == 2);
+        CHECK(out[1].id == 1);
+        CHECK(out[1].type == ClapEventParam_Type_Value);
+        CHECK(out[1].value == 0.5);
+        CHECK(out[2].id == 1);
+        CHECK(out[2].type == ClapEventParam_Type_GestureEnd);
+        CHECK(out[3].id == 2);
+        CHECK(out[3].value == 0.7);
+        CHECK(!queue.pop(rec));
+    }
+
+    SECTION("ConflateByParam runs out of slots") {
+        SPMRQueue<ProcessEventRecord> queue(QueueOptions { 2, OverflowPolicy::ConflateByParam, 2 });
+        for (uint32_t i = 0; i < 6; ++i)
+            queue.push(param(i, 0));
+        const auto stats = queue.stats();
+        CHECK(stats.conflated == 2);
+        CHECK(stats.dropped == 2);
+        CHECK(popAll(queue).size() == 4);
+    }
+
+    SECTION("Main thread events can't be conflated") {
+        STATIC_REQUIRE(!MPMRQueue<ServerEventWrapper>::CanConflate);
+        STATIC_REQUIRE(SPMRQueue<ClientParamWrapper>::CanConflate);
+        MPMRQueue<ServerEventWrapper> queue(QueueOptions { 2, OverflowPolicy::ConflateByParam });
+        CHECK(queue.options().policy == OverflowPolicy::DropNewest);
+    }
+}
+
+TEST_CASE("ConflationTable")
+{
+    struct Value
+    {
+        std::uint64_t key;
+        std::uint64_t n;
+        std::uint64_t check; // Torn if it doesn't match n
+    };
+
+    SECTION("A pop never waits for a store, nor loses its value") {
+        constexpr std::uint64_t Keys = 4;
+        constexpr std::uint64_t Stores = 100'000;
+        ConflationTable<Value> table(8);
+        std::atomic<bool> done = false;
+        std::atomic<bool> refused = false;
+        std::array<std::uint64_t, Keys> last {};
+
+        auto producer = std::jthread([&] {
+            for (std::uint64_t n = 1; n <= Stores; ++n) {
+                const auto key = n % Keys;
+                if (!table.store(key, Value { key, n, ~n }))
+                    refused = true;
+            }
+            done = true;
+        });
+        const auto consume = [&] {
+            Value v {};
+            while (table.pop(v)) {
+                REQUIRE(v.check == ~v.n);
+                CHECK(v.n > last[v.key]);
+                last[v.key] = v.n;
+            }
+        };
+        while (!done)
+            consume();
+        producer.join();
+        consume();
+        CHECK(!refused);
+        for (std::uint64_t key = 0; key < Keys; ++key)
+            CHECK(last[key] == Stores - (Keys - key) % Keys);
+    }
+
+    SECTION("A store while a pop puts back an event that isn't due never hides it") {
+        constexpr std::uint64_t Rounds = 50'000;
+        ConflationTable<Value> table(8);
+        std::barrier sync(2);
+        int early = 0;
+        int lost = 0;
+
+        // Every round, key 0 is the only pending event and isn't due for the pops that race
+        // with the store of key 1. The floor is still the one of key 2, so the pops look at
+        // it. The barriers of the stores increase with the rounds.
+        auto producer = std::jthread([&] {
+            for (std::uint64_t r = 0; r < Rounds; ++r) {
+                sync.arrive_and_wait();
+                table.store(1, Value { 1, r, ~r }, 4 * r + 2);
+                sync.arrive_and_wait();
+            }
+        });
+        Value v {};
+        for (std::uint64_t r = 0; r < Rounds; ++r) {
+            while (table.pop(v)) {}
+            table.store(2, Value { 2, r, ~r }, 4 * r);
+            table.store(0, Value { 0, r, ~r }, 4 * r + 1);
+            REQUIRE(table.pop(v, 4 * r));
+            REQUIRE(v.key == 2);
+            sync.arrive_and_wait();
+            for (int n = 0; n < 16; ++n)
+                early += table.pop(v, 4 * r);
+            sync.arrive_and_wait();
+            if (!table.pop(v, 4 * r + 1) || v.key != 0)
+                ++lost;
+        }
+        producer.join();
+        CHECK(early == 0);
+        CHECK(lost == 0);
+    }
+}
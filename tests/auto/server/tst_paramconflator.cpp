@@ -0,0 +1,107 @@
+#include <server/paramconflator.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+
+using namespace RCLAP_NAMESPACE;
+
+namespace {
+
+ServerEventWrapper param(uint32_t id, ClapEventParam::Type type, double value = 0)
+{
+    ClapEventParamWrapper p;
+    p.type = type;
+    p.paramId = id;
+    (type == ClapEventParam_Type_Modulation ? p.modulation : p.value) = value;
+    return { Event::Param, std::move(p) };
+}
+
+struct Emitted
+{
+    uint32_t id;
+    ClapEventParam::Type type;
+    double value;
+};
+
+auto collect(std::vector<Emitted> &out)
+{
+    return [&out](const ServerEventWrapper &ev) {
+        const auto &p = std::get<ClapEventParamWrapper>(ev.data);
+        out.push_back({ p.paramId, p.type, p.type == ClapEventParam_Type_Modulation ? p.modulation : p.value });
+    };
+}
+
+constexpr uint64_t Ms = 1'000'000;
+
+} // namespace
+
+TEST_CASE("ParamConflator")
+{
+    std::vector<Emitted> out;
+
+    SECTION("Disabled by default")
+    {
+        ParamConflator c;
+        CHECK_FALSE(c.enabled());
+        CHECK(ParamConflator(0).intervalNs() == 0);
+        CHECK(ParamConflator(50).intervalNs() == 20 * Ms);
+    }
+
+    SECTION("Keeps the latest value per param and type")
+    {
+        ParamConflator c(100);
+        for (int i = 1; i <= 10; ++i) {
+            CHECK(c.update(param(2, ClapEventParam_Type_Value, i)));
+            CHECK(c.update(param(1, ClapEventParam_Type_Value, -i)));
+        }
+        CHECK(c.update(param(2, ClapEventParam_Type_Modulation, 0.5)));
+        CHECK(c.flushDue(100 * Ms, collect(out)));
+        REQUIRE(out.size() == 3);
+        // In the order they first changed.
+        CHECK((out[0].id == 2 && out[0].value == 10));
+        CHECK((out[1].id == 1 && out[1].value == -10));
+        CHECK((out[2].id == 2 && out[2].type == ClapEventParam_Type_Modulation && out[2].value == 0.5));
+        CHECK_FALSE(c.hasPending());
+    }
+
+    SECTION("Emits at most once per interval")
+    {
+        ParamConflator c(100);
+        c.update(param(1, ClapEventParam_Type_Value, 1));
+        CHECK(c.flushDue(100 * Ms, collect(out)));
+        c.update(param(1, ClapEventParam_Type_Value, 2));
+        CHECK(c.dueNs() == 110 * Ms);
+        CHECK_FALSE(c.flushDue(109 * Ms, collect(out)));
+        CHECK(c.flushDue(110 * Ms, collect(out)));
+        REQUIRE(out.size() == 2);
+        CHECK(out[1].value == 2);
+        // Nothing pending, nothing emitted.
+        CHECK_FALSE(c.flushDue(200 * Ms, collect(out)));
+    }
+
+    SECTION("Gesture edges aren't conflated")
+    {
+        ParamConflator c(100);
+        c.update(param(1, ClapEventParam_Type_Value, 1));
+        c.update(param(2, ClapEventParam_Type_Value, 2));
+        CHECK_FALSE(c.update(param(1, ClapEventParam_Type_GestureEnd)));
+        c.flushParam(1, collect(out));
+        REQUIRE(out.size() == 1);
+        CHECK(out[0].id == 1);
+        // Only the other param is left.
+        CHECK(c.flushDue(0, collect(out)));
+        REQUIRE(out.size() == 2);
+        CHECK(out[1].id == 2);
+    }
+
+    SECTION("Clear drops the pending values")
+    {
+        ParamConflator c(100);
+        c.update(param(1, ClapEventParam_Type_Value, 1));
+        c.clear();
+        CHECK_FALSE(c.hasPending());
+        CHECK_FALSE(c.flushDue(0, collect(out)));
+        CHECK(out.empty());
+    }
+}
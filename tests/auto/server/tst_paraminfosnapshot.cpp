@@ -0,0 +1,87 @@
+#include <server/paraminfosnapshot.h>
+
+#include <api.pb.h>
+#include <api.grpc.pb.h>
+#include <grpcpp/grpcpp.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdio>
+
+using namespace RCLAP_NAMESPACE;
+using namespace api::v0;
+
+namespace {
+
+clap_param_info makeInfo(uint32_t id, const char *module)
+{
+    clap_param_info info = {};
+    info.id = id;
+    std::snprintf(info.name, sizeof(info.name), "Param %u", id);
+    std::snprintf(info.module, sizeof(info.module), "%s", module);
+    info.min_value = -1.0;
+    info.max_value = 1.0;
+    info.default_value = 0.25;
+    info.flags = CLAP_PARAM_IS_AUTOMATABLE;
+    return info;
+}
+
+ParamInfos parse(const ParamInfoSnapshot &snapshot, uint32_t offset, uint32_t pageSize)
+{
+    auto buffer = snapshot.page(offset, pageSize);
+    ParamInfos infos;
+    REQUIRE(grpc::SerializationTraits<ParamInfos>::Deserialize(&buffer, &infos).ok());
+    return infos;
+}
+
+} // namespace
+
+TEST_CASE("ParamInfoSnapshot")
+{
+    ParamInfoSnapshot snapshot;
+    const char *modules[] = { "Osc", "Filter", "Osc", "Env", "Filter" };
+    for (uint32_t i = 0; i < 5; ++i)
+        snapshot.add(makeInfo(100 + i, modules[i]));
+
+    SECTION("Module names are interned")
+    {
+        CHECK(snapshot.size() == 5);
+        CHECK(snapshot.nModules() == 3);
+        const auto all = parse(snapshot, 0, 0);
+        REQUIRE(all.modules_size() == 3);
+        REQUIRE(all.params_size() == 5);
+        for (int i = 0; i < all.params_size(); ++i) {
+            const auto &p = all.params(i);
+            CHECK(p.param_id() == 100u + static_cast<uint32_t>(i));
+            CHECK(p.name() == "Param " + std::to_string(p.param_id()));
+            CHECK(all.modules(static_cast<int>(p.module())) == modules[i]);
+            CHECK(p.min_value() == -1.0);
+            CHECK(p.default_value() == 0.25);
+            CHECK(p.flags() == CLAP_PARAM_IS_AUTOMATABLE);
+        }
+        CHECK(all.total() == 5);
+        CHECK(all.next_offset() == 5);
+    }
+
+    SECTION("Pages")
+    {
+        uint32_t offset = 0;
+        uint32_t expectedId = 100;
+        int nPages = 0;
+        do {
+            const auto page = parse(snapshot, offset, 2);
+            CHECK(page.modules_size() == 3);
+            CHECK(page.total() == 5);
+            for (const auto &p : page.params())
+                CHECK(p.param_id() == expectedId++);
+            offset = page.next_offset();
+            ++nPages;
+        } while (offset < 5);
+        CHECK(nPages == 3);
+        CHECK(expectedId == 105);
+
+        const auto end = parse(snapshot, 5, 2);
+        CHECK(end.params_size() == 0);
+        CHECK(end.next_offset() == 5);
+    }
+}
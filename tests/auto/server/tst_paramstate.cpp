@@ -0,0 +1,76 @@
+#include <server/paramstate.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <thread>
+
+using namespace RCLAP_NAMESPACE;
+using namespace api::v0;
+
+TEST_CASE("ParamStateTable")
+{
+    ParamStateTable table;
+    std::vector<ParamState *> states;
+    for (uint32_t i = 0; i < ParamStateTable::ChunkSize + 3; ++i)
+        states.push_back(table.add(i * 10, 0.5));
+    REQUIRE(table.size() == ParamStateTable::ChunkSize + 3);
+    CHECK(table.version() == 0);
+
+    SECTION("A snapshot holds every param with its initial value")
+    {
+        ParamStates snapshot;
+        table.read(snapshot);
+        CHECK(snapshot.version() == 0);
+        REQUIRE(snapshot.param_ids_size() == static_cast<int>(table.size()));
+        CHECK(snapshot.param_ids(ParamStateTable::ChunkSize + 2) == (ParamStateTable::ChunkSize + 2) * 10);
+        CHECK(snapshot.values(1) == 0.5);
+        CHECK(snapshot.modulations(1) == 0.0);
+        CHECK(snapshot.versions(1) == 0);
+    }
+
+    SECTION("Every change takes the next version")
+    {
+        CHECK(table.setValue(*states[3], 0.75) == 1);
+        CHECK(table.setModulation(*states[ParamStateTable::ChunkSize], -0.25) == 2);
+        CHECK(table.setValue(*states[3], 1.0) == 3);
+        CHECK(table.version() == 3);
+
+        ParamStates changed;
+        table.read(changed, 1);
+        CHECK(changed.version() == 3);
+        REQUIRE(changed.param_ids_size() == 2);
+        CHECK(changed.param_ids(0) == 30);
+        CHECK(changed.values(0) == 1.0);
+        CHECK(changed.versions(0) == 3);
+        CHECK(changed.param_ids(1) == ParamStateTable::ChunkSize * 10);
+        CHECK(changed.modulations(1) == -0.25);
+        CHECK(changed.values(1) == 0.5);
+
+        ParamStates none;
+        table.read(none, 3);
+        CHECK(none.param_ids_size() == 0);
+    }
+
+    SECTION("Snapshots taken while a writer runs are never older than their versions")
+    {
+        std::atomic<bool> done = false;
+        std::jthread writer([&] {
+            for (int i = 1; i <= 20000; ++i)
+                table.setValue(*states[i % 4], static_cast<double>(i));
+            done = true;
+        });
+        uint64_t last = 0;
+        while (!done) {
+            ParamStates snapshot;
+            table.read(snapshot);
+            CHECK(snapshot.version() >= last);
+            last = snapshot.version();
+            for (int i = 0; i < 4; ++i) {
+                // Value i was written with version i, the value read is at least as new.
+                if (snapshot.versions(i) != 0)
+                    CHECK(snapshot.values(i) >= static_cast<double>(snapshot.versions(i)));
+            }
+        }
+    }
+}
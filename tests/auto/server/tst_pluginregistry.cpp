@@ -0,0 +1,87 @@
+#include <server/pluginregistry.h>
+#include <server/shareddata.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace RCLAP_NAMESPACE;
+
+namespace {
+
+// SharedData only stores the plugin, it's never called here.
+CorePlugin *fakePlugin(std::uint64_t id)
+{
+    return reinterpret_cast<CorePlugin *>(static_cast<std::uintptr_t>(id * 64));
+}
+
+bool add(PluginRegistry &registry, std::uint64_t hash)
+{
+    auto data = std::make_shared<SharedData>(fakePlugin(hash));
+    return registry.update([&](PluginRegistry::Table &table) {
+        return table.emplace(hash, std::move(data)).second;
+    });
+}
+
+bool remove(PluginRegistry &registry, std::uint64_t hash)
+{
+    return registry.update([&](PluginRegistry::Table &table) { return table.erase(hash) != 0; });
+}
+
+} // namespace
+
+TEST_CASE("PluginRegistry")
+{
+    PluginRegistry registry;
+    CHECK(registry.size() == 0);
+    CHECK(!registry.find(1));
+
+    SECTION("Updates are published as a whole")
+    {
+        CHECK(add(registry, 1));
+        CHECK(!add(registry, 1));
+        CHECK(registry.update([](PluginRegistry::Table &table) {
+            for (std::uint64_t hash = 2; hash <= 4; ++hash)
+                table.emplace(hash, std::make_shared<SharedData>(fakePlugin(hash)));
+            return table.size();
+        }) == 4);
+        CHECK(registry.size() == 4);
+        CHECK(registry.find(3));
+        CHECK(remove(registry, 3));
+        CHECK(!remove(registry, 3));
+        CHECK(!registry.find(3));
+
+        std::size_t visited = 0;
+        CHECK(registry.anyOf([&](std::uint64_t hash, const auto &) { ++visited; return hash == 4; }));
+        CHECK(visited >= 1);
+        CHECK(!registry.anyOf([](std::uint64_t hash, const auto &) { return hash == 3; }));
+    }
+
+    SECTION("Readers keep finding the stable instances while others come and go")
+    {
+        add(registry, 1);
+        const auto stable = registry.find(1);
+        std::atomic<bool> done = false;
+        std::atomic<std::uint64_t> misses = 0;
+        std::vector<std::jthread> readers;
+        for (int i = 0; i < 3; ++i) {
+            readers.emplace_back([&] {
+                while (!done) {
+                    if (registry.find(1) != stable)
+                        ++misses;
+                }
+            });
+        }
+        for (std::uint64_t hash = 2; hash < 500; ++hash) {
+            add(registry, hash);
+            if (hash % 2 == 0)
+                remove(registry, hash);
+        }
+        done = true;
+        readers.clear();
+        CHECK(misses == 0);
+        CHECK(registry.size() == 250);
+    }
+}
@@ -2,6 +2,8 @@
 
 #include <catch2/catch_test_macros.hpp>
 
+#include <filesystem>
+
 using namespace RCLAP_NAMESPACE;
 
 TEST_CASE("Server Test") {
@@ -33,4 +35,30 @@ TEST_CASE("Server Test") {
         REQUIRE(*server.address() == "localhost:5056");
         REQUIRE(server.stop());
     }
+#if !defined _WIN32 && !defined _WIN64
+    SECTION("Unix Domain Socket") {
+        const auto path = (std::filesystem::temp_directory_path() / "tst_server.sock").string();
+        Server server("", path);
+        CHECK(!server.unixAddress());
+        REQUIRE(server.start());
+        REQUIRE(*server.unixAddress() == "unix:" + path);
+        REQUIRE(std::filesystem::exists(path));
+        REQUIRE(!server.port());
+        REQUIRE(!server.address());
+        REQUIRE(server.stop());
+        REQUIRE(!std::filesystem::exists(path));
+    }
+    SECTION("TCP and Unix Domain Socket") {
+        const auto path = (std::filesystem::temp_directory_path() / "tst_server_tcp.sock").string();
+        Server server("localhost:0", path);
+        REQUIRE(server.start());
+        REQUIRE(server.port());
+        REQUIRE(server.unixAddress());
+        REQUIRE(server.stop());
+    }
+#endif
+    SECTION("No Listener") {
+        Server server("");
+        REQUIRE(!server.start());
+    }
 }
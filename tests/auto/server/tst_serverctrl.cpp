@@ -1,6 +1,8 @@
 #include <core/logging.h>
 #include <core/timestamp.h>
 #include <plugin/coreplugin.h>
+#include <server/cqeventhandler.h>
+#include <server/server.h>
 #include <server/serverctrl.h>
 #include <server/tags/servereventstream.h>
 
@@ -97,6 +99,30 @@ public:
         return true;
     }
 
+    // Streams more params than the queue holds, and cancels while the rest waits for room.
+    void cancelledParamStream(uint32_t nparams)
+    {
+        grpc::ClientContext ctx;
+        ctx.AddMetadata(Metadata::PluginHashId.data(), std::to_string(hash));
+        None response;
+        auto writer = stub->ClientParamStream(&ctx, &response);
+
+        ClientParams request;
+        for (uint32_t i = 0; i < nparams; ++i) {
+            auto *p = request.add_params();
+            p->set_event(Event::Param);
+            p->mutable_param()->set_param_id(0);
+            p->mutable_param()->set_value(static_cast<double>(i));
+            auto s = Timestamp::stamp();
+            p->mutable_timestamp()->set_seconds(s.seconds());
+            p->mutable_timestamp()->set_nanos(s.nanos());
+        }
+        writer->Write(request);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        ctx.TryCancel();
+        writer->Finish();
+    }
+
     bool serverEventStream(std::uint32_t max, std::latch &hostLatch)
     {
         grpc::ClientContext ctx;
@@ -118,6 +144,27 @@ public:
         return true;
     }
 
+    // Conflates the params to \a rateHz and stamps the arrival of the first note.
+    bool conflatingStream(std::uint32_t rateHz, std::latch &hostLatch, std::chrono::steady_clock::time_point &noteAt)
+    {
+        grpc::ClientContext ctx;
+        ctx.AddMetadata(Metadata::PluginHashId.data(), std::to_string(hash));
+
+        ClientRequest request;
+        request.set_max_param_rate_hz(rateHz);
+        ServerEvents response;
+        auto stream = stub->ServerEventStream(&ctx, request);
+
+        hostLatch.count_down();
+        while (stream->Read(&response)) {
+            for (const auto &ev : response.events()) {
+                if (ev.event() == Event::Note && noteAt == std::chrono::steady_clock::time_point {})
+                    noteAt = std::chrono::steady_clock::now();
+            }
+        }
+        return stream->Finish().ok();
+    }
+
 private:
     std::unique_ptr<ClapInterface::Stub> stub;
     std::uint64_t hash;
@@ -193,6 +240,43 @@ TEST_CASE("Client Tags")
         REQUIRE(ServerCtrl::instance().removePlugin(*idHash));
     }
 
+    SECTION("ClientEventCall doesn't block ClientParamCall")
+    {
+        CorePlugin cp(&desc, &host);
+        const auto idHash = ServerCtrl::instance().addPlugin(&cp);
+        REQUIRE(idHash);
+        auto sd = ServerCtrl::instance().getSharedData(*idHash);
+
+        const auto channel = grpc::CreateChannel(*ServerCtrl::instance().address(), grpc::InsecureChannelCredentials());
+        TestClient gui(channel, *idHash);
+        TestClient client(channel, *idHash);
+
+        // The GUI acknowledges GuiCreate, but the main thread is slow to verify it.
+        auto g = std::jthread([&]() { REQUIRE(gui.clientEventCall(1)); });
+        gui.latch.count_down();
+        while (sd->nPendingClientEvents() == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        // Parameter calls on the same queue keep flowing meanwhile.
+        const uint32_t iter = 20;
+        auto c = std::jthread([&]() { REQUIRE(client.clientParamCall(iter, 1)); });
+        client.latch.count_down();
+        ClientParamWrapper ce;
+        for (uint32_t i = 0; i < iter;) {
+            if (sd->clientsToPluginQueue().pop(ce))
+                ++i;
+            else
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        c.join();
+        CHECK(sd->nPendingClientEvents() == 1);
+
+        REQUIRE(sd->blockingVerifyEvent(EvTstData[0]));
+        g.join();
+        CHECK(sd->nPendingClientEvents() == 0);
+        REQUIRE(ServerCtrl::instance().removePlugin(*idHash));
+    }
+
     SECTION("ClientParamCall") {
         REQUIRE(ServerCtrl::instance().isRunning());
         CHECK(ServerCtrl::instance().nPlugins() == 0);
@@ -236,6 +320,32 @@ TEST_CASE("Client Tags")
         REQUIRE(ServerCtrl::instance().removePlugin(*idHash));
     }
 
+    SECTION("ClientParamStream stops retrying once the client is gone") {
+        CorePlugin cp(&desc, &host);
+        const auto idHash = ServerCtrl::instance().addPlugin(&cp);
+        REQUIRE(idHash);
+        auto activeHandlers = [] {
+            std::size_t n = 0;
+            for (const auto &cq : *ServerCtrl::instance().server()->cqHandles())
+                n += cq->activeHandlers();
+            return n;
+        };
+        TestClient client(grpc::CreateChannel(
+            *ServerCtrl::instance().address(),
+            grpc::InsecureChannelCredentials()),
+            *idHash
+        );
+
+        // Nothing drains the queue, the stream retries the rest of the batch until the
+        // client is gone. Then its handler is recycled.
+        const auto before = activeHandlers();
+        client.cancelledParamStream(256);
+        for (int i = 0; i < 100 && activeHandlers() != before; ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        CHECK(activeHandlers() == before);
+        REQUIRE(ServerCtrl::instance().removePlugin(*idHash));
+    }
+
     SECTION("ServerEventStream") {
         // this thread
         CorePlugin cp(&desc, &host);
@@ -267,11 +377,11 @@ TEST_CASE("Client Tags")
 
         for (uint32_t  n = 0; n < iter; ++n) {
             for (uint32_t i = 0; i < 16; ++i) {
-                sd->pluginToClientsQueue().push({Event::Note, ClapEventNoteWrapper({}) });
-                sd->pluginToClientsQueue().push({Event::Param, ClapEventParamWrapper() });
-                sd->pluginToClientsQueue().push({Event::ParamInfo, ClapEventParamInfoWrapper() });
-                sd->pluginToClientsQueue().push({Event::GuiSetTransient, ClapEventMainSyncWrapper() });
-                sd->pluginToClientsQueue().push({Event::GuiShow, ClapEventMainSyncWrapper() });
+                sd->pluginToClientsQueue().push(ClapEventNoteWrapper({}));
+                sd->pluginToClientsQueue().push(ClapEventParamWrapper());
+                sd->pluginMainToClientsQueue().push({Event::ParamInfo, ClapEventParamInfoWrapper() });
+                sd->pluginMainToClientsQueue().push({Event::GuiSetTransient, ClapEventMainSyncWrapper() });
+                sd->pluginMainToClientsQueue().push({Event::GuiShow, ClapEventMainSyncWrapper() });
             }
         }
         std::this_thread::sleep_for(std::chrono::milliseconds(50));
@@ -280,4 +390,42 @@ TEST_CASE("Client Tags")
 
         REQUIRE(ServerCtrl::instance().removePlugin(*idHash));
     }
+
+    SECTION("Conflated params don't delay other events") {
+        CorePlugin cp(&desc, &host);
+        const auto idHash = ServerCtrl::instance().addPlugin(&cp);
+        REQUIRE(idHash);
+        auto sd = ServerCtrl::instance().getSharedData(*idHash);
+        REQUIRE(sd->setPollMode(SharedData::PollMode::Wakeup));
+
+        TestClient client(grpc::CreateChannel(
+            *ServerCtrl::instance().address(),
+            grpc::InsecureChannelCredentials()),
+            *idHash
+        );
+        std::latch hostLatch(1);
+        std::chrono::steady_clock::time_point noteAt {};
+        auto c = std::jthread([&]() { REQUIRE(client.conflatingStream(1, hostLatch, noteAt)); });
+        hostLatch.wait();
+        while (sd->nStreams() <= 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        // The first value goes out, the second one is held for a second.
+        sd->pluginToClientsQueue().push(ClapEventParamWrapper());
+        sd->pluginToClientsQueue().push(ClapEventParamWrapper());
+        sd->notify();
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        // The poller waits for the conflated value, a note must not wait with it.
+        const auto pushedAt = std::chrono::steady_clock::now();
+        sd->pluginToClientsQueue().push(ClapEventNoteWrapper({}));
+        sd->notify();
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        sd->stopPoll();
+        c.join();
+
+        REQUIRE(noteAt != std::chrono::steady_clock::time_point {});
+        CHECK(noteAt - pushedAt < std::chrono::milliseconds(250));
+        REQUIRE(ServerCtrl::instance().removePlugin(*idHash));
+    }
 }
@@ -0,0 +1,100 @@
+#include <server/sessiontable.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <set>
+
+using namespace RCLAP_NAMESPACE;
+
+TEST_CASE("SessionTable")
+{
+    SessionTable sessions(4);
+    CHECK(sessions.capacity() == 4);
+    CHECK(sessions.size() == 0);
+    CHECK(!sessions.resolve(0));
+
+    SECTION("Open and resolve") {
+        const auto a = sessions.open(11);
+        const auto b = sessions.open(22);
+        REQUIRE(a);
+        REQUIRE(b);
+        CHECK(*a != *b);
+        CHECK(sessions.size() == 2);
+        CHECK(sessions.resolve(*a) == 11);
+        CHECK(sessions.resolve(*b) == 22);
+        // Garbage ids never resolve.
+        CHECK(!sessions.resolve(~std::uint64_t(0)));
+        CHECK(!sessions.resolve(static_cast<std::uint32_t>(*a)));
+    }
+
+    SECTION("A closed id stays closed when its slot is reused") {
+        const auto a = sessions.open(11);
+        REQUIRE(a);
+        CHECK(sessions.close(*a));
+        CHECK(!sessions.close(*a));
+        CHECK(!sessions.resolve(*a));
+        CHECK(sessions.size() == 0);
+
+        const auto b = sessions.open(22);
+        REQUIRE(b);
+        CHECK(static_cast<std::uint32_t>(*b) == static_cast<std::uint32_t>(*a));
+        CHECK(*b != *a);
+        CHECK(!sessions.resolve(*a));
+        CHECK(!sessions.close(*a));
+        CHECK(sessions.resolve(*b) == 22);
+    }
+
+    SECTION("Capacity") {
+        std::set<std::uint64_t> ids;
+        for (std::uint32_t i = 0; i < sessions.capacity(); ++i) {
+            const auto id = sessions.open(i);
+            REQUIRE(id);
+            ids.insert(*id);
+        }
+        CHECK(ids.size() == sessions.capacity());
+        CHECK(!sessions.open(99));
+        CHECK(sessions.close(*ids.begin()));
+        CHECK(sessions.open(99));
+    }
+
+    SECTION("Closing the sessions of a plugin") {
+        const auto a = sessions.open(11);
+        const auto b = sessions.open(22);
+        const auto c = sessions.open(11);
+        CHECK(sessions.closeAll(11) == 2);
+        CHECK(sessions.closeAll(11) == 0);
+        CHECK(!sessions.resolve(*a));
+        CHECK(!sessions.resolve(*c));
+        CHECK(sessions.resolve(*b) == 22);
+        CHECK(sessions.size() == 1);
+    }
+
+    SECTION("A session closes with the last bound stream") {
+        const auto a = sessions.open(11);
+        REQUIRE(a);
+        CHECK(sessions.bindStream(*a));
+        CHECK(sessions.bindStream(*a));
+        CHECK(!sessions.unbindStream(*a));
+        CHECK(sessions.resolve(*a) == 11);
+        CHECK(sessions.unbindStream(*a));
+        CHECK(!sessions.resolve(*a));
+        CHECK(sessions.size() == 0);
+        CHECK(!sessions.bindStream(*a));
+        CHECK(!sessions.unbindStream(*a));
+    }
+
+    SECTION("Unbinding doesn't close a reopened slot") {
+        const auto a = sessions.open(11);
+        REQUIRE(a);
+        CHECK(sessions.bindStream(*a));
+        CHECK(sessions.close(*a));
+        const auto b = sessions.open(22);
+        REQUIRE(b);
+        CHECK(static_cast<std::uint32_t>(*b) == static_cast<std::uint32_t>(*a));
+        CHECK(!sessions.unbindStream(*a));
+        CHECK(sessions.resolve(*b) == 22);
+        // Nothing was bound to the new session.
+        CHECK(!sessions.unbindStream(*b));
+        CHECK(sessions.resolve(*b) == 22);
+    }
+}
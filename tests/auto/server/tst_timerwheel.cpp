@@ -0,0 +1,146 @@
+#include <server/timerwheel.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <random>
+#include <vector>
+
+using namespace RCLAP_NAMESPACE;
+
+namespace {
+
+// Advances the wheel tick by tick and returns the ticks at which \a fired changed.
+std::vector<std::uint64_t> run(TimerWheel &wheel, std::uint64_t until, std::vector<int> &fired)
+{
+    std::vector<TimerWheel::Fn> expired;
+    std::vector<std::uint64_t> ticks;
+    for (auto now = wheel.now() + 1; now <= until; ++now) {
+        wheel.advance(now, expired);
+        for (auto &fn : expired) {
+            fn(true);
+            ticks.push_back(now);
+        }
+        expired.clear();
+    }
+    return ticks;
+}
+
+} // namespace
+
+TEST_CASE("TimerWheel") {
+    std::vector<TimerWheel::Fn> expired;
+
+    SECTION("Fires on expiry") {
+        TimerWheel wheel(4, 1000);
+        std::vector<int> fired;
+        for (const std::uint64_t defer : { 1, 63, 64, 65, 4095, 4096, 300'000 })
+            wheel.add([&fired, defer](bool ok) { REQUIRE(ok); fired.push_back(static_cast<int>(defer)); }, 1000 + defer);
+        REQUIRE(wheel.size() == 7);
+        REQUIRE(wheel.capacity() >= 7);
+
+        const auto ticks = run(wheel, 1000 + 300'000, fired);
+        REQUIRE(fired == std::vector<int>{ 1, 63, 64, 65, 4095, 4096, 300'000 });
+        REQUIRE(ticks == std::vector<std::uint64_t>{ 1001, 1063, 1064, 1065, 5095, 5096, 301'000 });
+        REQUIRE(wheel.empty());
+        REQUIRE(!wheel.nextExpiry());
+    }
+    SECTION("Expired timers fire on the next tick") {
+        TimerWheel wheel(16, 50);
+        bool fired = false;
+        wheel.add([&fired](bool) { fired = true; }, 10);
+        REQUIRE(*wheel.nextExpiry() == 51);
+        wheel.advance(51, expired);
+        REQUIRE(expired.size() == 1);
+        expired.front()(true);
+        REQUIRE(fired);
+    }
+    SECTION("Cancel") {
+        TimerWheel wheel;
+        bool fired = false;
+        const auto id = wheel.add([&fired](bool) { fired = true; }, 100);
+        const auto other = wheel.add([](bool) {}, 100);
+        REQUIRE(id != TimerWheel::InvalidId);
+        REQUIRE(wheel.cancel(id));
+        REQUIRE(!wheel.cancel(id));
+        REQUIRE(!wheel.cancel(TimerWheel::InvalidId));
+        REQUIRE(wheel.size() == 1);
+
+        // The slot is reused, the stale id must not cancel the new timer.
+        const auto reused = wheel.add([](bool) {}, 200);
+        REQUIRE(static_cast<std::uint32_t>(reused) == static_cast<std::uint32_t>(id));
+        REQUIRE(!wheel.cancel(id));
+
+        wheel.advance(1000, expired);
+        REQUIRE(expired.size() == 2);
+        REQUIRE(!fired);
+        REQUIRE(!wheel.cancel(other));
+    }
+    SECTION("Next expiry") {
+        TimerWheel wheel(16, 0);
+        wheel.add([](bool) {}, 10);
+        REQUIRE(*wheel.nextExpiry() == 10);
+        wheel.add([](bool) {}, 5);
+        REQUIRE(*wheel.nextExpiry() == 5);
+        // Higher levels report the time of their next cascade, which is never late.
+        TimerWheel far(16, 0);
+        far.add([](bool) {}, 1000);
+        REQUIRE(*far.nextExpiry() <= 1000);
+    }
+    SECTION("Beyond the range of the wheel") {
+        TimerWheel wheel(16, 7);
+        const std::uint64_t expiry = 7 + (std::uint64_t(1) << 30);
+        wheel.add([](bool) {}, expiry);
+        std::uint64_t now = wheel.now();
+        while (!wheel.empty()) {
+            const auto next = *wheel.nextExpiry();
+            REQUIRE(next > now);
+            REQUIRE(next <= expiry);
+            now = next;
+            wheel.advance(now, expired);
+        }
+        REQUIRE(now == expiry);
+        REQUIRE(expired.size() == 1);
+    }
+    SECTION("Random") {
+        // Driving the wheel by nextExpiry() must fire every timer exactly at its expiry.
+        std::mt19937_64 rng(42);
+        TimerWheel wheel(8, 123);
+        std::vector<std::uint64_t> expiries;
+        std::vector<std::uint64_t> firedAt;
+        std::uint64_t now = wheel.now();
+        std::vector<TimerWheel::Id> ids;
+        for (int i = 0; i < 2000; ++i) {
+            const auto expiry = wheel.now() + 1 + rng() % 100'000;
+            ids.push_back(wheel.add([&firedAt, &now, expiry](bool) {
+                REQUIRE(now == expiry);
+                firedAt.push_back(expiry);
+            }, expiry));
+            expiries.push_back(expiry);
+        }
+        std::size_t cancelled = 0;
+        for (std::size_t i = 0; i < ids.size(); i += 7)
+            cancelled += wheel.cancel(ids[i]) ? 1 : 0;
+        REQUIRE(wheel.size() == ids.size() - cancelled);
+
+        while (auto next = wheel.nextExpiry()) {
+            REQUIRE(*next > now);
+            now = *next;
+            wheel.advance(now, expired);
+            for (auto &fn : expired)
+                fn(true);
+            expired.clear();
+        }
+        REQUIRE(firedAt.size() == ids.size() - cancelled);
+    }
+    SECTION("Clear") {
+        TimerWheel wheel;
+        int nCalls = 0;
+        for (int i = 0; i < 100; ++i)
+            wheel.add([&nCalls](bool ok) { REQUIRE(!ok); ++nCalls; }, static_cast<std::uint64_t>(i * 1000));
+        wheel.clear(expired);
+        REQUIRE(wheel.empty());
+        for (auto &fn : expired)
+            fn(false);
+        REQUIRE(nCalls == 100);
+    }
+}
@@ -24,20 +24,19 @@ static clap_event_note HostEvent = {
    .velocity = 0.5
 };
 
-static ServerEventWrapper TestEvent = {
-    Event::Note, ClapEventNoteWrapper(&HostEvent, CLAP_EVENT_NOTE_ON )
-};
+static const ProcessEventRecord TestEvent = ClapEventNoteWrapper(&HostEvent, CLAP_EVENT_NOTE_ON);
 
 int main(int argc, char *argv[])
 {
-    if (argc != 3) {
-        std::cerr << "Usage: " << argv[0] << " <iterations> <evs/call>" << std::endl;
+    if (argc != 3 && argc != 4) {
+        std::cerr << "Usage: " << argv[0] << " <iterations> <evs/call> [events|packed|shm]" << std::endl;
         return 1;
     }
     uint64_t iterations = std::stoull(argv[1]);
     uint64_t eventsPerIteration = std::stoull(argv[2]);
     std::cout << "Iterations: " << iterations << std::endl;
     std::cout << "Evs/Call: " << eventsPerIteration << std::endl;
+    const std::string encoding = argc == 4 ? argv[3] : "events";
 
 
     Log::setupLogger("");
@@ -48,36 +47,60 @@ int main(int argc, char *argv[])
 
     auto clockedEvent = [&](){
         crill::progressive_backoff_wait([&] {
-            ServerEventWrapper clock({ Event::Param, ClapEventParamWrapper() });
-            clock.ts = Timestamp::stamp();
+            ProcessEventRecord clock = ClapEventParamWrapper();
+            clock.time.timeNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
             return sharedData->pluginToClientsQueue().push(std::move(clock));
         });
     };
 
-    // Start Client
-    const auto address = *ServerCtrl::instance().address();
-    ProcessHandle child("clients/client-cpp", { std::to_string(idHash), address });
+    // Runs the client once against the given address. With shm, the process events go
+    // through the shared memory ring and only the control events through the stream.
+    auto runClient = [&](std::string_view transport, const std::string &address) {
+        std::cout << "####### Transport: " << transport << " (" << address << ") #########" << std::endl;
+        ProcessHandle child("clients/client-cpp", { std::to_string(idHash), address, encoding });
+        if (encoding == "shm") {
+            if (!sharedData->createShmRing(1 << 22)) {
+                std::cerr << "Shared memory ring not available" << std::endl;
+                return;
+            }
+            const auto *ring = sharedData->shmRing();
+            child.inheritFd(ring->memFd());
+            child.inheritFd(ring->eventFd());
+            child.setArguments({ std::to_string(idHash), address, "events", ring->fdArgument() });
+        }
 
-    SPDLOG_INFO("Begin Benchmarks");
+        SPDLOG_INFO("Begin Benchmarks");
 
-    child.startChild();
-    while (sharedData->nStreams() <= 0) ; // Busy wait for client to connect
-    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        child.startChild();
+        while (sharedData->nStreams() <= 0) ; // Busy wait for client to connect
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
 
-    clockedEvent();
-    std::this_thread::sleep_for(std::chrono::milliseconds(1));
-    for (uint64_t i = 0; i < iterations; ++i) {
-        for (uint64_t k = 0; k < eventsPerIteration; ++k) {
-            while (!sharedData->pluginToClientsQueue().push(ServerEventWrapper(TestEvent))) ;
+        clockedEvent();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        for (uint64_t i = 0; i < iterations; ++i) {
+            for (uint64_t k = 0; k < eventsPerIteration; ++k) {
+                while (!sharedData->pluginToClientsQueue().push(ProcessEventRecord(TestEvent))) ;
+            }
         }
-    }
-    clockedEvent();
+        clockedEvent();
 
-    std::this_thread::sleep_for(std::chrono::milliseconds(700));
-    SPDLOG_INFO("End Benchmarks");
-    sharedData->endStreams();
+        std::this_thread::sleep_for(std::chrono::milliseconds(700));
+        SPDLOG_INFO("End Benchmarks");
+        sharedData->endStreams();
+
+        child.waitForChild();
+        if (encoding == "shm")
+            std::cout << "Dropped ring batches: " << sharedData->shmDroppedBatches() << std::endl;
+        while (sharedData->nStreams() != 0 || sharedData->isPolling())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    };
 
-    child.waitForChild();
+    // Loopback TCP and the unix domain socket side by side.
+    if (const auto tcp = ServerCtrl::instance().tcpAddress())
+        runClient("TCP loopback", *tcp);
+    if (const auto uds = ServerCtrl::instance().unixAddress())
+        runClient("Unix domain socket", *uds);
 
     return 0;
 }
@@ -0,0 +1,143 @@
+#include <server/eventencoder.h>
+#include <server/paramconflator.h>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <vector>
+
+using namespace RCLAP_NAMESPACE;
+
+namespace {
+
+// Automation on every param in every block: 48kHz with 64 frames per block.
+constexpr uint32_t NumParams = 128;
+constexpr uint64_t BlockNs = 1'000'000'000ull * 64 / 48'000;
+constexpr uint64_t NumBlocks = 750; // One second
+constexpr uint64_t GestureEvery = 75;
+
+std::vector<ServerEventWrapper> makeBlock(uint64_t block)
+{
+    std::vector<ServerEventWrapper> evs;
+    const auto edge = [&](ClapEventParam::Type type) {
+        ClapEventParamWrapper g;
+        g.type = type;
+        evs.emplace_back(Event::Param, std::move(g));
+        evs.back().time = { block, block * BlockNs };
+    };
+    if (block % GestureEvery == 0)
+        edge(ClapEventParam_Type_GestureBegin);
+    for (uint32_t id = 0; id < NumParams; ++id) {
+        ClapEventParamWrapper p;
+        p.paramId = id;
+        p.value = static_cast<double>(block % 100) / 100.0;
+        p.frameOffset = id % 64;
+        evs.emplace_back(Event::Param, std::move(p));
+        evs.back().time = { block, block * BlockNs };
+    }
+    if (block % GestureEvery == GestureEvery - 1)
+        edge(ClapEventParam_Type_GestureEnd);
+    return evs;
+}
+
+// The outbound queue of a ServerEventStream: a single write in flight, the batches that
+// queue up meanwhile are concatenated into the next one, beyond 64 they are dropped.
+struct Client
+{
+    explicit Client(uint64_t writeNs) : writeNs(writeNs) {}
+
+    void send(uint64_t nowNs, std::size_t size)
+    {
+        if (nowNs >= writeDoneNs && !queue.empty()) {
+            queue.clear();
+            writeDoneNs = nowNs + writeNs;
+        }
+        if (queue.size() == 64) {
+            ++dropped;
+            return;
+        }
+        bytes += size;
+        queue.push_back(size);
+    }
+
+    uint64_t writeNs;
+    uint64_t writeDoneNs = 0;
+    std::deque<std::size_t> queue;
+    uint64_t bytes = 0;
+    uint64_t dropped = 0;
+};
+
+struct Result
+{
+    uint64_t bytes = 0;
+    uint64_t batches = 0;
+    uint64_t gestures = 0;
+    uint64_t dropped = 0;
+};
+
+// Runs one second of poll rounds, one per block, for a client with the given rate limit.
+Result run(const std::vector<std::vector<ServerEventWrapper>> &blocks, uint32_t maxRateHz, uint64_t writeNs)
+{
+    Result res;
+    ParamConflator conflator(maxRateHz);
+    EventEncoder encoder;
+    Client client(writeNs);
+    const auto add = [&](const ServerEventWrapper &ev) {
+        const auto &p = std::get<ClapEventParamWrapper>(ev.data);
+        res.gestures += p.type == ClapEventParam_Type_GestureBegin || p.type == ClapEventParam_Type_GestureEnd;
+        encoder.add(ev);
+    };
+    for (uint64_t b = 0; b < blocks.size(); ++b) {
+        const auto now = b * BlockNs;
+        for (const auto &ev : blocks[b]) {
+            if (conflator.enabled()) {
+                if (conflator.update(ev))
+                    continue;
+                conflator.flushParam(std::get<ClapEventParamWrapper>(ev.data).paramId, add);
+            }
+            add(ev);
+        }
+        conflator.flushDue(now, add);
+        if (encoder.empty())
+            continue;
+        ++res.batches;
+        client.send(now, encoder.bytes().size());
+        encoder.clear();
+    }
+    res.bytes = client.bytes;
+    res.dropped = client.dropped;
+    return res;
+}
+
+} // namespace
+
+// Bytes per second a client receives with automation-heavy input, and the batches its
+// outbound queue drops while a write is stalled.
+TEST_CASE("Param conflation")
+{
+    std::vector<std::vector<ServerEventWrapper>> blocks;
+    for (uint64_t b = 1; b <= NumBlocks; ++b)
+        blocks.push_back(makeBlock(b));
+
+    for (const auto writeMs : { 1u, 100u, 250u }) {
+        for (const auto rate : { 0u, 60u, 30u }) {
+            const auto res = run(blocks, rate, writeMs * 1'000'000ull);
+            std::cout << "max_param_rate_hz " << rate << ", write " << writeMs << "ms: "
+                      << res.bytes << " bytes/s, " << res.batches << " batches/s, "
+                      << res.dropped << " dropped, " << res.gestures << " gesture edges" << std::endl;
+        }
+    }
+
+    BENCHMARK("Encode all events")
+    {
+        return run(blocks, 0, 0).bytes;
+    };
+
+    BENCHMARK("Conflate and encode, 60Hz")
+    {
+        return run(blocks, 60, 0).bytes;
+    };
+}
@@ -0,0 +1,124 @@
+#include <server/eventencoder.h>
+
+#include <api.pb.h>
+#include <api.grpc.pb.h>
+#include <grpcpp/grpcpp.h>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include <vector>
+
+using namespace RCLAP_NAMESPACE;
+
+namespace {
+
+std::vector<ServerEventWrapper> noteHeavy(int nEvents)
+{
+    std::vector<ServerEventWrapper> evs;
+    for (int i = 0; i < nEvents; ++i) {
+        ClapEventNoteWrapper n;
+        n.noteId = i;
+        n.channel = i % 16;
+        n.key = 36 + i % 48;
+        n.value = 0.8;
+        n.type = i % 2 ? ClapEventNote_Type_NoteOff : ClapEventNote_Type_NoteOn;
+        evs.emplace_back(Event::Note, std::move(n));
+    }
+    return evs;
+}
+
+std::vector<ServerEventWrapper> paramHeavy(int nEvents)
+{
+    std::vector<ServerEventWrapper> evs;
+    for (int i = 0; i < nEvents; ++i) {
+        ClapEventParamWrapper p;
+        p.type = i % 4 ? ClapEventParam_Type_Value : ClapEventParam_Type_Modulation;
+        p.paramId = static_cast<uint32_t>(i * 7);
+        p.value = 0.01 * i;
+        p.modulation = i % 4 ? 0.0 : 0.25;
+        evs.emplace_back(Event::Param, std::move(p));
+    }
+    return evs;
+}
+
+// The former poll round: build the message tree, then serialize it.
+grpc::ByteBuffer viaProtobuf(ServerEvents &msg, const std::vector<ServerEventWrapper> &evs)
+{
+    msg.Clear();
+    for (const auto &w : evs) {
+        auto *next = msg.add_events();
+        next->set_event(w.ev);
+        std::visit([&](auto &&arg) {
+            using T = std::decay_t<decltype(arg)>;
+            if constexpr (std::is_same_v<T, ClapEventNoteWrapper>) {
+                next->mutable_note()->set_note_id(arg.noteId);
+                next->mutable_note()->set_port_index(arg.portIndex);
+                next->mutable_note()->set_channel(arg.channel);
+                next->mutable_note()->set_key(arg.key);
+                next->mutable_note()->set_value(arg.value);
+                next->mutable_note()->set_type(arg.getType());
+                next->mutable_note()->set_expression(arg.getExpressionType());
+            } else if constexpr (std::is_same_v<T, ClapEventParamWrapper>) {
+                next->mutable_param()->set_type(arg.type);
+                next->mutable_param()->set_param_id(arg.paramId);
+                next->mutable_param()->set_value(arg.value);
+                next->mutable_param()->set_modulation(arg.modulation);
+            }
+        }, w.data);
+    }
+    grpc::ByteBuffer bb;
+    bool own = false;
+    grpc::SerializationTraits<ServerEvents>::Serialize(msg, &bb, &own);
+    return bb;
+}
+
+grpc::ByteBuffer viaEncoder(EventEncoder &encoder, const std::vector<ServerEventWrapper> &evs)
+{
+    encoder.clear();
+    for (const auto &w : evs)
+        encoder.add(w);
+    return encoder.toByteBuffer();
+}
+
+grpc::ByteBuffer viaPackedEncoder(PackedEventEncoder &encoder, const std::vector<ServerEventWrapper> &evs)
+{
+    encoder.clear();
+    for (const auto &w : evs)
+        encoder.add(w);
+    return encoder.toByteBuffer();
+}
+
+} // namespace
+
+// Work done on the stream completion queue thread per poll round, from the
+// popped wrappers to the buffer handed to the streams.
+TEST_CASE("Encoder")
+{
+    ServerEvents msg;
+    EventEncoder encoder;
+    PackedEventEncoder packedEncoder;
+    for (const int nEvents : { 8, 64, 512 }) {
+        const auto notes = noteHeavy(nEvents);
+        const auto params = paramHeavy(nEvents);
+
+        BENCHMARK("Protobuf, note-heavy, events: " + std::to_string(nEvents)) {
+            return viaProtobuf(msg, notes).Length();
+        };
+        BENCHMARK("EventEncoder, note-heavy, events: " + std::to_string(nEvents)) {
+            return viaEncoder(encoder, notes).Length();
+        };
+        BENCHMARK("PackedEventEncoder, note-heavy, events: " + std::to_string(nEvents)) {
+            return viaPackedEncoder(packedEncoder, notes).Length();
+        };
+        BENCHMARK("Protobuf, param-heavy, events: " + std::to_string(nEvents)) {
+            return viaProtobuf(msg, params).Length();
+        };
+        BENCHMARK("EventEncoder, param-heavy, events: " + std::to_string(nEvents)) {
+            return viaEncoder(encoder, params).Length();
+        };
+        BENCHMARK("PackedEventEncoder, param-heavy, events: " + std::to_string(nEvents)) {
+            return viaPackedEncoder(packedEncoder, params).Length();
+        };
+    }
+}
@@ -0,0 +1,64 @@
+#include <core/global.h>
+
+#include <api.pb.h>
+#include <api.grpc.pb.h>
+#include <grpcpp/grpcpp.h>
+#include <grpcpp/support/byte_buffer.h>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace api::v0;
+
+namespace {
+
+ServerEvents makeBatch(int nEvents)
+{
+    ServerEvents evs;
+    for (int i = 0; i < nEvents; ++i) {
+        auto *ev = evs.add_events();
+        if (i % 2) {
+            ev->set_event(Event::Param);
+            ev->mutable_param()->set_param_id(static_cast<uint32_t>(i));
+            ev->mutable_param()->set_value(0.5 * i);
+        } else {
+            ev->set_event(Event::Note);
+            ev->mutable_note()->set_note_id(i);
+            ev->mutable_note()->set_key(60 + i % 12);
+            ev->mutable_note()->set_value(0.8);
+        }
+    }
+    return evs;
+}
+
+} // namespace
+
+// Compares the encoding work done on the stream completion queue thread per
+// poll round: protobuf serialization for every client (the ServerAsyncWriter<ServerEvents>
+// path) against a single serialization that is shared as grpc::ByteBuffer.
+TEST_CASE("Fan-out")
+{
+    const auto batch = makeBatch(64);
+    for (const int nClients : { 1, 3, 8, 32 }) {
+        std::vector<grpc::ByteBuffer> out(static_cast<std::size_t>(nClients));
+
+        BENCHMARK("Serialize per client, clients: " + std::to_string(nClients)) {
+            bool own = false;
+            for (auto &bb : out)
+                grpc::SerializationTraits<ServerEvents>::Serialize(batch, &bb, &own);
+            return out.back().Length();
+        };
+
+        BENCHMARK("Serialize once, clients: " + std::to_string(nClients)) {
+            bool own = false;
+            grpc::ByteBuffer encoded;
+            grpc::SerializationTraits<ServerEvents>::Serialize(batch, &encoded, &own);
+            for (auto &bb : out)
+                bb = encoded;
+            return out.back().Length();
+        };
+    }
+}
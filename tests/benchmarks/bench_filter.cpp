@@ -0,0 +1,79 @@
+#include <server/eventencoder.h>
+#include <server/eventfilter.h>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include <iostream>
+#include <vector>
+
+using namespace RCLAP_NAMESPACE;
+
+namespace {
+
+// A busy block: mostly notes, with automation on 64 params.
+std::vector<ServerEventWrapper> makeBatch(int nEvents)
+{
+    std::vector<ServerEventWrapper> evs;
+    for (int i = 0; i < nEvents; ++i) {
+        if (i % 4 == 0) {
+            ClapEventParamWrapper p;
+            p.paramId = static_cast<uint32_t>(i / 4 % 64);
+            p.value = 0.5;
+            p.frameOffset = static_cast<uint32_t>(i);
+            evs.emplace_back(Event::Param, std::move(p));
+        } else {
+            ClapEventNoteWrapper n;
+            n.noteId = i;
+            n.channel = i % 16;
+            n.key = 60 + i % 12;
+            n.value = 0.8;
+            n.frameOffset = static_cast<uint32_t>(i);
+            evs.emplace_back(Event::Note, std::move(n));
+        }
+    }
+    return evs;
+}
+
+} // namespace
+
+// The work done per poll round for a single client, and the bytes it receives: the full
+// batch against a meter view that subscribed to two params.
+TEST_CASE("Subscription filter")
+{
+    const auto batch = makeBatch(256);
+    Subscription meter;
+    meter.add_events(Event::Param);
+    auto *range = meter.add_params();
+    range->set_first(10);
+    range->set_last(11);
+    const EventFilter filter(meter);
+
+    EventEncoder all;
+    EventEncoder filtered;
+    for (const auto &ev : batch) {
+        all.add(ev);
+        if (filter.accepts(ev))
+            filtered.add(ev);
+    }
+    std::cout << "Bytes/round, all events: " << all.bytes().size() << ", filtered: " << filtered.bytes().size()
+              << " (" << filtered.count() << " of " << batch.size() << " events)" << std::endl;
+
+    BENCHMARK("Encode all events")
+    {
+        all.clear();
+        for (const auto &ev : batch)
+            all.add(ev);
+        return all.bytes().size();
+    };
+
+    BENCHMARK("Filter and encode")
+    {
+        filtered.clear();
+        for (const auto &ev : batch) {
+            if (filter.accepts(ev))
+                filtered.add(ev);
+        }
+        return filtered.bytes().size();
+    };
+}
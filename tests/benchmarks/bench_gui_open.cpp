@@ -0,0 +1,125 @@
+#include <core/logging.h>
+#include <plugin/coreplugin.h>
+#include <server/serverctrl.h>
+#include <server/shareddata.h>
+#include <crill/progressive_backoff_wait.h>
+
+#include <grpcpp/grpcpp.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Window-open latency: from launching the GUI until its GuiCreate acknowledgement was
+// verified on the main thread. The GUI is a thread standing in for the child process.
+// Compares the readiness wait against the former fixed sleep and isPolling() spin.
+using namespace RCLAP_NAMESPACE;
+using Clock = std::chrono::steady_clock;
+const clap_plugin_descriptor Desc = {};
+clap_host Host;
+
+namespace {
+
+// Connects the event stream and acknowledges GuiCreate, like the GUI process does.
+void runGui(const std::string &address, std::uint64_t hash)
+{
+    auto stub = ClapInterface::NewStub(grpc::CreateChannel(address, grpc::InsecureChannelCredentials()));
+    grpc::ClientContext ctx;
+    ctx.AddMetadata(Metadata::PluginHashId.data(), std::to_string(hash));
+    auto stream = stub->ServerEventStream(&ctx, ClientRequest());
+    ServerEvents evs;
+    while (stream->Read(&evs)) {
+        for (const auto &ev : evs.events()) {
+            if (ev.event() != Event::GuiCreate)
+                continue;
+            grpc::ClientContext ackCtx;
+            ackCtx.AddMetadata(Metadata::PluginHashId.data(), std::to_string(hash));
+            ClientEvent ack;
+            ack.set_event(Event::GuiCreate);
+            None none;
+            stub->ClientEventCall(&ackCtx, ack, &none);
+        }
+    }
+    stream->Finish();
+}
+
+void report(const char *name, std::vector<double> &latencies, std::uint32_t failed)
+{
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << "####### " << name << " (" << latencies.size() << " opened, " << failed << " failed) #########" << std::endl;
+    if (latencies.empty())
+        return;
+    std::cout << "Window-open p50: " << latencies[latencies.size() / 2] << "ms, max: " << latencies.back() << "ms" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const std::uint32_t iterations = argc > 1 ? static_cast<std::uint32_t>(std::stoul(argv[1])) : 50;
+    const std::uint32_t legacyIterations = argc > 2 ? static_cast<std::uint32_t>(std::stoul(argv[2])) : 5;
+    if (iterations == 0) {
+        std::cerr << "Usage: " << argv[0] << " [iterations] [iterations with the fixed sleep]" << std::endl;
+        return 1;
+    }
+
+    Log::setupLogger("");
+    spdlog::set_level(spdlog::level::warn);
+    CorePlugin cp(&Desc, &Host);
+    const auto idHash = *ServerCtrl::instance().addPlugin(&cp);
+    auto sharedData = ServerCtrl::instance().getSharedData(idHash);
+    ServerCtrl::instance().start();
+    const auto address = *ServerCtrl::instance().address();
+
+    // Returns the latency in ms, or a negative value on failure.
+    auto open = [&](bool fixedSleep) {
+        const auto begin = Clock::now();
+        const auto generation = sharedData->streamGeneration();
+        std::jthread gui(runGui, address, idHash);
+        bool ready = true;
+        if (fixedSleep) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            crill::progressive_backoff_wait([&] { return sharedData->isPolling(); });
+        } else {
+            ready = sharedData->waitForStream(generation, ServerCtrl::instance().getInitTimeout());
+        }
+        if (ready) {
+            crill::progressive_backoff_wait([&] {
+                if (!sharedData->pluginMainToClientsQueue().push({ Event::GuiCreate, ClapEventMainSyncWrapper{} }))
+                    return false;
+                sharedData->notify();
+                return true;
+            });
+            ready = sharedData->blockingVerifyEvent(Event::GuiCreate);
+        }
+        const std::chrono::duration<double, std::milli> elapsed = Clock::now() - begin;
+
+        // Close the window before the next launch.
+        sharedData->endStreams();
+        gui.join();
+        while (sharedData->nStreams() != 0 || sharedData->isPolling())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return ready ? elapsed.count() : -1.0;
+    };
+
+    auto run = [&](const char *name, std::uint32_t n, bool fixedSleep) {
+        std::vector<double> latencies;
+        std::uint32_t failed = 0;
+        for (std::uint32_t i = 0; i < n; ++i) {
+            if (const auto ms = open(fixedSleep); ms >= 0)
+                latencies.push_back(ms);
+            else
+                ++failed;
+        }
+        report(name, latencies, failed);
+    };
+
+    run("Readiness wait", iterations, false);
+    run("Fixed sleep", legacyIterations, true);
+
+    ServerCtrl::instance().stop();
+    ServerCtrl::instance().removePlugin(idHash);
+    return 0;
+}
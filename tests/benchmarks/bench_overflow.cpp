@@ -0,0 +1,114 @@
+#include <server/eventqueue.h>
+#include <server/shareddata.h>
+#include <server/wrappers.h>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include <farbot/fifo.hpp>
+
+#include <iostream>
+#include <vector>
+
+// A block of the audio thread with more events than the process queue holds: automation
+// of 16 params and a few notes. Measures the push side per policy against the bare fifo,
+// and what reaches the poller when it drains once per block.
+using namespace RCLAP_NAMESPACE;
+
+namespace {
+
+constexpr std::uint32_t Capacity = 64;
+constexpr std::size_t BlockSize = 256;
+constexpr std::size_t Blocks = 1000;
+
+using RawFifo = farbot::fifo<ProcessEventRecord,
+    farbot::fifo_options::concurrency::multiple,
+    farbot::fifo_options::concurrency::single,
+    farbot::fifo_options::full_empty_failure_mode::return_false_on_full_or_empty,
+    farbot::fifo_options::full_empty_failure_mode::return_false_on_full_or_empty>;
+
+std::vector<ProcessEventRecord> makeBlock()
+{
+    std::vector<ProcessEventRecord> block;
+    block.reserve(BlockSize);
+    for (std::size_t i = 0; i < BlockSize; ++i) {
+        if (i % 16 == 0) {
+            ClapEventNoteWrapper n;
+            n.noteId = static_cast<int32_t>(i);
+            block.emplace_back(n);
+        } else {
+            ClapEventParamWrapper p;
+            p.paramId = static_cast<uint32_t>(i % 16);
+            p.value = 0.001 * static_cast<double>(i);
+            block.emplace_back(p);
+        }
+    }
+    return block;
+}
+
+template <typename Queue>
+std::size_t pushBlock(Queue &queue, const std::vector<ProcessEventRecord> &block)
+{
+    std::size_t n = 0;
+    for (auto ev : block)
+        n += queue.push(std::move(ev));
+    return n;
+}
+
+template <typename Queue>
+std::size_t drain(Queue &queue)
+{
+    std::size_t n = 0;
+    ProcessEventRecord rec;
+    while (queue.pop(rec))
+        ++n;
+    return n;
+}
+
+const char *name(OverflowPolicy policy)
+{
+    switch (policy) {
+    case OverflowPolicy::DropNewest: return "DropNewest";
+    case OverflowPolicy::OverwriteOldest: return "OverwriteOldest";
+    case OverflowPolicy::ConflateByParam: return "ConflateByParam";
+    }
+    return "";
+}
+
+} // namespace
+
+TEST_CASE("Overflowing process queue")
+{
+    const auto block = makeBlock();
+    constexpr OverflowPolicy Policies[] = { OverflowPolicy::DropNewest, OverflowPolicy::OverwriteOldest,
+                                            OverflowPolicy::ConflateByParam };
+
+    for (const auto policy : Policies) {
+        SPMRQueue<ProcessEventRecord> queue(QueueOptions { Capacity, policy });
+        std::size_t delivered = 0;
+        for (std::size_t i = 0; i < Blocks; ++i) {
+            pushBlock(queue, block);
+            delivered += drain(queue);
+        }
+        const auto stats = queue.stats();
+        std::cout << name(policy) << ": " << delivered / Blocks << " of " << BlockSize
+                  << " events per block delivered, dropped " << stats.dropped / Blocks
+                  << ", conflated " << stats.conflated / Blocks << ", high water " << stats.highWater << std::endl;
+    }
+
+    RawFifo fifo(Capacity);
+    BENCHMARK("farbot::fifo, block of 256")
+    {
+        std::size_t n = 0;
+        for (auto ev : block)
+            n += fifo.push(std::move(ev));
+        return n + drain(fifo);
+    };
+    for (const auto policy : Policies) {
+        SPMRQueue<ProcessEventRecord> queue(QueueOptions { Capacity, policy });
+        BENCHMARK(std::string(name(policy)) + ", block of 256")
+        {
+            return pushBlock(queue, block) + drain(queue);
+        };
+    }
+}
@@ -0,0 +1,136 @@
+#include <core/logging.h>
+#include <plugin/coreplugin.h>
+#include <server/paraminfosnapshot.h>
+#include <server/serverctrl.h>
+#include <server/shareddata.h>
+#include <crill/progressive_backoff_wait.h>
+
+#include <grpcpp/grpcpp.h>
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+// The param infos a GUI needs before it can draw, against the parameter count. Compares
+// the GetParamInfos snapshot against the former ParamInfo events, which the main thread
+// pushed one by one through the 64 slot main queue. The GUI is a thread standing in for
+// the child process.
+using namespace RCLAP_NAMESPACE;
+using Clock = std::chrono::steady_clock;
+using Ms = std::chrono::duration<double, std::milli>;
+const clap_plugin_descriptor Desc = {};
+clap_host Host;
+
+namespace {
+
+clap_param_info makeInfo(std::uint32_t id)
+{
+    clap_param_info info = {};
+    info.id = id;
+    std::snprintf(info.name, sizeof(info.name), "Param %u", id);
+    std::snprintf(info.module, sizeof(info.module), "Voice/Oscillator %u", id % 8);
+    info.max_value = 1.0;
+    info.default_value = 0.5;
+    return info;
+}
+
+std::uint32_t fetchPages(ClapInterface::Stub &stub, std::uint64_t hash, std::uint32_t pageSize)
+{
+    ParamInfoRequest request;
+    request.set_page_size(pageSize);
+    std::uint32_t received = 0;
+    ParamInfos page;
+    do {
+        grpc::ClientContext ctx;
+        ctx.AddMetadata(Metadata::PluginHashId.data(), std::to_string(hash));
+        if (!stub.GetParamInfos(&ctx, request, &page).ok())
+            return received;
+        received += static_cast<std::uint32_t>(page.params_size());
+        request.set_offset(page.next_offset());
+    } while (page.next_offset() < page.total());
+    return received;
+}
+
+// Reads the stream until \a count ParamInfo events arrived.
+void readParamInfoEvents(const std::string &address, std::uint64_t hash, std::uint32_t count,
+                         Clock::time_point &done)
+{
+    auto stub = ClapInterface::NewStub(grpc::CreateChannel(address, grpc::InsecureChannelCredentials()));
+    grpc::ClientContext ctx;
+    ctx.AddMetadata(Metadata::PluginHashId.data(), std::to_string(hash));
+    auto stream = stub->ServerEventStream(&ctx, ClientRequest());
+    ServerEvents evs;
+    std::uint32_t received = 0;
+    while (received < count && stream->Read(&evs)) {
+        for (const auto &ev : evs.events())
+            received += ev.event() == Event::ParamInfo;
+    }
+    done = Clock::now();
+    ctx.TryCancel();
+    stream->Finish();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const std::uint32_t pageSize = argc > 1 ? static_cast<std::uint32_t>(std::stoul(argv[1])) : 500;
+
+    Log::setupLogger("");
+    spdlog::set_level(spdlog::level::warn);
+    CorePlugin cp(&Desc, &Host);
+    const auto idHash = *ServerCtrl::instance().addPlugin(&cp);
+    auto sharedData = ServerCtrl::instance().getSharedData(idHash);
+    ServerCtrl::instance().start();
+    const auto address = *ServerCtrl::instance().address();
+    auto stub = ClapInterface::NewStub(grpc::CreateChannel(address, grpc::InsecureChannelCredentials()));
+
+    for (const std::uint32_t nParams : { 100u, 500u, 2000u, 10000u }) {
+        ParamInfoSnapshot builder;
+        for (std::uint32_t id = 0; id < nParams; ++id)
+            builder.add(makeInfo(id));
+
+        // GetParamInfos: the main thread only publishes a copy of the snapshot.
+        auto begin = Clock::now();
+        sharedData->setParamInfos(std::make_shared<const ParamInfoSnapshot>(builder));
+        const Ms publish = Clock::now() - begin;
+        const auto received = fetchPages(*stub, idHash, pageSize);
+        const Ms snapshot = Clock::now() - begin;
+
+        // ParamInfo events: the main thread is blocked until the last one is queued.
+        Clock::time_point done;
+        const auto generation = sharedData->streamGeneration();
+        std::jthread gui(readParamInfoEvents, address, idHash, nParams, std::ref(done));
+        sharedData->waitForStream(generation, ServerCtrl::instance().getInitTimeout());
+        begin = Clock::now();
+        for (std::uint32_t id = 0; id < nParams; ++id) {
+            const auto info = makeInfo(id);
+            crill::progressive_backoff_wait([&] {
+                if (!sharedData->pluginMainToClientsQueue().push({ Event::ParamInfo, ClapEventParamInfoWrapper {
+                        .paramId = info.id, .name = info.name, .module = info.module,
+                        .minValue = info.min_value, .maxValue = info.max_value, .defaultValue = info.default_value } }))
+                    return false;
+                sharedData->notify();
+                return true;
+            });
+        }
+        const Ms blocked = Clock::now() - begin;
+        gui.join();
+        const Ms events = done - begin;
+        while (sharedData->nStreams() != 0 || sharedData->isPolling())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        std::cout << "####### " << nParams << " params, " << builder.nModules() << " modules, "
+                  << builder.bytes() << " bytes #########" << std::endl;
+        std::cout << "GetParamInfos: " << received << " received in " << snapshot.count()
+                  << "ms, main thread " << publish.count() << "ms" << std::endl;
+        std::cout << "ParamInfo events: received in " << events.count()
+                  << "ms, main thread " << blocked.count() << "ms" << std::endl;
+    }
+
+    ServerCtrl::instance().stop();
+    ServerCtrl::instance().removePlugin(idHash);
+    return 0;
+}
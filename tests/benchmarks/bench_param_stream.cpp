@@ -0,0 +1,143 @@
+#include <core/logging.h>
+#include <plugin/coreplugin.h>
+#include <server/serverctrl.h>
+#include <server/shareddata.h>
+
+#include <grpcpp/grpcpp.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Compares parameter updates sent as one unary ClientParamCall each against a
+// single long-lived ClientParamStream. The latency is measured from the client
+// sending an update until it is popped from the queue of the audio thread.
+using namespace RCLAP_NAMESPACE;
+using Clock = std::chrono::steady_clock;
+const clap_plugin_descriptor Desc = {};
+clap_host Host;
+
+namespace {
+
+struct Run
+{
+    std::vector<Clock::time_point> sent;
+    std::vector<Clock::time_point> received;
+};
+
+void setParam(ClientParam *param, std::uint32_t i)
+{
+    param->set_event(Event::Param);
+    // The param id carries the index of the update, so the consumer can match it.
+    param->mutable_param()->set_param_id(i);
+    param->mutable_param()->set_value(0.5);
+    param->mutable_timestamp()->set_seconds(static_cast<std::int64_t>(i / 1'000'000'000) + 1);
+    param->mutable_timestamp()->set_nanos(static_cast<std::int32_t>(i % 1'000'000'000));
+}
+
+void report(const char *name, Run &run, std::uint32_t updates, std::uint32_t offset)
+{
+    std::vector<double> latencies;
+    latencies.reserve(updates);
+    for (std::uint32_t i = offset; i < offset + updates; ++i) {
+        if (run.received[i] != Clock::time_point{})
+            latencies.push_back(std::chrono::duration<double, std::micro>(run.received[i] - run.sent[i]).count());
+    }
+    std::sort(latencies.begin(), latencies.end());
+    const std::chrono::duration<double> elapsed = run.received[offset + updates - 1] - run.sent[offset];
+    const auto percentile = [&](double p) {
+        return latencies.empty() ? 0.0 : latencies[static_cast<std::size_t>(p * (latencies.size() - 1))];
+    };
+
+    std::cout << "####### " << name << " (" << updates << " updates, " << latencies.size() << " received) #########" << std::endl;
+    std::cout << "Updates/s: " << latencies.size() / elapsed.count() << std::endl;
+    std::cout << "Latency p50: " << percentile(0.5) << "us, p99: " << percentile(0.99) << "us" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const std::uint32_t updates = argc > 1 ? static_cast<std::uint32_t>(std::stoul(argv[1])) : 20'000;
+    const std::uint32_t batchSize = argc > 2 ? static_cast<std::uint32_t>(std::stoul(argv[2])) : 1;
+    if (updates == 0 || batchSize == 0) {
+        std::cerr << "Usage: " << argv[0] << " [updates] [params per stream message]" << std::endl;
+        return 1;
+    }
+
+    Log::setupLogger("");
+    spdlog::set_level(spdlog::level::warn);
+    CorePlugin cp(&Desc, &Host);
+    const auto idHash = *ServerCtrl::instance().addPlugin(&cp);
+    auto sharedData = ServerCtrl::instance().getSharedData(idHash);
+    ServerCtrl::instance().start();
+
+    // Both runs share the index space, the stamps of a plugin have to keep increasing.
+    const std::uint32_t total = 2 * updates;
+    Run run { std::vector<Clock::time_point>(total), std::vector<Clock::time_point>(total) };
+
+    // Stands in for the audio thread.
+    std::atomic<bool> running = true;
+    std::jthread consumer([&] {
+        ClientParamWrapper p;
+        while (running) {
+            while (sharedData->clientsToPluginQueue().pop(p)) {
+                if (p.paramId < total)
+                    run.received[p.paramId] = Clock::now();
+            }
+            std::this_thread::yield();
+        }
+    });
+
+    auto stub = ClapInterface::NewStub(grpc::CreateChannel(
+        *ServerCtrl::instance().address(), grpc::InsecureChannelCredentials()
+    ));
+
+    // Unary: one call per update.
+    ClientParams params;
+    auto *param = params.add_params();
+    for (std::uint32_t i = 0; i < updates; ++i) {
+        setParam(param, i);
+        grpc::ClientContext ctx;
+        ctx.AddMetadata(Metadata::PluginHashId.data(), std::to_string(idHash));
+        None none;
+        run.sent[i] = Clock::now();
+        stub->ClientParamCall(&ctx, params, &none);
+    }
+
+    // Stream: authenticated once, batchSize updates per message.
+    {
+        grpc::ClientContext ctx;
+        ctx.AddMetadata(Metadata::PluginHashId.data(), std::to_string(idHash));
+        None none;
+        auto writer = stub->ClientParamStream(&ctx, &none);
+        for (std::uint32_t i = updates; i < total;) {
+            params.Clear();
+            const auto now = Clock::now();
+            for (std::uint32_t j = 0; j < batchSize && i < total; ++j, ++i) {
+                setParam(params.add_params(), i);
+                run.sent[i] = now;
+            }
+            if (!writer->Write(params))
+                break;
+        }
+        writer->WritesDone();
+        if (const auto status = writer->Finish(); !status.ok())
+            std::cerr << "ClientParamStream failed: " << status.error_message() << std::endl;
+    }
+
+    // Give the consumer a moment to drain the queue.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    running = false;
+    consumer.join();
+
+    report("ClientParamCall", run, updates, 0);
+    report("ClientParamStream", run, updates, updates);
+
+    ServerCtrl::instance().stop();
+    ServerCtrl::instance().removePlugin(idHash);
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include <core/logging.h>
+#include <plugin/coreplugin.h>
+#include <server/serverctrl.h>
+#include <server/shareddata.h>
+
+#include <grpcpp/grpcpp.h>
+#include <sys/resource.h>
+
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace RCLAP_NAMESPACE;
+const clap_plugin_descriptor Desc = {};
+clap_host Host;
+
+namespace {
+
+// User + system time spent by this process.
+std::int64_t cpuTimeNs()
+{
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    auto toNs = [](const timeval &tv) {
+        return static_cast<std::int64_t>(tv.tv_sec) * 1'000'000'000 + static_cast<std::int64_t>(tv.tv_usec) * 1'000;
+    };
+    return toNs(usage.ru_utime) + toNs(usage.ru_stime);
+}
+
+struct Instance
+{
+    std::unique_ptr<CorePlugin> plugin;
+    std::uint64_t hash = 0;
+    std::shared_ptr<SharedData> sharedData;
+    std::unique_ptr<grpc::ClientContext> ctx;
+    std::jthread reader;
+};
+
+struct Result
+{
+    double idleCpu = 0;    // fraction of a core
+    double activeCpu = 0;  // while a few instances receive events
+    double sweepsPerSec = 0;
+};
+
+// Measures what polling costs while all instances are idle, and while only every
+// 16th instance sends an event per millisecond.
+Result run(SharedData::PollMode mode, std::size_t nInstances, std::chrono::milliseconds duration)
+{
+    Result res;
+    std::vector<std::unique_ptr<Instance>> instances;
+    for (std::size_t i = 0; i < nInstances; ++i) {
+        auto inst = std::make_unique<Instance>();
+        inst->plugin = std::make_unique<CorePlugin>(&Desc, &Host);
+        inst->hash = *ServerCtrl::instance().addPlugin(inst->plugin.get());
+        inst->sharedData = ServerCtrl::instance().getSharedData(inst->hash);
+        inst->sharedData->setPollMode(mode);
+        instances.push_back(std::move(inst));
+    }
+
+    auto stub = ClapInterface::NewStub(grpc::CreateChannel(
+        *ServerCtrl::instance().address(), grpc::InsecureChannelCredentials()
+    ));
+    for (auto &inst : instances) {
+        inst->ctx = std::make_unique<grpc::ClientContext>();
+        inst->ctx->AddMetadata(Metadata::PluginHashId.data(), std::to_string(inst->hash));
+        inst->reader = std::jthread([&stub, i = inst.get()] {
+            ServerEvents evs;
+            auto stream = stub->ServerEventStream(i->ctx.get(), ClientRequest());
+            while (stream->Read(&evs))
+                ;
+            stream->Finish();
+        });
+    }
+    for (auto &inst : instances) {
+        while (inst->sharedData->nStreams() == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    auto *poller = ServerCtrl::instance().server()->getPoller(instances.front()->hash);
+    const auto seconds = std::chrono::duration<double>(duration).count();
+    auto measure = [&](auto &&load) {
+        const auto cpuBegin = cpuTimeNs();
+        const auto sweepsBegin = poller->sweeps();
+        const auto end = std::chrono::steady_clock::now() + duration;
+        while (std::chrono::steady_clock::now() < end)
+            load();
+        const auto cpu = static_cast<double>(cpuTimeNs() - cpuBegin) / (seconds * 1e9);
+        res.sweepsPerSec = static_cast<double>(poller->sweeps() - sweepsBegin) / seconds;
+        return cpu;
+    };
+
+    // Let the backoff settle into its idle state first.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    res.idleCpu = measure([] { std::this_thread::sleep_for(std::chrono::milliseconds(10)); });
+    res.activeCpu = measure([&] {
+        for (std::size_t i = 0; i < instances.size(); i += 16) {
+            if (instances[i]->sharedData->pluginToClientsQueue().push(ClapEventParamWrapper()))
+                instances[i]->sharedData->notify();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+
+    for (auto &inst : instances)
+        inst->sharedData->stopPoll();
+    for (auto &inst : instances) {
+        inst->reader.join();
+        ServerCtrl::instance().removePlugin(inst->hash);
+    }
+    return res;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const std::uint32_t durationMs = argc > 1 ? static_cast<std::uint32_t>(std::stoul(argv[1])) : 2000;
+    if (durationMs == 0) {
+        std::cerr << "Usage: " << argv[0] << " [duration-ms]" << std::endl;
+        return 1;
+    }
+
+    Log::setupLogger("");
+    spdlog::set_level(spdlog::level::warn);
+    ServerCtrl::instance().start();
+
+    std::cout << "####### Poller CPU use by instances (" << durationMs << "ms per measurement) #########" << std::endl;
+    for (const auto mode : { SharedData::PollMode::Backoff, SharedData::PollMode::Wakeup }) {
+        for (const std::size_t nInstances : { 1, 16, 128 }) {
+            const auto r = run(mode, nInstances, std::chrono::milliseconds(durationMs));
+            std::cout << (mode == SharedData::PollMode::Backoff ? "Backoff" : "Wakeup ")
+                      << "\t instances: " << nInstances
+                      << "\t idle cpu: " << r.idleCpu * 100.0 << "%"
+                      << "\t active cpu: " << r.activeCpu * 100.0 << "%"
+                      << "\t sweeps/s: " << r.sweepsPerSec << std::endl;
+        }
+    }
+
+    ServerCtrl::instance().stop();
+    return 0;
+}
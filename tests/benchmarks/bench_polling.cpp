@@ -0,0 +1,141 @@
+#include <core/logging.h>
+#include <core/timestamp.h>
+#include <plugin/coreplugin.h>
+#include <server/serverctrl.h>
+#include <server/shareddata.h>
+
+#include <grpcpp/grpcpp.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace RCLAP_NAMESPACE;
+const clap_plugin_descriptor Desc = {};
+clap_host Host;
+
+namespace {
+
+std::int64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+// User + system time spent by this process.
+std::int64_t cpuTimeNs()
+{
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    auto toNs = [](const timeval &tv) {
+        return static_cast<std::int64_t>(tv.tv_sec) * 1'000'000'000 + static_cast<std::int64_t>(tv.tv_usec) * 1'000;
+    };
+    return toNs(usage.ru_utime) + toNs(usage.ru_stime);
+}
+
+struct Result
+{
+    double idleCpu = 0;     // fraction of a core
+    std::int64_t p50Ns = 0; // first event -> client read
+    std::int64_t p99Ns = 0;
+};
+
+Result run(SharedData::PollMode mode, std::uint32_t iterations, std::uint32_t idleMs)
+{
+    Result res;
+    CorePlugin cp(&Desc, &Host);
+    const auto idHash = *ServerCtrl::instance().addPlugin(&cp);
+    auto sharedData = ServerCtrl::instance().getSharedData(idHash);
+    sharedData->setPollMode(mode);
+
+    std::vector<std::int64_t> pushed(iterations);
+    std::vector<std::int64_t> received(iterations);
+    std::atomic<std::uint32_t> nReceived = 0;
+
+    auto stub = ClapInterface::NewStub(grpc::CreateChannel(
+        *ServerCtrl::instance().address(), grpc::InsecureChannelCredentials()
+    ));
+    grpc::ClientContext ctx;
+    ctx.AddMetadata(Metadata::PluginHashId.data(), std::to_string(idHash));
+    auto reader = std::jthread([&] {
+        ServerEvents evs;
+        auto stream = stub->ServerEventStream(&ctx, ClientRequest());
+        while (stream->Read(&evs)) {
+            const auto t = nowNs();
+            for (const auto &ev : evs.events()) {
+                received[ev.param().param_id()] = t;
+                ++nReceived;
+            }
+        }
+        stream->Finish();
+    });
+
+    while (sharedData->nStreams() == 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    // Let the poller settle into its idle state, then measure what idling costs.
+    std::this_thread::sleep_for(std::chrono::milliseconds(idleMs));
+    const auto cpuBegin = cpuTimeNs();
+    const auto wallBegin = nowNs();
+    std::this_thread::sleep_for(std::chrono::milliseconds(idleMs));
+    res.idleCpu = static_cast<double>(cpuTimeNs() - cpuBegin) / static_cast<double>(nowNs() - wallBegin);
+
+    // Single events after a quiet phase. This is the worst case for the backoff.
+    for (std::uint32_t i = 0; i < iterations; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        ProcessEventRecord ev = ClapEventParamWrapper();
+        ev.id = i;
+        pushed[i] = nowNs();
+        while (!sharedData->pluginToClientsQueue().push(std::move(ev)))
+            ;
+        sharedData->notify();
+        while (nReceived.load() <= i)
+            std::this_thread::yield();
+    }
+
+    sharedData->stopPoll();
+    reader.join();
+    ServerCtrl::instance().removePlugin(idHash);
+
+    std::vector<std::int64_t> latencies(iterations);
+    for (std::uint32_t i = 0; i < iterations; ++i)
+        latencies[i] = received[i] - pushed[i];
+    std::sort(latencies.begin(), latencies.end());
+    res.p50Ns = latencies[iterations / 2];
+    res.p99Ns = latencies[std::min<std::size_t>(iterations - 1, iterations * 99 / 100)];
+    return res;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const std::uint32_t iterations = argc > 1 ? static_cast<std::uint32_t>(std::stoul(argv[1])) : 500;
+    const std::uint32_t idleMs = argc > 2 ? static_cast<std::uint32_t>(std::stoul(argv[2])) : 2000;
+    if (iterations == 0) {
+        std::cerr << "Usage: " << argv[0] << " [iterations] [idle-ms]" << std::endl;
+        return 1;
+    }
+
+    Log::setupLogger("");
+    spdlog::set_level(spdlog::level::warn);
+    ServerCtrl::instance().start();
+
+    const auto backoff = run(SharedData::PollMode::Backoff, iterations, idleMs);
+    const auto wakeup = run(SharedData::PollMode::Wakeup, iterations, idleMs);
+
+    auto print = [](std::string_view name, const Result &r) {
+        std::cout << name << "\t idle cpu: " << r.idleCpu * 100.0 << "%"
+                  << "\t p50: " << static_cast<double>(r.p50Ns) / 1e3 << "us"
+                  << "\t p99: " << static_cast<double>(r.p99Ns) / 1e3 << "us" << std::endl;
+    };
+    std::cout << "####### Poll modes, first event -> client read (" << iterations << " iterations) #########" << std::endl;
+    print("Backoff", backoff);
+    print("Wakeup ", wakeup);
+
+    ServerCtrl::instance().stop();
+    return 0;
+}
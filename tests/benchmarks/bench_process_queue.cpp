@@ -0,0 +1,101 @@
+#include <server/shareddata.h>
+#include <server/wrappers.h>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include <deque>
+#include <iostream>
+#include <vector>
+
+using namespace RCLAP_NAMESPACE;
+
+namespace {
+
+constexpr std::size_t Capacity = 64;
+
+// A full block of what processEvent() sees, half notes and half param values.
+std::vector<clap_event_note> makeNotes()
+{
+    std::vector<clap_event_note> notes(Capacity / 2);
+    for (std::size_t i = 0; i < notes.size(); ++i) {
+        auto &n = notes[i];
+        n.header = { sizeof(n), static_cast<uint32_t>(i), CLAP_CORE_EVENT_SPACE_ID, CLAP_EVENT_NOTE_ON, 0 };
+        n.note_id = static_cast<int32_t>(i);
+        n.port_index = 0;
+        n.channel = static_cast<int16_t>(i % 16);
+        n.key = static_cast<int16_t>(36 + i % 48);
+        n.velocity = 0.8;
+    }
+    return notes;
+}
+
+std::vector<clap_event_param_value> makeParams()
+{
+    std::vector<clap_event_param_value> params(Capacity / 2);
+    for (std::size_t i = 0; i < params.size(); ++i) {
+        auto &p = params[i];
+        p.header = { sizeof(p), static_cast<uint32_t>(i), CLAP_CORE_EVENT_SPACE_ID, CLAP_EVENT_PARAM_VALUE, 0 };
+        p.param_id = static_cast<clap_id>(i);
+        p.cookie = nullptr;
+        p.note_id = p.port_index = p.channel = p.key = -1;
+        p.value = 0.01 * static_cast<double>(i);
+    }
+    return params;
+}
+
+} // namespace
+
+// The audio thread side of the process queue: a block of 64 events pushed into an empty
+// queue, like pushToProcessQueue() does. The variant it carried before against the record.
+TEST_CASE("Process queue push")
+{
+    const auto notes = makeNotes();
+    const auto params = makeParams();
+    const EventTime time { 1, 1'000'000 };
+
+    std::cout << "sizeof(ServerEventWrapper): " << sizeof(ServerEventWrapper)
+              << ", queue of " << Capacity << ": " << sizeof(ServerEventWrapper) * Capacity << " bytes" << std::endl;
+    std::cout << "sizeof(ProcessEventRecord): " << sizeof(ProcessEventRecord)
+              << ", queue of " << Capacity << ": " << sizeof(ProcessEventRecord) * Capacity << " bytes" << std::endl;
+
+    BENCHMARK_ADVANCED("ServerEventWrapper, block of 64")(Catch::Benchmark::Chronometer meter)
+    {
+        std::deque<SPMRQueue<ServerEventWrapper>> queues; // Not movable
+        for (int i = 0; i < meter.runs(); ++i)
+            queues.emplace_back(Capacity);
+        meter.measure([&](int run) {
+            auto &queue = queues[static_cast<std::size_t>(run)];
+            bool ok = true;
+            for (std::size_t i = 0; i < notes.size(); ++i) {
+                ServerEventWrapper note { Event::Note, ClapEventNoteWrapper(&notes[i], CLAP_EVENT_NOTE_ON) };
+                note.time = time;
+                ok &= queue.push(std::move(note));
+                ServerEventWrapper param { Event::Param, ClapEventParamWrapper(&params[i]) };
+                param.time = time;
+                ok &= queue.push(std::move(param));
+            }
+            return ok;
+        });
+    };
+
+    BENCHMARK_ADVANCED("ProcessEventRecord, block of 64")(Catch::Benchmark::Chronometer meter)
+    {
+        std::deque<SPMRQueue<ProcessEventRecord>> queues;
+        for (int i = 0; i < meter.runs(); ++i)
+            queues.emplace_back(Capacity);
+        meter.measure([&](int run) {
+            auto &queue = queues[static_cast<std::size_t>(run)];
+            bool ok = true;
+            for (std::size_t i = 0; i < notes.size(); ++i) {
+                ProcessEventRecord note = ClapEventNoteWrapper(&notes[i], CLAP_EVENT_NOTE_ON);
+                note.time = time;
+                ok &= queue.push(std::move(note));
+                ProcessEventRecord param = ClapEventParamWrapper(&params[i]);
+                param.time = time;
+                ok &= queue.push(std::move(param));
+            }
+            return ok;
+        });
+    };
+}
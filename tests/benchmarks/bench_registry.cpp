@@ -0,0 +1,109 @@
+#include <server/pluginregistry.h>
+#include <server/shareddata.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Plugin lookups per second of the call handler threads, as every RPC does one. Compares
+// the PluginRegistry against the former std::map behind a mutex, while the host keeps
+// creating and destroying an instance.
+using namespace RCLAP_NAMESPACE;
+
+namespace {
+
+constexpr std::uint64_t NumInstances = 256;
+constexpr auto Duration = std::chrono::milliseconds(300);
+
+CorePlugin *fakePlugin(std::uint64_t id)
+{
+    return reinterpret_cast<CorePlugin *>(static_cast<std::uintptr_t>((id + 1) * 64));
+}
+
+class LockedMap
+{
+public:
+    std::shared_ptr<SharedData> find(std::uint64_t hash)
+    {
+        std::scoped_lock lock(mMtx);
+        const auto it = mMap.find(hash);
+        return it == mMap.end() ? nullptr : it->second;
+    }
+    void set(std::uint64_t hash, std::shared_ptr<SharedData> data)
+    {
+        std::scoped_lock lock(mMtx);
+        if (data)
+            mMap[hash] = std::move(data);
+        else
+            mMap.erase(hash);
+    }
+
+private:
+    std::map<std::uint64_t, std::shared_ptr<SharedData>> mMap;
+    std::mutex mMtx;
+};
+
+struct Registry
+{
+    std::shared_ptr<SharedData> find(std::uint64_t hash) { return registry.find(hash); }
+    void set(std::uint64_t hash, std::shared_ptr<SharedData> data)
+    {
+        registry.update([&](PluginRegistry::Table &table) {
+            if (data)
+                table.insert_or_assign(hash, std::move(data));
+            else
+                table.erase(hash);
+            return true;
+        });
+    }
+    PluginRegistry registry;
+};
+
+template <typename T>
+double lookupsPerSecond(std::size_t nThreads)
+{
+    T instances;
+    for (std::uint64_t id = 0; id < NumInstances; ++id)
+        instances.set(id, std::make_shared<SharedData>(fakePlugin(id)));
+
+    std::atomic<bool> done = false;
+    std::atomic<std::uint64_t> total = 0;
+    std::vector<std::jthread> threads;
+    for (std::size_t t = 0; t < nThreads; ++t) {
+        threads.emplace_back([&, t] {
+            std::uint64_t n = 0;
+            for (std::uint64_t id = t; !done; id = (id + 7) % NumInstances, ++n) {
+                if (!instances.find(id) && id != NumInstances - 1)
+                    std::terminate();
+            }
+            total += n;
+        });
+    }
+    const auto end = std::chrono::steady_clock::now() + Duration;
+    while (std::chrono::steady_clock::now() < end) {
+        instances.set(NumInstances - 1, nullptr);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        instances.set(NumInstances - 1, std::make_shared<SharedData>(fakePlugin(NumInstances - 1)));
+    }
+    done = true;
+    threads.clear();
+    return static_cast<double>(total) / std::chrono::duration<double>(Duration).count();
+}
+
+} // namespace
+
+TEST_CASE("Plugin lookups")
+{
+    for (const std::size_t nThreads : { 1u, 2u, 4u, 8u }) {
+        const auto locked = lookupsPerSecond<LockedMap>(nThreads);
+        const auto registry = lookupsPerSecond<Registry>(nThreads);
+        std::cout << nThreads << " threads: map + mutex " << locked / 1e6 << "M/s, registry "
+                  << registry / 1e6 << "M/s" << std::endl;
+    }
+}
@@ -0,0 +1,106 @@
+#include <core/logging.h>
+#include <plugin/coreplugin.h>
+#include <server/serverctrl.h>
+#include <server/shareddata.h>
+
+#include <grpcpp/grpcpp.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <thread>
+
+// Heap allocations per unary ClientParamCall, client and server side, and how many call
+// handlers were constructed for them. Before the handlers were pooled, every call
+// constructed and destroyed its own handler.
+
+// Counts every heap allocation of the process, client and server side.
+namespace {
+std::atomic<std::uint64_t> gAllocations = 0;
+}
+
+void *operator new(std::size_t size)
+{
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+using namespace RCLAP_NAMESPACE;
+const clap_plugin_descriptor Desc = {};
+clap_host Host;
+
+int main(int argc, char *argv[])
+{
+    const std::uint32_t iterations = argc > 1 ? static_cast<std::uint32_t>(std::stoul(argv[1])) : 10'000;
+    if (iterations == 0) {
+        std::cerr << "Usage: " << argv[0] << " [iterations]" << std::endl;
+        return 1;
+    }
+
+    Log::setupLogger("");
+    spdlog::set_level(spdlog::level::warn);
+    CorePlugin cp(&Desc, &Host);
+    const auto idHash = *ServerCtrl::instance().addPlugin(&cp);
+    auto sharedData = ServerCtrl::instance().getSharedData(idHash);
+    ServerCtrl::instance().start();
+
+    // Stands in for the audio thread, so pushClientParam() never blocks.
+    std::atomic<bool> running = true;
+    std::jthread consumer([&] {
+        ClientParamWrapper p;
+        while (running) {
+            while (sharedData->clientsToPluginQueue().pop(p))
+                ;
+            std::this_thread::yield();
+        }
+    });
+
+    auto stub = ClapInterface::NewStub(grpc::CreateChannel(
+        *ServerCtrl::instance().address(), grpc::InsecureChannelCredentials()
+    ));
+    ClientParams params;
+    auto *param = params.add_params();
+    param->set_event(Event::Param);
+    param->mutable_param()->set_param_id(1);
+
+    // A fader drag: one unary call per value.
+    auto call = [&](std::uint32_t i) {
+        param->mutable_param()->set_value(static_cast<double>(i) / iterations);
+        param->mutable_timestamp()->set_seconds(1);
+        param->mutable_timestamp()->set_nanos(static_cast<std::int32_t>(i + 1));
+        grpc::ClientContext ctx;
+        ctx.AddMetadata(Metadata::PluginHashId.data(), std::to_string(idHash));
+        None none;
+        return stub->ClientParamCall(&ctx, params, &none).ok();
+    };
+    for (std::uint32_t i = 0; i < 100; ++i) // Warm up the channel and the handler pool
+        call(i);
+
+    std::uint32_t failed = 0;
+    const auto before = gAllocations.load();
+    const auto begin = std::chrono::steady_clock::now();
+    for (std::uint32_t i = 0; i < iterations; ++i)
+        failed += call(100 + i) ? 0 : 1;
+    const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - begin;
+    const auto allocations = gAllocations.load() - before;
+
+    std::size_t handlers = 0;
+    for (const auto &cq : *ServerCtrl::instance().server()->cqHandles())
+        handlers += cq->pooledHandlers<ClientParamCall>();
+
+    std::cout << "####### ClientParamCall (" << iterations << " calls, " << failed << " failed) #########" << std::endl;
+    std::cout << "Allocations/RPC (client + server): " << static_cast<double>(allocations) / iterations << std::endl;
+    std::cout << "Time/RPC: " << elapsed.count() / iterations << "us" << std::endl;
+    std::cout << "ClientParamCall handlers constructed: " << handlers << std::endl;
+
+    running = false;
+    consumer.join();
+    ServerCtrl::instance().stop();
+    ServerCtrl::instance().removePlugin(idHash);
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include <core/logging.h>
+#include <plugin/coreplugin.h>
+#include <server/serverctrl.h>
+#include <server/shareddata.h>
+
+#include <grpcpp/grpcpp.h>
+
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace RCLAP_NAMESPACE;
+const clap_plugin_descriptor Desc = {};
+clap_host Host;
+
+namespace {
+
+// One plugin instance with a connected client stream.
+struct Instance
+{
+    std::unique_ptr<CorePlugin> plugin;
+    std::uint64_t hash = 0;
+    std::shared_ptr<SharedData> sharedData;
+    std::unique_ptr<grpc::ClientContext> ctx;
+    std::jthread reader;
+    std::atomic<std::uint64_t> received = 0;
+};
+
+// Pushes eventsPerInstance events into every instance and measures how long it
+// takes until all clients have received them.
+double run(std::size_t nCqs, std::size_t nInstances, std::uint64_t eventsPerInstance)
+{
+    ServerCtrl::instance().setCompletionQueues(nCqs, 1);
+    std::vector<std::unique_ptr<Instance>> instances;
+    for (std::size_t i = 0; i < nInstances; ++i) {
+        auto inst = std::make_unique<Instance>();
+        inst->plugin = std::make_unique<CorePlugin>(&Desc, &Host);
+        inst->hash = *ServerCtrl::instance().addPlugin(inst->plugin.get());
+        inst->sharedData = ServerCtrl::instance().getSharedData(inst->hash);
+        instances.push_back(std::move(inst));
+    }
+    ServerCtrl::instance().start();
+
+    auto channel = grpc::CreateChannel(*ServerCtrl::instance().address(), grpc::InsecureChannelCredentials());
+    auto stub = ClapInterface::NewStub(channel);
+    for (auto &inst : instances) {
+        inst->ctx = std::make_unique<grpc::ClientContext>();
+        inst->ctx->AddMetadata(Metadata::PluginHashId.data(), std::to_string(inst->hash));
+        inst->reader = std::jthread([&stub, i = inst.get()] {
+            ServerEvents evs;
+            auto stream = stub->ServerEventStream(i->ctx.get(), ClientRequest());
+            while (stream->Read(&evs))
+                i->received += static_cast<std::uint64_t>(evs.events_size());
+            stream->Finish();
+        });
+    }
+    for (auto &inst : instances) {
+        while (inst->sharedData->nStreams() == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // A single producer, like a host processing its instances one after the other.
+    const auto begin = std::chrono::steady_clock::now();
+    for (std::uint64_t n = 0; n < eventsPerInstance; ++n) {
+        for (auto &inst : instances) {
+            ProcessEventRecord ev = ClapEventParamWrapper();
+            while (!inst->sharedData->pluginToClientsQueue().push(std::move(ev)))
+                std::this_thread::yield();
+            inst->sharedData->notify();
+        }
+    }
+    for (auto &inst : instances) {
+        while (inst->received.load() < eventsPerInstance)
+            std::this_thread::yield();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+    for (auto &inst : instances)
+        inst->sharedData->stopPoll();
+    for (auto &inst : instances) {
+        inst->reader.join();
+        ServerCtrl::instance().removePlugin(inst->hash);
+    }
+    ServerCtrl::instance().stop();
+    return static_cast<double>(eventsPerInstance * nInstances) / elapsed.count();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const std::uint64_t events = argc > 1 ? std::stoull(argv[1]) : 20'000;
+    if (events == 0) {
+        std::cerr << "Usage: " << argv[0] << " [events/instance]" << std::endl;
+        return 1;
+    }
+
+    Log::setupLogger("");
+    spdlog::set_level(spdlog::level::warn);
+
+    const std::size_t maxCqs = std::max(1U, std::thread::hardware_concurrency() / 2);
+    std::cout << "####### Delivered events/s by instances and stream completion queues #########" << std::endl;
+    std::cout << "instances";
+    for (std::size_t cqs = 1; cqs <= maxCqs; cqs *= 2)
+        std::cout << "\t cqs: " << cqs;
+    std::cout << std::endl;
+    for (const std::size_t nInstances : { 1, 4, 16, 64, 128 }) {
+        std::cout << nInstances;
+        for (std::size_t cqs = 1; cqs <= maxCqs; cqs *= 2)
+            std::cout << "\t " << run(cqs, nInstances, events / nInstances + 1);
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include <server/pluginregistry.h>
+#include <server/sessiontable.h>
+#include <server/shareddata.h>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include <grpcpp/support/string_ref.h>
+
+#include <charconv>
+#include <cstring>
+#include <map>
+#include <string>
+
+// The per-call cost of finding the plugin instance of an RPC: parsing the PluginHashId
+// metadata like the handlers used to, against resolving the id of an open session.
+// Both end with the registry lookup. The metadata holds what a gRPC client sends.
+using namespace RCLAP_NAMESPACE;
+
+namespace {
+
+using Metadata_t = std::multimap<grpc::string_ref, grpc::string_ref>;
+
+constexpr std::uint64_t NumInstances = 64;
+
+CorePlugin *fakePlugin(std::uint64_t id)
+{
+    return reinterpret_cast<CorePlugin *>(static_cast<std::uintptr_t>((id + 1) * 64));
+}
+
+Metadata_t baseMetadata()
+{
+    return {
+        { "content-type", "application/grpc" },
+        { "te", "trailers" },
+        { "grpc-accept-encoding", "identity,deflate,gzip" },
+        { "user-agent", "grpc-c++/1.51.1 grpc-c/29.0.0 (linux; chttp2)" },
+        { "grpc-timeout", "999999u" },
+    };
+}
+
+// What ClientParamCall::extractMetadata() did, a std::string per key, then std::stoull.
+std::optional<std::uint64_t> parseHash(const Metadata_t &metadata)
+{
+    for (const auto &[key, value] : metadata) {
+        if (std::string(key.data(), key.size()) == Metadata::PluginHashId)
+            return std::stoull(std::string(value.data(), value.length()));
+    }
+    return std::nullopt;
+}
+
+std::optional<std::uint64_t> sessionHash(const Metadata_t &metadata, const SessionTable &sessions)
+{
+    const auto it = metadata.find(grpc::string_ref(Metadata::SessionId.data(), Metadata::SessionId.size()));
+    std::uint64_t id = 0;
+    if (it == metadata.end() || it->second.size() != sizeof(id))
+        return std::nullopt;
+    std::memcpy(&id, it->second.data(), sizeof(id));
+    return sessions.resolve(id);
+}
+
+} // namespace
+
+TEST_CASE("Per-call plugin resolution")
+{
+    PluginRegistry registry;
+    registry.update([](PluginRegistry::Table &table) {
+        for (std::uint64_t id = 0; id < NumInstances; ++id)
+            table.emplace(id * 0x9E3779B97F4A7C15ull, std::make_shared<SharedData>(fakePlugin(id)));
+        return true;
+    });
+    const std::uint64_t hash = 7 * 0x9E3779B97F4A7C15ull;
+
+    const auto hashString = std::to_string(hash);
+    auto withHash = baseMetadata();
+    withHash.emplace(grpc::string_ref(Metadata::PluginHashId.data(), Metadata::PluginHashId.size()), hashString);
+
+    SessionTable sessions;
+    const auto id = sessions.open(hash);
+    REQUIRE(id);
+    char idBytes[sizeof(*id)];
+    std::memcpy(idBytes, &*id, sizeof(*id));
+    auto withSession = baseMetadata();
+    withSession.emplace(grpc::string_ref(Metadata::SessionId.data(), Metadata::SessionId.size()),
+                        grpc::string_ref(idBytes, sizeof(idBytes)));
+
+    REQUIRE(parseHash(withHash) == hash);
+    REQUIRE(sessionHash(withSession, sessions) == hash);
+
+    BENCHMARK("PluginHashId")
+    {
+        return registry.find(*parseHash(withHash));
+    };
+    BENCHMARK("Session")
+    {
+        return registry.find(*sessionHash(withSession, sessions));
+    };
+}
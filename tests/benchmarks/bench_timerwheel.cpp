@@ -0,0 +1,83 @@
+#include <server/server.h>
+#include <server/timerwheel.h>
+
+#include <grpcpp/alarm.h>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace RCLAP_NAMESPACE;
+
+// Throughput of the deferred functions of a CqEventHandler. The map is what every
+// deferred call used to pay: a heap allocated function, an alarm and a linear search
+// to destroy it once it fired.
+TEST_CASE("TimerWheel") {
+    for (const int n : { 16, 256, 4096 }) {
+        std::vector<TimerWheel::Id> ids(static_cast<std::size_t>(n));
+        std::vector<TimerWheel::Fn> expired;
+        expired.reserve(static_cast<std::size_t>(n));
+        int sum = 0;
+
+        BENCHMARK("map enqueue+destroy n=" + std::to_string(n)) {
+            std::map<std::unique_ptr<TimerWheel::Fn>, grpc::Alarm> pending;
+            std::vector<TimerWheel::Fn *> raw;
+            for (int i = 0; i < n; ++i) {
+                auto fn = std::make_unique<TimerWheel::Fn>([&sum, i](bool) { sum += i; });
+                raw.push_back(fn.get());
+                pending.try_emplace(std::move(fn), grpc::Alarm());
+            }
+            for (auto *fn : raw) {
+                auto it = std::find_if(pending.begin(), pending.end(), [fn](const auto &p) { return p.first.get() == fn; });
+                (*it->first)(true);
+                pending.erase(it);
+            }
+            return sum;
+        };
+
+        TimerWheel wheel(static_cast<std::size_t>(n));
+        std::uint64_t now = 0;
+        BENCHMARK("wheel enqueue+fire n=" + std::to_string(n)) {
+            for (int i = 0; i < n; ++i)
+                wheel.add([&sum, i](bool) { sum += i; }, now + 1 + static_cast<std::uint64_t>(i % 250));
+            now += 251;
+            wheel.advance(now, expired);
+            for (auto &fn : expired)
+                fn(true);
+            expired.clear();
+            return sum;
+        };
+
+        BENCHMARK("wheel enqueue+cancel n=" + std::to_string(n)) {
+            for (int i = 0; i < n; ++i)
+                ids[static_cast<std::size_t>(i)] = wheel.add([&sum, i](bool) { sum += i; }, now + 1 + static_cast<std::uint64_t>(i));
+            for (const auto id : ids)
+                sum += wheel.cancel(id) ? 1 : 0;
+            return sum;
+        };
+    }
+}
+
+TEST_CASE("CqEventHandler enqueueFn") {
+    Server server("localhost:0");
+    REQUIRE(server.start());
+    auto *cq = server.getServerStreamCqHandle();
+
+    for (const int n : { 1, 64, 1024 }) {
+        BENCHMARK("enqueue+fire n=" + std::to_string(n)) {
+            std::atomic<int> fired = 0;
+            for (int i = 0; i < n; ++i)
+                cq->enqueueFn([&fired](bool) { ++fired; }, 0);
+            while (fired.load() != n)
+                std::this_thread::yield();
+            return fired.load();
+        };
+    }
+    REQUIRE(server.stop());
+}
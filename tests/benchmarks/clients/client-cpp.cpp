@@ -1,9 +1,12 @@
 #include <iostream>
 #include <memory>
 #include <chrono>
+#include <optional>
+#include <thread>
 
 #include <core/global.h>
 #include <core/timestamp.h>
+#include <core/shmring.h>
 
 #include <api.pb.h>
 #include <api.grpc.pb.h>
@@ -12,68 +15,164 @@
 using namespace api::v0;
 using namespace RCLAP_NAMESPACE;
 
+namespace {
+
+// Single pass over the decoded batch. Returns the number of events and feeds the
+// values into a checksum, so the compiler can't skip the walk.
+uint64_t walkEvents(const ServerEvents &evs, double &checksum)
+{
+    for (const auto &ev : evs.events())
+        checksum += ev.has_param() ? ev.param().value() : ev.note().value();
+    const auto &packed = evs.packed();
+    for (const auto v : packed.param_values())
+        checksum += v;
+    for (const auto v : packed.note_values())
+        checksum += v;
+    return static_cast<uint64_t>(evs.events_size() + packed.param_ids_size() + packed.note_ids_size());
+}
+
+// What a transport delivered, from the first to the last read.
+struct Stats
+{
+    uint64_t bytes = 0;
+    uint64_t messages = 0;
+    std::chrono::nanoseconds decodeTime {};
+    double checksum = 0;
+    std::optional<Stamp> tFirst;
+    std::optional<Stamp> tLast;
+
+    bool decode(const grpc::ByteBuffer &raw, ServerEvents &evs)
+    {
+        auto copy = raw; // Deserialize consumes the buffer
+        const auto tDecode = std::chrono::steady_clock::now();
+        if (!grpc::SerializationTraits<ServerEvents>::Deserialize(&copy, &evs).ok())
+            return false;
+        messages += walkEvents(evs, checksum);
+        decodeTime += std::chrono::steady_clock::now() - tDecode;
+        return true;
+    }
+
+    bool decode(const std::string &raw, ServerEvents &evs)
+    {
+        const auto tDecode = std::chrono::steady_clock::now();
+        if (!evs.ParseFromString(raw))
+            return false;
+        messages += walkEvents(evs, checksum);
+        decodeTime += std::chrono::steady_clock::now() - tDecode;
+        return true;
+    }
+
+    void received(std::size_t n)
+    {
+        if (!tFirst)
+            tFirst = Timestamp::stamp();
+        tLast = Timestamp::stamp();
+        bytes += n;
+    }
+
+    void print(std::string_view transport)
+    {
+        using std::cout;
+        using std::endl;
+
+        cout << "####### " << transport << " finished #########" << endl;
+        cout << "Number of messages: " << messages << endl;
+        cout << "Bytes written: " << bytes << endl;
+        if (messages == 0) {
+            cout << endl;
+            return;
+        }
+        cout << "Avg. Bytes/Messages: " << static_cast<double>(bytes) / static_cast<double>(messages) << endl;
+        cout << "Decode time/Message: " << static_cast<double>(decodeTime.count()) / static_cast<double>(messages) << "ns"
+             << " (checksum " << checksum << ")" << endl;
+        cout << endl;
+        const auto serverRtt = tLast->delta(*tFirst);
+        cout << "Server RTT: " << serverRtt.toDouble() << " s" << endl;
+        cout << "Mbps: " << (static_cast<double>(bytes * 8)) / serverRtt.toDouble() / 1e6 << endl;
+        auto serverRttMicros = serverRtt.toDouble() * 1e6;
+        cout << "Time/Message: " << serverRttMicros / static_cast<double>(messages) << "us" << endl;
+    }
+};
+
+} // namespace
+
 class Client
 {
 public:
     Client(const std::shared_ptr<grpc::Channel> channel, std::string_view id)
-        : mStub(ClapInterface::NewStub(channel)), mId(id), tCreate(Timestamp::stamp())
+        : mChannel(channel), mId(id), tCreate(Timestamp::stamp())
     {}
 
-    void serverEventStreamHandler()
+    void serverEventStreamHandler(ClientRequest::Encoding encoding, std::optional<ShmRing> ring)
     {
         ClientRequest request;
-        ServerEvents serverEvents;
+        request.set_encoding(encoding);
+        request.set_shared_memory(ring.has_value());
         grpc::ClientContext context;
         context.AddMetadata(Metadata::PluginHashId.data(), mId);
-        auto stream = mStub->ServerEventStream(&context, request);
-
-        std::vector<Stamp> stamps;
-        stamps.reserve(3);
-        uint64_t bytesWritten = 0;
-        uint64_t messageCount = 0;
-
-        Stamp tBegin = Timestamp::stamp();
-        while (stream->Read(&serverEvents)) {
-            bytesWritten += serverEvents.ByteSizeLong();
-            messageCount += static_cast<uint64_t>(serverEvents.events_size());
-            if (serverEvents.has_timestamp()) {
-                stamps.emplace_back(serverEvents.timestamp().seconds(), serverEvents.timestamp().nanos());
-            }
-        }
-        Stamp tEnd = Timestamp::stamp();
+        // Read the stream undecoded, so that decoding can be timed on its own.
+        const grpc::internal::RpcMethod method(
+            "/api.v0.ClapInterface/ServerEventStream", grpc::internal::RpcMethod::SERVER_STREAMING, mChannel
+        );
+        std::unique_ptr<grpc::ClientReader<grpc::ByteBuffer>> stream(
+            grpc::internal::ClientReaderFactory<grpc::ByteBuffer>::Create(mChannel.get(), method, &context, request)
+        );
 
-        using std::cout;
-        using std::endl;
+        // The ring carries the process events, the stream everything else.
+        Stats ringStats;
+        std::atomic<bool> streamDone = false;
+        std::jthread ringReader;
+        if (ring) {
+            ringReader = std::jthread([&] {
+                ServerEvents evs;
+                std::string record;
+                while (!streamDone) {
+                    if (!ring->wait(std::chrono::milliseconds(50)))
+                        continue;
+                    while (ring->read(record)) {
+                        ringStats.received(record.size());
+                        if (!ringStats.decode(record, evs))
+                            std::cout << "Failed to decode ring record" << std::endl;
+                    }
+                    if (ring->isClosed())
+                        break;
+                }
+            });
+        }
 
-        cout << "####### Client stream finished #########" << endl;
-        cout << "Number of messages: " << messageCount << endl;
-        cout << "Bytes written: " << bytesWritten << endl;
-        cout << "Avg. Bytes/Messages: " << static_cast<double>(bytesWritten/messageCount) << endl;
-        cout << endl;
-        cout << "Stamps: " << stamps.size() << endl;
-        if (stamps.size() == 2) {
-            stamps[1].subtractMilliseconds(1); // The 1ms we wait in the host.
-            const auto serverRtt = tEnd.delta(stamps[0]);
-            cout << "Server RTT: " << serverRtt.toDouble() << " s" << endl;
-            cout << "Mbps: " << (static_cast<double>(bytesWritten * 8)) / serverRtt.toDouble() / 1e6 << endl;
-            auto serverRttMicros = serverRtt.toDouble() * 1e6;
-            cout << "Time/Message: " << serverRttMicros / static_cast<double>(messageCount) << "us" << endl;
+        Stats streamStats;
+        ServerEvents serverEvents;
+        grpc::ByteBuffer raw;
+        while (stream->Read(&raw)) {
+            streamStats.received(raw.Length());
+            if (!streamStats.decode(raw, serverEvents)) {
+                std::cout << "Failed to decode ServerEvents" << std::endl;
+                break;
+            }
         }
+        streamDone = true;
+        if (ringReader.joinable())
+            ringReader.join();
+
+        std::cout << "Encoding: " << ClientRequest::Encoding_Name(encoding) << std::endl;
+        streamStats.print("Client stream");
+        if (ring)
+            ringStats.print("Shared memory ring");
 
         if (auto s = stream->Finish(); !s.ok())
             std::cout << "Channel error: " << s.error_message() << std::endl;
     }
 
 private:
-    std::unique_ptr<ClapInterface::Stub> mStub;
+    std::shared_ptr<grpc::Channel> mChannel;
     std::string mId;
     Stamp tCreate;
 };
 
 int main(int argc, char* argv[])
 {
-    if (argc < 2) {
-        std::cout << "Usage: client-cpp <plugin-id>" << std::endl;
+    if (argc < 3) {
+        std::cout << "Usage: client-cpp <plugin-id> <address> [events|packed] [<memfd>:<eventfd>]" << std::endl;
         return 1;
     }
 
@@ -81,6 +180,13 @@ int main(int argc, char* argv[])
         std::cout << argv[i] << std::endl;
 
     Client client(grpc::CreateChannel(argv[2], grpc::InsecureChannelCredentials()), argv[1]);
-    client.serverEventStreamHandler();
+    const bool packed = argc > 3 && std::string_view(argv[3]) == "packed";
+    std::optional<ShmRing> ring;
+    if (argc > 4) {
+        ring = ShmRing::attach(argv[4]);
+        if (!ring)
+            std::cout << "Failed to attach to the shared memory ring, using the stream only" << std::endl;
+    }
+    client.serverEventStreamHandler(packed ? ClientRequest_Encoding_Packed : ClientRequest_Encoding_Events, std::move(ring));
     return 0;
 }